@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdlib>
+#include <new>
+
+// Counts heap allocations by replacing the global operator new and operator delete. The
+// replacements are program-wide definitions, so include this from one file per benchmark
+// executable; it reads the counters before and after the code it measures.
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"	// malloc/free behind new/delete is the point
+#endif
+
+inline size_t allocations = 0;
+inline size_t allocatedBytes = 0;
+inline size_t frees = 0;
+
+void* operator new(std::size_t size) {
+	++allocations;
+	allocatedBytes += size;
+	if (void* p = std::malloc(size ? size : 1)) return p;
+	throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept {
+	if (p) ++frees;
+	std::free(p);
+}
+void operator delete(void* p, std::size_t) noexcept {
+	if (p) ++frees;
+	std::free(p);
+}
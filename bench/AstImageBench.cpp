@@ -0,0 +1,72 @@
+// Getting a FlatAst for a large synthetic program: lex and parse the source, or load a
+// saved AstImage through a mapping. Times the image load alone, load + verify(), load +
+// copy to a FlatAst, and load + replay into the class tree. Every route must give the
+// same AST as the parser.
+//
+// usage: ast_image_bench [functions] [directory]
+
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "AstImage.hpp"
+#include "Fixtures.hpp"
+#include "Parser.hpp"
+#include "Timing.hpp"
+
+int main(int argc, char** argv) {
+	size_t functions = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+	std::filesystem::path directory = argc > 2 ? argv[2] : std::filesystem::temp_directory_path();
+	std::string source = pointFunctions(functions);
+	FManager files(directory.string());
+	const std::string filename = "ast_image_bench.cast";
+
+	FlatAst parsed;
+	double parseTime = millisecondsOf([&] {
+		Lexer lexer;
+		std::vector<CompactToken> tokens = lexer.tokenizeBuffer(source);
+		parsed = FlatParser(source, tokens).Parse();
+	});
+
+	double writeTime = millisecondsOf([&] {
+		if (!AstImage::save(parsed, files, filename)) std::exit(1);
+	});
+
+	size_t imageBytes = 0;
+	double loadTime = millisecondsOf([&] {
+		AstImage image = AstImage::load(files, filename);
+		imageBytes = image.fileBytes();
+	});
+
+	double verifyTime = millisecondsOf([&] {
+		AstImage image = AstImage::load(files, filename);
+		image.verify();
+	});
+
+	FlatAst copied;
+	double copyTime = millisecondsOf([&] { copied = AstImage::load(files, filename).toFlatAst(); });
+
+	std::unique_ptr<Program> tree;
+	double treeTime = millisecondsOf([&] { tree.reset(toTree(AstImage::load(files, filename))); });
+
+	std::unique_ptr<Program> parsedTree(toTree(parsed));
+	bool same = sameAst(parsed, copied) && sameAst(toFlatAst(*parsedTree), toFlatAst(*tree));
+	files.deleteFile(filename);
+
+	std::cout << source.size() / 1e6 << " MB of source, " << parsed.size() << " nodes, image "
+			  << imageBytes / 1024 << " KiB\n";
+	std::cout << "lex + parse         : " << parseTime << " ms\n";
+	std::cout << "write image         : " << writeTime << " ms\n";
+	std::cout << "load image          : " << loadTime << " ms\n";
+	std::cout << "load + verify       : " << verifyTime << " ms\n";
+	std::cout << "load + FlatAst copy : " << copyTime << " ms\n";
+	std::cout << "load + class tree   : " << treeTime << " ms\n";
+
+	if (!same) {
+		std::cerr << "AST loaded from the image differs from the parsed one\n";
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,132 @@
+// Incremental compilation through CompileCache on a generated program: a build without
+// the cache, a cold build that fills it, a warm build that hits everywhere, and a build
+// after editing one function. Then the same with a cache limited to a quarter of the
+// entries, so that builds evict and compact, and once more after reopening it. Every build
+// must produce the same bytecode as the plain pipeline for the same text, and a warm build
+// must still reject a file that only adds an invalid class.
+//
+// usage: cache_bench [functions] [cache directory]
+
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "CompileCache.hpp"
+#include "Timing.hpp"
+
+static std::string makeSource(size_t functions, int edited) {
+	std::ostringstream out;
+	for (size_t n = 0; n < functions; ++n) {
+		out << "float f" << n << "(float x, float[] data) {\n"
+			<< "\tfloat total = " << (static_cast<int>(n) == edited ? 1 : 0) << ";\n"
+			<< "\tfloat i = 0;\n"
+			<< "\tfor (i = 0; i < length(data); i++) {\n"
+			<< "\t\tif (data[i] > x) { total = total + data[i] * 2; } else { total = total - 1; }\n"
+			<< "\t}\n"
+			<< "\twhile (total > 100) { total = total / 2; }\n";
+		if (n > 0) out << "\ttotal = total + f" << n - 1 << "(x - 1, data);\n";
+		out << "\treturn total;\n"
+			<< "}\n";
+	}
+	return out.str();
+}
+
+static std::string print(const BytecodeModule& module) {
+	std::ostringstream out;
+	module.print(out);
+	return out.str();
+}
+
+static BytecodeModule compilePlain(const std::string& source) {
+	Lexer lexer;
+	std::vector<CompactToken> tokens = lexer.tokenizeBuffer(source);
+	std::unique_ptr<Program> program(Parser(source, tokens).Parse());
+	Resolver().resolve(*program);
+	TypeContext types;
+	TypeChecker checker(types);
+	checker.check(*program);
+	return BytecodeCompiler().compile(*program);
+}
+
+int main(int argc, char** argv) {
+	size_t functions = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000;
+	std::filesystem::path directory = argc > 2 ? argv[2] : std::filesystem::temp_directory_path() / "cache_bench";
+	std::filesystem::remove_all(directory);
+	std::filesystem::create_directories(directory);
+
+	const std::string source = makeSource(functions, -1);
+	const std::string edited = makeSource(functions, static_cast<int>(functions / 2));
+	std::cout << functions << " functions, " << source.size() / 1024 << " KiB\n";
+
+	std::string expected, expectedEdited;
+	double plain = millisecondsOf([&] { expected = print(compilePlain(source)); });
+	expectedEdited = print(compilePlain(edited));
+	std::cout << "no cache    " << plain << " ms\n";
+
+	struct Step {
+		const char* name;
+		const std::string& text;
+	};
+	auto run = [&](CompileCache& cache, std::initializer_list<Step> steps) {
+		for (const Step& step : steps) {
+			BytecodeModule module;
+			double ms = millisecondsOf([&] { module = cache.compile(step.text); });
+			if (print(module) != (&step.text == &source ? expected : expectedEdited)) {
+				std::cerr << step.name << ": bytecode differs from the uncached build\n";
+				return false;
+			}
+			std::cout << step.name << std::string(12 - std::string(step.name).size(), ' ') << ms << " ms\n";
+		}
+		cache.flush();
+		std::cout << cache.stats() << "\n" << cache.entries() << " entries, " << cache.bytes() / 1024 << " KiB on disk\n";
+		return true;
+	};
+
+	uint64_t fullBytes = 0;
+	{
+		CompileCache cache(directory.string());
+		if (!run(cache, {{"cold", source}, {"warm", source}, {"one edit", edited}, {"edit again", edited}})) return 1;
+		fullBytes = cache.bytes();
+
+		// Every function hits, but the added class is in no key: the build must still fail
+		for (const char* bad : {"class Bad {\n\tnosuchtype field;\n}\n", "class Worse {\n\tfloat ;\n\t+\n}\n"}) {
+			bool failed = false;
+			try {
+				cache.compile(edited + bad);
+			} catch (const std::runtime_error&) {
+				failed = true;
+			}
+			if (!failed) {
+				std::cerr << "a warm build accepted an invalid class the uncached build rejects\n";
+				return 1;
+			}
+		}
+	}
+
+	// A quarter of the entries fit: every build evicts, and the first leaves the pack mostly
+	// dead entries, so it is compacted
+	std::filesystem::path small = directory / "small";
+	std::filesystem::create_directories(small);
+	const uint64_t limit = fullBytes / 4;
+	std::cout << "limited to " << limit / 1024 << " KiB\n";
+	size_t evictions = 0, compactions = 0;
+	{
+		CompileCache cache(small.string(), limit);
+		if (!run(cache, {{"cold", source}, {"one edit", edited}, {"revert", source}})) return 1;
+		evictions += cache.stats().evictions;
+		compactions += cache.stats().compactions;
+	}
+	{
+		CompileCache cache(small.string(), limit);
+		if (!run(cache, {{"reopened", edited}, {"revert", source}})) return 1;
+		evictions += cache.stats().evictions;
+	}
+	if (evictions == 0 || compactions == 0) {
+		std::cerr << "the size limit never evicted or compacted\n";
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,206 @@
+// Front-end benchmark suite. For each generated shape (SourceGenerator.hpp) times, as
+// separate stages: FManager::readFile, Lexer::tokenize on the lines it returns, Parser::Parse
+// on those tokens and deleting the Program. Each stage runs --repeat times and reports the
+// median, with its throughput (MB/s, tokens/s, nodes/s) and the heap allocations of one run,
+// counted by AllocationCounter.hpp. Teardown releases a few arena chunks, so it
+// reports only its time and frees; a rate over that would be noise.
+//
+// --json writes the same numbers for CI. Sizes and allocation counts are deterministic, so
+// a change there is a real change; times are compared with a tolerance.
+//
+// usage: compiler_bench [--scale X] [--repeat N] [--json file] [--shape name]...
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "AllocationCounter.hpp"
+#include "FManager.hpp"
+#include "Parser.hpp"
+#include "SourceGenerator.hpp"
+#include "Timing.hpp"
+
+struct StageResult {
+	std::string name;
+	bool perByte = false, perToken = false, perNode = false;	// which throughputs mean something
+	bool countsAllocations = true;	// false: only frees are reported
+	double milliseconds = 0;	// median of the runs
+	size_t allocations = 0;		// during the first run
+	size_t allocatedBytes = 0;
+	size_t frees = 0;
+};
+
+struct ShapeResult {
+	std::string shape;
+	size_t bytes = 0;
+	size_t lines = 0;
+	size_t tokens = 0;
+	size_t nodes = 0;
+	std::vector<StageResult> stages;
+};
+
+// Runs setup() (untimed) then body() `repeat` times; body's allocations are counted on the first run
+template<class Setup, class Body>
+static StageResult measure(StageResult result, int repeat, Setup&& setup, Body&& body) {
+	std::vector<double> times;
+	times.reserve(repeat);
+	for (int run = 0; run < repeat; ++run) {
+		setup();
+		size_t allocated = allocations, bytes = allocatedBytes, freed = frees;
+		double milliseconds = millisecondsOf(body);
+		if (run == 0) {
+			result.allocations = allocations - allocated;
+			result.allocatedBytes = allocatedBytes - bytes;
+			result.frees = frees - freed;
+		}
+		times.push_back(milliseconds);
+	}
+	std::nth_element(times.begin(), times.begin() + times.size() / 2, times.end());
+	result.milliseconds = times[times.size() / 2];
+	return result;
+}
+
+static ShapeResult runShape(const SourceShape& shape, const FManager& files, int repeat) {
+	ShapeResult result;
+	result.shape = shape.name;
+	const std::string filename = "compiler_bench_" + shape.name + ".src";
+	const std::string source = generateSource(shape);
+	result.bytes = source.size();
+	files.writeFile(filename, source);
+
+	std::vector<std::string> lines;
+	result.stages.push_back(measure({"read", true}, repeat, [&] { lines.clear(); lines.shrink_to_fit(); },
+									[&] { lines = files.readFile(filename); }));
+	result.lines = lines.size();
+
+	std::vector<Token> tokens;
+	result.stages.push_back(measure({"lex", true, true}, repeat, [&] { tokens.clear(); tokens.shrink_to_fit(); }, [&] {
+		Lexer lexer;
+		tokens = lexer.tokenize(lines);
+	}));
+	result.tokens = tokens.size();
+
+	// Parse and teardown alternate, so each teardown frees the Program just parsed. The
+	// parser consumes its tokens, so each run parses a fresh copy made outside the timing.
+	std::unique_ptr<Program> program;
+	std::vector<Token> input;
+	result.stages.push_back(measure({"parse", true, true, true}, repeat, [&] { program.reset(); input = tokens; },
+									[&] { program.reset(Parser(std::move(input)).Parse()); }));
+	result.nodes = toFlatAst(*program).size() + 1;	// + the Program node
+	std::vector<std::unique_ptr<Program>> parsed;
+	result.stages.push_back(measure({"teardown", false, false, false, false}, repeat, [&] {
+		parsed.clear();
+		parsed.emplace_back(Parser(std::vector<Token>(tokens)).Parse());
+	}, [&] { parsed.back().reset(); }));
+
+	files.deleteFile(filename);
+	return result;
+}
+
+// Units processed per second for a stage
+static double rate(size_t units, const StageResult& stage) {
+	return stage.milliseconds > 0 ? static_cast<double>(units) / (stage.milliseconds / 1000) : 0;
+}
+
+static void printTable(const ShapeResult& shape) {
+	std::cout << shape.shape << ": " << std::fixed << std::setprecision(2) << shape.bytes / 1e6 << " MB, "
+			  << shape.lines << " lines, " << shape.tokens << " tokens, " << shape.nodes << " nodes\n";
+	for (const StageResult& stage : shape.stages) {
+		std::cout << "  " << std::left << std::setw(9) << stage.name << std::right << std::setw(9) << stage.milliseconds << " ms  ";
+		if (stage.countsAllocations) std::cout << std::setw(9) << stage.allocations << " allocs ";
+		else std::cout << std::string(17, ' ');
+		std::cout << std::setw(9) << stage.frees << " frees ";
+		if (stage.countsAllocations) std::cout << std::setw(9) << stage.allocatedBytes / 1024 << " KiB ";
+		else std::cout << std::string(14, ' ');
+		if (stage.perByte) std::cout << std::setw(9) << rate(shape.bytes, stage) / 1e6 << " MB/s ";
+		if (stage.perToken) std::cout << std::setw(7) << rate(shape.tokens, stage) / 1e6 << " M tokens/s ";
+		if (stage.perNode) std::cout << std::setw(7) << rate(shape.nodes, stage) / 1e6 << " M nodes/s";
+		std::cout << "\n";
+	}
+	std::cout.unsetf(std::ios::floatfield);
+}
+
+// One object per shape and stage on its own line, keys in a fixed order, so plain diff works
+static std::string toJson(const std::vector<ShapeResult>& results, double scale, int repeat) {
+	std::ostringstream out;
+	out << std::fixed << std::setprecision(3);
+	out << "{\n  \"benchmark\": \"compiler_bench\",\n  \"version\": 1,\n  \"scale\": " << scale
+		<< ",\n  \"repeat\": " << repeat << ",\n  \"shapes\": [\n";
+	for (size_t s = 0; s < results.size(); ++s) {
+		const ShapeResult& shape = results[s];
+		out << "    {\"shape\": \"" << shape.shape << "\", \"bytes\": " << shape.bytes << ", \"lines\": " << shape.lines
+			<< ", \"tokens\": " << shape.tokens << ", \"nodes\": " << shape.nodes << ", \"stages\": [\n";
+		for (size_t i = 0; i < shape.stages.size(); ++i) {
+			const StageResult& stage = shape.stages[i];
+			out << "      {\"stage\": \"" << stage.name << "\", \"ms\": " << stage.milliseconds;
+			if (stage.perByte) out << ", \"mb_per_s\": " << rate(shape.bytes, stage) / 1e6;
+			if (stage.perToken) out << ", \"tokens_per_s\": " << rate(shape.tokens, stage);
+			if (stage.perNode) out << ", \"nodes_per_s\": " << rate(shape.nodes, stage);
+			if (stage.countsAllocations) out << ", \"allocations\": " << stage.allocations;
+			out << ", \"frees\": " << stage.frees;
+			if (stage.countsAllocations) out << ", \"allocated_bytes\": " << stage.allocatedBytes;
+			out << "}"
+				<< (i + 1 < shape.stages.size() ? "," : "") << "\n";
+		}
+		out << "    ]}" << (s + 1 < results.size() ? "," : "") << "\n";
+	}
+	out << "  ]\n}\n";
+	return out.str();
+}
+
+int main(int argc, char** argv) {
+	double scale = 1;
+	int repeat = 5;
+	std::string jsonPath;
+	std::vector<std::string> selected;
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (i + 1 < argc && arg == "--scale") scale = std::strtod(argv[++i], nullptr);
+		else if (i + 1 < argc && arg == "--repeat") repeat = std::max(1, std::atoi(argv[++i]));
+		else if (i + 1 < argc && arg == "--json") jsonPath = argv[++i];
+		else if (i + 1 < argc && arg == "--shape") selected.push_back(argv[++i]);
+		else {
+			std::cerr << "usage: compiler_bench [--scale X] [--repeat N] [--json file] [--shape name]...\n";
+			return 2;
+		}
+	}
+
+	const std::vector<SourceShape> shapes = standardShapes();
+	for (const std::string& name : selected) {
+		if (std::none_of(shapes.begin(), shapes.end(), [&](const SourceShape& shape) { return shape.name == name; })) {
+			std::cerr << "Unknown shape '" << name << "'; the shapes are:";
+			for (const SourceShape& shape : shapes) std::cerr << " " << shape.name;
+			std::cerr << "\n";
+			return 2;
+		}
+	}
+
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / "compiler_bench";
+	std::filesystem::create_directories(directory);
+	FManager files(directory.string());
+
+	std::vector<ShapeResult> results;
+	for (const SourceShape& shape : shapes) {
+		if (!selected.empty() && std::find(selected.begin(), selected.end(), shape.name) == selected.end()) continue;
+		results.push_back(runShape(shape.scaled(scale), files, repeat));
+		printTable(results.back());
+	}
+	std::filesystem::remove_all(directory);
+
+	if (!jsonPath.empty()) {
+		std::ofstream json(jsonPath);
+		json << toJson(results, scale, repeat);
+		if (!json) {
+			std::cerr << "Unable to write " << jsonPath << "\n";
+			return 1;
+		}
+	}
+	return results.empty() ? 1 : 0;
+}
@@ -0,0 +1,70 @@
+// Multi-file build throughput of the Driver at increasing job counts. Writes a tree of
+// synthetic source files to a temporary directory and compiles it with -j 1, 2, 4, ...
+// up to the hardware thread count.
+//
+// usage: driver_bench [files] [functions per file]
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "Driver.hpp"
+#include "Timing.hpp"
+
+static void writeSources(const std::filesystem::path& dir, size_t files, size_t functions) {
+	for (size_t f = 0; f < files; ++f) {
+		std::filesystem::path sub = dir / ("module" + std::to_string(f % 8));
+		std::filesystem::create_directories(sub);
+		std::ofstream out(sub / ("file" + std::to_string(f) + ".src"));
+		out << "class Record" << f << " {\n\tfloat x;\n\tfloat y;\n}\n";
+		for (size_t n = 0; n < functions; ++n) {
+			out << "float f" << f << "_" << n << "(float a, Record" << f << " r) {\n"
+				<< "\tfloat total = a * 3 + r.x - 12 / (a + 1);\n"
+				<< "\tfor (i = 0; i < 100; i++) { values[i] = r.y + total * -i; }\n"
+				<< "\twhile (!done) { total = g(total, a + r.x, 4); break; }\n"
+				<< "}\n";
+		}
+	}
+}
+
+int main(int argc, char** argv) {
+	size_t files = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 400;
+	size_t functions = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 500;
+
+	std::filesystem::path dir = std::filesystem::temp_directory_path() / "driver_bench_sources";
+	std::filesystem::remove_all(dir);
+	writeSources(dir, files, functions);
+
+	unsigned maxJobs = std::thread::hardware_concurrency();
+	if (maxJobs == 0) maxJobs = 1;
+
+	double single = 0;
+	size_t declarations = 0;
+	for (unsigned jobs = 1;; jobs = jobs * 2 > maxJobs && jobs < maxJobs ? maxJobs : jobs * 2) {
+		DriverOptions options;
+		options.jobs = jobs;
+		options.inputs = {dir.string()};
+
+		BuildResult build;
+		double secs = bestOf(1, [&] { build = Driver(options).run(); });
+
+		if (build.failures() != 0) {
+			std::cerr << build.failures() << " files failed\n";
+			return 1;
+		}
+		if (jobs == 1) {
+			single = secs;
+			declarations = build.declarations().size();
+		} else if (build.declarations().size() != declarations) {
+			std::cerr << "-j " << jobs << " produced a different merged program\n";
+			return 1;
+		}
+		std::cout << "-j " << jobs << ": " << build.files.size() / secs << " files/s, speedup " << single / secs << "\n";
+		if (jobs >= maxJobs) break;
+	}
+
+	std::filesystem::remove_all(dir);
+	return 0;
+}
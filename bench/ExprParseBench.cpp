@@ -0,0 +1,161 @@
+// Expression parsing: the Pratt loop in BasicParser versus the recursive precedence
+// cascade it replaced (assignment -> comparison -> addition -> multiplication -> unary
+// -> primary), on long operator chains. Both parse the same tokens, the chain wrapped in
+// `float f() { ...; }`, and build the same tree through TreeBuilder.
+//
+// usage: expr_parse_bench [terms]
+
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Parser.hpp"
+#include "Timing.hpp"
+
+// The cascade as it was, reduced to the expression grammar
+class CascadeParser {
+	using Node = ASTNode*;
+	TokenCursor cursor;
+	TreeBuilder b;
+
+public:
+	CascadeParser(std::string_view source, std::span<const CompactToken> tokens) : cursor(source, tokens) {}
+
+	Program* parse() {
+		b.begin();
+		b.addTopLevel(parseFunction());
+		return b.finish();
+	}
+
+private:
+	// Token access mirrors Parser's navigation helpers, so only the expression strategy differs
+	const CompactToken& peek() const { return cursor.peek(); }
+	const CompactToken& advance() { return cursor.advance(); }
+
+	bool checkOp(std::initializer_list<OpKind> ops) const {
+		if (cursor.isAtEnd() || peek().type != TokenType::_operator) return false;
+		for (OpKind op : ops) if (peek().op == op) return true;
+		return false;
+	}
+	SourceSpan spanFrom(size_t start) const {
+		return {static_cast<uint32_t>(start), static_cast<uint32_t>(cursor.position())};
+	}
+
+	// Just the `float f() { <expression>; }` wrapper, built as Parser builds it
+	Node parseFunction() {
+		size_t start = cursor.position();
+		Symbol returnType = advance().symbol;
+		Symbol name = advance().symbol;
+		advance();	// '('
+		advance();	// ')'
+		size_t bodyStart = cursor.position();
+		advance();	// '{'
+		Node statement = parseAssignment();
+		advance();	// ';'
+		advance();	// '}'
+		Node body = b.compound(spanFrom(bodyStart), {&statement, 1});
+		return b.function(spanFrom(start), name, {}, returnType, body);
+	}
+
+	Node parseAssignment() {
+		size_t start = cursor.position();
+		Node left = parseComparison();
+		if (checkOp({OpKind::Assign})) {
+			OpKind op = advance().op;
+			return b.binary(spanFrom(start), op, left, parseAssignment());
+		}
+		return left;
+	}
+	Node parseComparison() {
+		size_t start = cursor.position();
+		Node left = parseAddition();
+		while (checkOp({OpKind::Equal, OpKind::NotEqual, OpKind::Less, OpKind::LessEqual, OpKind::Greater, OpKind::GreaterEqual})) {
+			OpKind op = advance().op;
+			left = b.binary(spanFrom(start), op, left, parseAddition());
+		}
+		return left;
+	}
+	Node parseAddition() {
+		size_t start = cursor.position();
+		Node left = parseMultiplication();
+		while (checkOp({OpKind::Add, OpKind::Sub})) {
+			OpKind op = advance().op;
+			left = b.binary(spanFrom(start), op, left, parseMultiplication());
+		}
+		return left;
+	}
+	Node parseMultiplication() {
+		size_t start = cursor.position();
+		Node left = parseUnary();
+		while (checkOp({OpKind::Mul, OpKind::Div, OpKind::Mod, OpKind::Pow})) {
+			OpKind op = advance().op;
+			left = b.binary(spanFrom(start), op, left, parseUnary());
+		}
+		return left;
+	}
+	Node parseUnary() {
+		if (checkOp({OpKind::Increment, OpKind::Decrement, OpKind::Sub, OpKind::Not})) {
+			size_t start = cursor.position();
+			OpKind op = advance().op;
+			return b.prefix(spanFrom(start), op, parseUnary());
+		}
+		return parsePrimary();
+	}
+	Node parsePrimary() {
+		size_t start = cursor.position();
+		const CompactToken& token = advance();
+		if (token.type == TokenType::int_lit) {
+			std::string_view text = cursor.text(token);
+			int value = 0;
+			std::from_chars(text.data(), text.data() + text.size(), value);
+			return b.literal(spanFrom(start), value);
+		}
+		if (token.type == TokenType::identifier) return b.variable(spanFrom(start), token.symbol);
+		Node inner = parseAssignment();	// '('
+		advance();						// ')'
+		return inner;
+	}
+};
+
+struct Chain {
+	std::string source;
+	std::vector<CompactToken> tokens;
+};
+
+// Tokens of `prefix <chain> suffix`; the chain cycles through every precedence level
+static Chain chainTokens(size_t terms, const std::string& prefix, const std::string& suffix) {
+	static const char* ops[] = {"+", "*", "-", "/", "<", "%", "+", "==", "-", "^"};
+	std::string source = prefix + "a0";
+	for (size_t i = 1; i < terms; ++i) {
+		source += ' ';
+		source += ops[i % std::size(ops)];
+		source += (i % 3 == 0) ? " 42" : " a" + std::to_string(i % 64);
+	}
+	source += suffix;
+	Lexer lexer;
+	std::vector<CompactToken> tokens = lexer.tokenizeBuffer(source);
+	return {std::move(source), std::move(tokens)};
+}
+
+static constexpr int rounds = 15;
+
+int main(int argc, char** argv) {
+	size_t terms = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+
+	Chain chain = chainTokens(terms, "float f() { ", "; }");
+
+	// Best of alternating rounds, so drift on a shared machine hits both parsers alike
+	double cascade = 1e30, pratt = 1e30;
+	for (int r = 0; r < rounds; ++r) {
+		cascade = std::min(cascade, bestOf(1, [&] { delete CascadeParser(chain.source, chain.tokens).parse(); }));
+		pratt = std::min(pratt, bestOf(1, [&] { delete Parser(chain.source, chain.tokens).Parse(); }));
+	}
+
+	std::cout << terms << " terms\n";
+	std::cout << "cascade: " << terms / cascade / 1e6 << " M terms/s\n";
+	std::cout << "pratt:   " << terms / pratt / 1e6 << " M terms/s\n";
+	return 0;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <sstream>
+#include <string>
+
+#include "FlatAst.hpp"
+
+// Fixed-text programs shared by the benchmarks that need one exact construct mix rather
+// than a SourceShape from SourceGenerator.hpp, and the AST comparison they check with.
+
+// One class Point, then `functions` functions using every operator kind, indexing, field
+// access, calls, loops and break. Parses; names such as values, p and g<n> are never
+// declared, so it does not resolve.
+inline std::string pointFunctions(size_t functions) {
+	std::ostringstream out;
+	out << "class Point {\n\tfloat x;\n\tfloat y;\n}\n";
+	for (size_t n = 0; n < functions; ++n) {
+		out << "float f" << n << "(float a, float b) {\n"
+			<< "\tfloat total = a * 3 + b - 12 / (a + 1);\n"
+			<< "\tfor (i = 0; i < 100; i++) {\n"
+			<< "\t\ttotal = total >= b * 2 == 1 - a % 7;\n"
+			<< "\t\tvalues[i] = p.x + p.y * -total;\n"
+			<< "\t}\n"
+			<< "\twhile (!done) { total = g" << n % 97 << "(total, a + b, 4); break; }\n"
+			<< "\ttotal = total ^ 2;\n"
+			<< "\treturn total;\n"
+			<< "}\n";
+	}
+	return out.str();
+}
+
+// A class Record<n> every 100 functions and `functions` functions taking the latest one,
+// copying it, reading its fields and calling the group's first function. Resolves and
+// type-checks without errors.
+inline std::string recordFunctions(size_t functions) {
+	std::ostringstream out;
+	for (size_t n = 0; n < functions; ++n) {
+		if (n % 100 == 0) out << "class Record" << n << " {\n\tfloat x;\n\tfloat y;\n}\n";
+		std::string record = "Record" + std::to_string(n / 100 * 100);
+		out << "float f" << n << "(float a, " << record << " r) {\n"
+			<< "\t" << record << " copy = r;\n"
+			<< "\tfloat total = a * 3 + copy.x - 12 / (a + 1);\n"
+			<< "\tfloat i = 0;\n"
+			<< "\tfor (i = 0; i < 100; i++) { total = total + r.y * -i; }\n"
+			<< "\twhile (total > a) { total = f" << n / 100 * 100 << "(total, r) - a; break; }\n"
+			<< "\treturn total;\n"
+			<< "}\n";
+	}
+	return out.str();
+}
+
+// Same nodes, payloads and token spans in the same order
+inline bool sameAst(const FlatAst& a, const FlatAst& b) {
+	if (a.size() != b.size() || a.extra != b.extra || a.roots != b.roots) return false;
+	for (size_t i = 0; i < a.size(); ++i) {
+		const NodeData& x = a.data[i];
+		const NodeData& y = b.data[i];
+		if (a.kinds[i] != b.kinds[i] || x.a != y.a || x.b != y.b || x.c != y.c) return false;
+		if (a.spans[i].firstToken != b.spans[i].firstToken || a.spans[i].endToken != b.spans[i].endToken) return false;
+	}
+	return true;
+}
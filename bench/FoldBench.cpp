@@ -0,0 +1,83 @@
+// Constant folding on generated code full of literal arithmetic and identities: nodes
+// eliminated, fold time, and the bytecode size and VM run time with and without the pass.
+//
+// usage: fold_bench [functions]
+
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "BytecodeCompiler.hpp"
+#include "ConstantFolder.hpp"
+#include "Parser.hpp"
+#include "Resolver.hpp"
+#include "Timing.hpp"
+#include "TypeChecker.hpp"
+#include "VM.hpp"
+
+static std::string makeSource(size_t functions) {
+	std::ostringstream out;
+	for (size_t n = 0; n < functions; ++n) {
+		out << "float f" << n << "(float x) {\n"
+			<< "\tfloat scale = (2 * 8 - 6) / (1 + 1) * 1;\n"
+			<< "\tfloat total = 0 * x + 0;\n"
+			<< "\tfloat i = 0;\n"
+			<< "\tfor (i = 0; i < 200 + 0; i++) {\n"
+			<< "\t\ttotal = total + (i * 1 + 0) * scale + x ^ 2 - (4 - 2 * 2) + i ^ 1 * (3 > 2);\n"
+			<< "\t}\n"
+			<< "\treturn total / 1;\n"
+			<< "}\n";
+	}
+	return out.str();
+}
+
+// types must outlive the program: frame types point into it
+static Program* build(const std::string& source, const std::vector<CompactToken>& tokens, TypeContext& types) {
+	Program* program = Parser(source, tokens).Parse();
+	Resolver().resolve(*program);
+	TypeChecker checker(types);
+	if (!checker.check(*program)) throw std::runtime_error("type errors in the generated program");
+	return program;
+}
+
+int main(int argc, char** argv) {
+	size_t functions = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000;
+	std::string source = makeSource(functions);
+	Lexer lexer;
+	std::vector<CompactToken> tokens = lexer.tokenizeBuffer(source);
+
+	TypeContext types;
+	Program* plain = build(source, tokens, types);
+	Program* folded = build(source, tokens, types);
+	ConstantFolder folder;
+	double foldTime = bestOf(1, [&] { folder.fold(*folded); });
+	std::cout << functions << " functions: " << folder.eliminated() << " nodes eliminated by " << folder.rewrites()
+			  << " rewrites in " << foldTime * 1e3 << " ms\n";
+
+	BytecodeModule before = BytecodeCompiler().compile(*plain);
+	BytecodeModule after = BytecodeCompiler().compile(*folded);
+	std::cout << "bytecode: " << before.instructionCount() << " -> " << after.instructionCount() << " instructions\n";
+
+	VM plainVm(before), foldedVm(after);
+	Value args[] = {Value{1.5}};
+	double plainSum = 0, foldedSum = 0;
+	double plainTime = bestOf(3, [&] {
+		plainSum = 0;
+		for (uint32_t f = 0; f < before.functions.size(); ++f) plainSum += plainVm.call(f, args).number;
+	});
+	double foldedTime = bestOf(3, [&] {
+		foldedSum = 0;
+		for (uint32_t f = 0; f < after.functions.size(); ++f) foldedSum += foldedVm.call(f, args).number;
+	});
+	if (plainSum != foldedSum) {
+		std::cerr << "results differ: " << plainSum << " / " << foldedSum << "\n";
+		return 1;
+	}
+	std::cout << "vm: " << plainTime * 1e3 << " ms -> " << foldedTime * 1e3 << " ms, speedup " << plainTime / foldedTime << "x\n";
+	delete plain;
+	delete folded;
+	return 0;
+}
@@ -0,0 +1,113 @@
+// Edit-to-AST latency of IncrementalParser on a large generated file: changing a literal,
+// adding and removing a statement, inserting a function and nesting a loop body, against
+// lexing and parsing the whole file once. The final tokens must match a fresh lex, and the
+// AST, spans included, a fresh parse.
+//
+// usage: incremental_parse_bench [functions] [edits]
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Fixtures.hpp"
+#include "IncrementalParse.hpp"
+#include "Timing.hpp"
+
+static std::string makeSource(size_t functions) {
+	std::ostringstream out;
+	out << "class Point {\n\tfloat x;\n\tfloat y;\n}\n";
+	for (size_t n = 0; n < functions; ++n) {
+		out << "float f" << n << "(float a, Point p) {\n"
+			<< "\tfloat t = a * 3 + p.x;\n"
+			<< "\tPoint q = p;\n"
+			<< "\tfor (i = 0; i < 10; i++) { t = t + i; }\n"
+			<< "\treturn t;\n"
+			<< "}\n";
+	}
+	return out.str();
+}
+
+static bool sameTokens(const std::vector<CompactToken>& a, const std::vector<CompactToken>& b) {
+	return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const CompactToken& x, const CompactToken& y) {
+		return x.type == y.type && x.op == y.op && x.offset == y.offset && x.length == y.length && x.line == y.line &&
+			   x.column == y.column && x.symbol == y.symbol;
+	});
+}
+
+int main(int argc, char** argv) {
+	size_t functions = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000;
+	size_t edits = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 2000;
+	std::string text = makeSource(functions);
+
+	double parseTime = millisecondsOf([&] {
+		std::vector<CompactToken> tokens = Lexer().tokenizeBuffer(text);
+		delete Parser(text, tokens).Parse();
+	});
+	std::unique_ptr<IncrementalParser> parser;
+	double loadTime = millisecondsOf([&] { parser = std::make_unique<IncrementalParser>(text); });
+
+	std::mt19937 rng(1);
+	std::vector<double> latencies;
+	size_t fullRebuilds = 0;
+	for (size_t i = 0; latencies.size() < edits && i < edits * 2; ++i) {
+		size_t from = rng() % text.size();
+		size_t offset = std::string::npos, length = 0;
+		std::string replacement;
+		switch (i % 5) {
+			case 0:
+				offset = text.find("* 3", from);
+				if (offset != std::string::npos) offset += 2, length = 1, replacement = std::to_string(rng() % 100);
+				break;
+			case 1:
+				offset = text.find("\treturn", from);
+				replacement = "\tt = t - 1;\n";
+				break;
+			case 2:
+				offset = text.find("\nfloat f", from);
+				if (offset != std::string::npos) offset += 1, replacement = "float g" + std::to_string(i) + "(float z) { return z; }\n";
+				break;
+			case 3:
+				offset = text.find("\tt = t - 1;\n", from);
+				length = 12;
+				break;
+			case 4:
+				offset = text.find("{ t = t + i; }", from);
+				length = 1;
+				replacement = "{ if (t > 3) { break; } ";
+				break;
+		}
+		if (offset == std::string::npos) continue;
+		IncrementalParser::EditStats stats;
+		latencies.push_back(millisecondsOf([&] { stats = parser->edit(offset, length, replacement); }));
+		fullRebuilds += stats.fullRebuild;
+		text.replace(offset, length, replacement);
+	}
+
+	std::sort(latencies.begin(), latencies.end());
+	double total = 0;
+	for (double ms : latencies) total += ms;
+	std::cout << text.size() / 1e6 << " MB, " << parser->declarationCount() << " declarations\n";
+	std::cout << "lex + parse whole file: " << parseTime << " ms (incremental load " << loadTime << " ms)\n";
+	std::cout << latencies.size() << " edits: mean " << total / static_cast<double>(latencies.size()) << " ms, p50 "
+			  << latencies[latencies.size() / 2] << " ms, p99 " << latencies[latencies.size() * 99 / 100] << " ms, max "
+			  << latencies.back() << " ms, " << fullRebuilds << " full rebuilds\n";
+
+	std::vector<CompactToken> tokens = Lexer().tokenizeBuffer(text);
+	std::vector<CompactToken> kept = parser->tokens();
+	if (!parser->ok() || parser->text() != text || !sameTokens(kept, tokens)) {
+		std::cerr << "incremental tokens differ from a fresh lex\n";
+		return 1;
+	}
+	// The class tree has no spans, so those are checked on a flat parse of the kept tokens
+	std::unique_ptr<Program> fresh(Parser(text, tokens).Parse());
+	if (!sameAst(toFlatAst(*fresh), toFlatAst(parser->program())) ||
+		!sameAst(FlatParser(text, tokens).Parse(), FlatParser(text, kept).Parse())) {
+		std::cerr << "incremental AST differs from a fresh parse\n";
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,197 @@
+// Lexer throughput on a large synthetic source: the original per-line lexer versus the
+// buffer lexer with the scalar, SSE2 and AVX2 scanning paths.
+//
+// usage: lexer_scan_bench [megabytes]
+
+#include <cctype>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Lexer.hpp"
+#include "Timing.hpp"
+
+// The lexer as it was before the buffer lexer, copied from the baseline: one line at a
+// time, <cctype> classification, a std::string per token and the unordered_map keyword
+// lookup. Only Token itself is today's, with the symbol and op fields it has gained.
+static const std::unordered_map<std::string, TokenType> baselineKeywords = {
+        {"def", TokenType::_function},
+        {"if", TokenType::_if},
+        {"else", TokenType::_else},
+        {"for", TokenType::_for},
+        {"while", TokenType::_while},
+        {"return", TokenType::_return},
+        {"true", TokenType::_true},
+        {"false", TokenType::_false},
+        {"break", TokenType::_break},
+        {"continue", TokenType::_continue},
+        {"let", TokenType::_let},
+};
+
+static Token baselineMapStringToToken(const std::string &input, int line) {
+    Token token;
+    token.line = line;
+    token.value = input;
+
+    // Look up in keyword map
+    auto it = baselineKeywords.find(input);
+    if (it != baselineKeywords.end()) {
+        token.type = it->second;
+    } else {
+        token.type = TokenType::identifier;
+    }
+    return token;
+}
+
+static bool baselineIsOperatorChar(char c) {
+    static const std::string operatorChars = "+-*/%^<>=!.";
+    return operatorChars.find(c) != std::string::npos;
+}
+
+static std::vector<Token> baselineTokenize(const std::vector<std::string>& file) {
+    std::vector<Token> tokens;
+    int lineNum = 1;
+
+    for (const std::string& line : file) {
+        size_t i = 0;
+        while (i < line.size()) {
+            char c = line[i];
+
+            // Skip whitespace
+            if (std::isspace(c)) {
+                ++i;
+                continue;
+            }
+
+            // Handle words (identifiers or keywords)
+            if (std::isalpha(c)) {
+                size_t start = i;
+                while (i < line.size() && (std::isalnum(line[i]) || line[i] == '_')) {
+                    ++i;
+                }
+                std::string word = line.substr(start, i - start);
+                tokens.push_back(baselineMapStringToToken(word, lineNum));
+                continue;
+            }
+
+            // Handle integer literals
+            if (std::isdigit(c)) {
+                size_t start = i;
+                while (i < line.size() && (std::isdigit(line[i]) || line[i] == '.')) {
+                    ++i;
+                }
+                std::string number = line.substr(start, i - start);
+                Token token;
+                token.line = lineNum;
+                token.value = number;
+                token.type = TokenType::int_lit;
+                tokens.push_back(token);
+                continue;
+            }
+
+            // Handle operators
+            if (baselineIsOperatorChar(c)) {
+                size_t start = i;
+                while (i < line.size() && baselineIsOperatorChar(line[i])) {
+                    ++i;
+                }
+                std::string op = line.substr(start, i - start);
+                Token token;
+                token.line = lineNum;
+                token.value = op;
+                token.type = TokenType::_operator;
+                tokens.push_back(token);
+                continue;
+            }
+
+            // Handle punctuation and operators (single-character tokens for now)
+            {
+                Token token;
+                token.line = lineNum;
+                token.value = std::string(1, c);
+
+                switch(c) {
+                    case '(': token.type = TokenType::o_paren; break;
+                    case ')': token.type = TokenType::c_paren; break;
+                    case '{': token.type = TokenType::o_brace; break;
+                    case '}': token.type = TokenType::c_brace; break;
+                    case '[': token.type = TokenType::o_bracket; break;
+                    case ']': token.type = TokenType::c_bracket; break;
+                    case ';': token.type = TokenType::semicolon; break;
+                    case ',': token.type = TokenType::comma; break;
+                    case ':': token.type = TokenType::colon; break;
+                    default:
+                        token.type = TokenType::_unknown;
+                        break;
+                }
+                tokens.push_back(token);
+                ++i; // Move past the current character
+            }
+        }
+        ++lineNum;
+    }
+    return tokens;
+}
+
+static std::string makeSource(size_t targetBytes) {
+	std::ostringstream out;
+	size_t n = 0;
+	while (static_cast<size_t>(out.tellp()) < targetBytes) {
+		out << "class Record_" << n << " {\n"
+			<< "\tfloat first_field_" << n << ";\n"
+			<< "\tfloat second_field_" << n << ";\n"
+			<< "}\n\n"
+			<< "float compute_value_" << n << "(float alpha, float beta_coefficient) {\n"
+			<< "\tfloat accumulator = alpha * 1024 + beta_coefficient / 3.25;\n"
+			<< "\tfor (counter = 0; counter <= 1000; counter++) {\n"
+			<< "\t\taccumulator = accumulator + counter % 7 - (alpha ^ 2);\n"
+			<< "\t}\n"
+			<< "\twhile (accumulator >= beta_coefficient) { accumulator = accumulator - 1; }\n"
+			<< "\treturn accumulator;\n"
+			<< "}\n\n";
+		++n;
+	}
+	return out.str();
+}
+
+static std::vector<std::string> splitLines(const std::string& source) {
+	std::vector<std::string> lines;
+	std::istringstream in(source);
+	std::string line;
+	while (std::getline(in, line)) lines.push_back(line);
+	return lines;
+}
+
+template<class F>
+static void run(const char* name, size_t bytes, F&& body) {
+	size_t count = 0;
+	double best = bestOf(5, [&] { count = body(); });
+	std::cout << name << ": " << (bytes / (1024.0 * 1024.0)) / best << " MB/s (" << count << " tokens)\n";
+}
+
+int main(int argc, char** argv) {
+	size_t megabytes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 32;
+	std::string source = makeSource(megabytes * 1024 * 1024);
+	std::vector<std::string> lines = splitLines(source);
+	Lexer lexer;
+
+	run("baseline per-line lexer", source.size(), [&] { return baselineTokenize(lines).size(); });
+	run("tokenize() adapter      ", source.size(), [&] { return lexer.tokenize(lines).size(); });
+
+	const charscan::ScanLevel detected = charscan::activeLevel;
+	const std::pair<charscan::ScanLevel, const char*> levels[] = {
+		{charscan::ScanLevel::Scalar, "buffer lexer, scalar    "},
+		{charscan::ScanLevel::SSE2,   "buffer lexer, SSE2      "},
+		{charscan::ScanLevel::AVX2,   "buffer lexer, AVX2      "},
+	};
+	for (auto& [level, name] : levels) {
+		if (level > detected) continue;
+		charscan::activeLevel = level;
+		run(name, source.size(), [&] { return lexer.tokenizeBuffer(source).size(); });
+	}
+	charscan::activeLevel = detected;
+	return 0;
+}
@@ -0,0 +1,131 @@
+// Native code from the x86-64 backend against the threaded VM on the vm_bench kernels.
+// The optimized IR is emitted as assembly through FManager, assembled into a shared
+// object with the host C compiler and loaded with dlopen; both must agree on every result.
+//
+// usage: native_bench [scale] [work directory]
+
+#include <cmath>
+#include <cstdlib>
+#include <dlfcn.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "BytecodeCompiler.hpp"
+#include "ConstantPropagation.hpp"
+#include "DeadCodeElimination.hpp"
+#include "IRBuilder.hpp"
+#include "Parser.hpp"
+#include "Resolver.hpp"
+#include "Timing.hpp"
+#include "TypeChecker.hpp"
+#include "VM.hpp"
+#include "ValueNumbering.hpp"
+#include "X86Emitter.hpp"
+
+static const char* source = R"(
+float fib(float n) {
+	if (n < 2) { return n; }
+	return fib(n - 1) + fib(n - 2);
+}
+
+float loops(float n) {
+	float total = 0;
+	float i = 0;
+	for (i = 0; i < n; i++) {
+		float j = 0;
+		while (j < 100) {
+			if (j % 3 == 0) { total = total + j; } else { total = total - 1; }
+			j++;
+		}
+	}
+	return total;
+}
+
+float arraySum(float n) {
+	float[] values = array(n);
+	float i = 0;
+	for (i = 0; i < length(values); i++) { values[i] = i * 2 + 1; }
+	float total = 0;
+	float pass = 0;
+	for (pass = 0; pass < 10; pass++) {
+		for (i = 0; i < length(values); i++) { total = total + values[i]; }
+	}
+	return total;
+}
+)";
+
+int main(int argc, char** argv) {
+	double scale = argc > 1 ? std::strtod(argv[1], nullptr) : 1;
+	std::string directory = argc > 2 ? argv[2] : "/tmp";
+	std::string text = source;
+	Lexer lexer;
+	std::vector<CompactToken> tokens = lexer.tokenizeBuffer(text);
+	Program* program = Parser(text, tokens).Parse();
+	Resolver().resolve(*program);
+	TypeContext types;
+	TypeChecker checker(types);
+	if (!checker.check(*program)) {
+		for (const Diagnostic& diagnostic : checker.diagnostics()) std::cerr << diagnostic << "\n";
+		return 1;
+	}
+	BytecodeModule bytecode = BytecodeCompiler().compile(*program);
+	IRModule module = IRBuilder().build(*program);
+	PassManager passes;
+	passes.add<SparseConditionalConstantPropagation>().add<GlobalValueNumbering>().add<DeadCodeElimination>();
+	passes.run(module);
+
+	X86Emitter emitter;
+	std::string assembly;
+	double emitTime = bestOf(1, [&] { assembly = emitter.emit(module); });
+	std::cout << module.instructionCount() << " IR instructions -> " << assembly.size() << " bytes of assembly in "
+			  << emitTime * 1e6 << " us\n";
+
+	FManager files(directory);
+	if (!files.writeFile("native_bench.s", assembly)) {
+		std::cerr << "cannot write " << directory << "/native_bench.s\n";
+		return 1;
+	}
+	std::string object = directory + "/native_bench.so";
+	std::string command = "cc -shared -fPIC -o " + object + " " + directory + "/native_bench.s";
+	if (std::system(command.c_str()) != 0) {
+		std::cerr << "assembling failed: " << command << "\n";
+		return 1;
+	}
+	void* library = dlopen(object.c_str(), RTLD_NOW);
+	if (!library) {
+		std::cerr << dlerror() << "\n";
+		return 1;
+	}
+
+	struct Kernel {
+		const char* name;
+		double argument;
+	};
+	const Kernel kernels[] = {
+		{"fib", 25 + (scale > 1 ? std::log2(scale) * 1.44 : 0)},
+		{"loops", 20000 * scale},
+		{"arraySum", 200000 * scale},
+	};
+
+	VM vm(bytecode);
+	for (const Kernel& kernel : kernels) {
+		uint32_t function = static_cast<uint32_t>(bytecode.find(intern(kernel.name)));
+		auto native = reinterpret_cast<double (*)(double)>(dlsym(library, kernel.name));
+		Value args[] = {Value{std::floor(kernel.argument)}};
+		Value interpreted;
+		double compiled = 0;
+		double vmTime = bestOf(3, [&] { interpreted = vm.call(function, args); });
+		double nativeTime = bestOf(3, [&] { compiled = native(args[0].number); });
+		if (compiled != interpreted.number) {
+			std::cerr << kernel.name << ": results differ: " << compiled << " / " << interpreted.number << "\n";
+			return 1;
+		}
+		std::cout << kernel.name << "(" << args[0].number << ") = " << compiled << "\n"
+				  << "  native " << nativeTime * 1e3 << " ms, vm threaded " << vmTime * 1e3 << " ms, speedup "
+				  << vmTime / nativeTime << "x\n";
+	}
+	dlclose(library);
+	delete program;
+	return 0;
+}
@@ -0,0 +1,45 @@
+// One large file parsed sequentially and with parseParallel at increasing thread
+// counts. Each parallel result must be the same AST as the sequential one.
+//
+// usage: parallel_parse_bench [functions]
+
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Fixtures.hpp"
+#include "ParallelParse.hpp"
+#include "Timing.hpp"
+
+int main(int argc, char** argv) {
+	size_t functions = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+	std::string source = recordFunctions(functions);
+	Lexer lexer;
+	std::vector<CompactToken> tokens = lexer.tokenizeBuffer(source);
+
+	std::unique_ptr<Program> reference(Parser(source, tokens).Parse());
+	const size_t declarations = reference->Code.size();
+	const FlatAst expected = toFlatAst(*reference);
+	reference.reset();
+
+	double sequential = bestOf(3, [&] { delete Parser(source, tokens).Parse(); });
+	std::cout << tokens.size() << " tokens, " << declarations << " declarations\n";
+	std::cout << "sequential: " << tokens.size() / sequential / 1e6 << " M tokens/s\n";
+
+	unsigned maxThreads = std::thread::hardware_concurrency();
+	if (maxThreads < 2) maxThreads = 2;
+	for (unsigned threads = 2; threads <= maxThreads; threads *= 2) {
+		ThreadPool pool(threads);
+		std::unique_ptr<Program> program;
+		double secs = bestOf(3, [&] { program.reset(parseParallel(source, tokens, pool)); });
+		if (!sameAst(toFlatAst(*program), expected)) {
+			std::cerr << "parallel parse on " << threads << " threads differs from the sequential parse\n";
+			return 1;
+		}
+		std::cout << threads << " threads: " << tokens.size() / secs / 1e6 << " M tokens/s, speedup "
+				  << sequential / secs << "\n";
+	}
+	return 0;
+}
@@ -0,0 +1,49 @@
+// Heap allocations made while parsing, counted by AllocationCounter.hpp.
+// Token navigation in the parser must not allocate, so the count per token should stay
+// near zero: what remains is node storage growth and per-block/per-call child lists, plus,
+// for owned Tokens, the packed text buffer and compact token array built by the constructor.
+//
+// usage: parse_alloc_bench [functions]
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "AllocationCounter.hpp"
+#include "Fixtures.hpp"
+#include "Parser.hpp"
+#include "Timing.hpp"
+
+// Counts from before the parser is constructed, so packing owned tokens is included
+template<class P, class... Args>
+static void report(const char* name, size_t tokenCount, Args&&... args) {
+	size_t before = allocations;
+	decltype(std::declval<P&>().Parse()) result{};
+	double secs = millisecondsOf([&] {
+		P parser(std::forward<Args>(args)...);
+		result = parser.Parse();
+	}) / 1e3;
+	size_t made = allocations - before;
+
+	std::cout << name << ": " << made << " allocations, "
+			  << static_cast<double>(made) / tokenCount << " per token, "
+			  << tokenCount / secs / 1e6 << " M tokens/s\n";
+	if constexpr (std::is_pointer_v<decltype(result)>) delete result;
+}
+
+int main(int argc, char** argv) {
+	size_t functions = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000;
+
+	std::string source = pointFunctions(functions);
+	Lexer lexer;
+	std::vector<CompactToken> compact = lexer.tokenizeBuffer(source);
+	std::vector<Token> tokens = Lexer::toTokens(source, compact);
+
+	std::cout << compact.size() << " tokens\n";
+	report<Parser>("tree, owned tokens", compact.size(), std::move(tokens));
+	report<Parser>("tree, borrowed    ", compact.size(), source, std::span<const CompactToken>(compact));
+	report<FlatParser>("flat, borrowed    ", compact.size(), source, std::span<const CompactToken>(compact));
+	return 0;
+}
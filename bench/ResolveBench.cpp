@@ -0,0 +1,105 @@
+// Name resolution on functions with thousands of locals and deeply nested blocks. Times
+// the Resolver over a parsed program, and the SymbolTable against the usual stack of
+// per-scope hash maps on the same declare / lookup / pop sequence.
+//
+// usage: resolve_bench [locals] [depth]
+
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Parser.hpp"
+#include "Resolver.hpp"
+#include "Timing.hpp"
+
+// Every function declares `locals` variables, then nests `depth` blocks that each shadow
+// one of them and read a few outer ones
+static std::string makeSource(size_t functions, size_t locals, size_t depth) {
+	std::ostringstream out;
+	for (size_t f = 0; f < functions; ++f) {
+		out << "float f" << f << "(float a) {\n";
+		for (size_t i = 0; i < locals; ++i) out << "\tfloat v" << i << " = a + " << i << ";\n";
+		for (size_t d = 0; d < depth; ++d) {
+			out << "{ float v" << d % locals << " = v" << (d + 1) % locals << " * v" << (d * 7) % locals
+				<< "; a = f" << f << "(v" << d % locals << ");\n";
+		}
+		for (size_t d = 0; d < depth; ++d) out << "}";
+		out << "\n}\n";
+	}
+	return out.str();
+}
+
+// The design the flat table replaces: one map per open scope, searched innermost first
+class ScopeChain {
+	std::vector<std::unordered_map<Symbol, Slot>> scopes;
+
+public:
+	void pushScope() { scopes.emplace_back(); }
+	void popScope() { scopes.pop_back(); }
+	bool declare(Symbol name, Slot slot) { return scopes.back().emplace(name, slot).second; }
+	const Slot* lookup(Symbol name) const {
+		for (auto it = scopes.rbegin(); it != scopes.rend(); ++it) {
+			auto found = it->find(name);
+			if (found != it->end()) return &found->second;
+		}
+		return nullptr;
+	}
+};
+
+// Same operation sequence for both tables: `locals` declarations, then `depth` nested
+// scopes each declaring one name and looking up three, then unwinding
+template<class Table, class Lookup>
+static size_t drive(Table& table, Lookup&& lookup, const std::vector<Symbol>& names, size_t depth) {
+	size_t found = 0;
+	table.pushScope();
+	for (uint32_t i = 0; i < names.size(); ++i) table.declare(names[i], Slot{Slot::Local, i});
+	for (size_t d = 0; d < depth; ++d) {
+		table.pushScope();
+		table.declare(names[d % names.size()], Slot{Slot::Local, static_cast<uint32_t>(names.size() + d)});
+		found += lookup(table, names[(d + 1) % names.size()]);
+		found += lookup(table, names[(d * 7) % names.size()]);
+		found += lookup(table, names[d % names.size()]);
+	}
+	for (size_t d = 0; d <= depth; ++d) table.popScope();
+	return found;
+}
+
+int main(int argc, char** argv) {
+	size_t locals = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 5000;
+	size_t depth = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 2000;
+	if (locals == 0) locals = 1;
+
+	std::vector<Symbol> names;
+	for (size_t i = 0; i < locals; ++i) names.push_back(intern("v" + std::to_string(i)));
+
+	size_t found = 0;
+	double chain = bestOf(5, [&] {
+		ScopeChain table;
+		found = drive(table, [](const ScopeChain& t, Symbol s) { return t.lookup(s) != nullptr; }, names, depth);
+	});
+	size_t flatFound = 0;
+	double flat = bestOf(5, [&] {
+		SymbolTable<Slot> table;
+		flatFound = drive(table, [](const SymbolTable<Slot>& t, Symbol s) { return t.lookup(s) != nullptr; }, names, depth);
+	});
+	if (found != flatFound) {
+		std::cerr << "tables disagree: " << found << " vs " << flatFound << " names found\n";
+		return 1;
+	}
+	std::cout << "scope chain:  " << chain * 1e3 << " ms\n";
+	std::cout << "flat table:   " << flat * 1e3 << " ms, speedup " << chain / flat << "\n";
+
+	std::string source = makeSource(20, locals, depth);
+	Lexer lexer;
+	std::vector<CompactToken> tokens = lexer.tokenizeBuffer(source);
+	Program* program = Parser(source, tokens).Parse();
+	Resolver resolver;
+	double resolve = bestOf(5, [&] { resolver.resolve(*program); });
+	std::cout << "resolver:     " << resolve * 1e3 << " ms for " << tokens.size() << " tokens ("
+			  << tokens.size() / resolve / 1e6 << " M tokens/s), frame size " << resolver.functions()[0]->frameSize << "\n";
+	delete program;
+	return 0;
+}
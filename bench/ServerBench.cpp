@@ -0,0 +1,89 @@
+// Request latency of a CompileServer running in this process: the first check of each
+// generated file (lex, parse, resolve, type check) against repeated checks of the same
+// unchanged files, which are answered from memory, then a compile of each, all through
+// the socket. A file with a class value is compiled twice; both requests must fail and
+// every compile request must appear in the server's latency stats.
+//
+// usage: server_bench [files] [functions per file]
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CompileServer.hpp"
+#include "Timing.hpp"
+
+static void writeSource(const std::filesystem::path& path, size_t functions) {
+	std::ofstream out(path);
+	for (size_t n = 0; n < functions; ++n) {
+		out << "float f" << n << "(float x, float[] data) {\n"
+			<< "\tfloat total = 0;\n"
+			<< "\tfloat i = 0;\n"
+			<< "\tfor (i = 0; i < length(data); i++) {\n"
+			<< "\t\tif (data[i] > x) { total = total + data[i] * 2; } else { total = total - 1; }\n"
+			<< "\t}\n";
+		if (n > 0) out << "\ttotal = total + f" << n - 1 << "(x - 1, data);\n";
+		out << "\treturn total;\n"
+			<< "}\n";
+	}
+}
+
+int main(int argc, char** argv) {
+	size_t files = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 16;
+	size_t functions = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 2000;
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / "server_bench";
+	std::filesystem::create_directories(directory);
+	std::vector<std::string> paths;
+	for (size_t f = 0; f < files; ++f) {
+		paths.push_back((directory / ("file" + std::to_string(f) + ".src")).string());
+		writeSource(paths.back(), functions);
+	}
+
+	const std::string socket = (directory / "server.sock").string();
+	CompileServer server(socket);
+	std::thread serving([&] { server.serve(); });
+
+	const std::string classPath = (directory / "class.src").string();
+	std::ofstream(classPath) << "class P {\n\tfloat x;\n}\nfloat g(P p) {\n\treturn p.x;\n}\n";
+
+	bool ok = true;
+	auto checkAll = [&] {
+		for (const std::string& path : paths) ok &= sendCompileRequest(socket, "check " + path).starts_with("ok\n");
+	};
+	double cold = millisecondsOf(checkAll);
+	const int rounds = 10;
+	double warm = millisecondsOf([&] { for (int r = 0; r < rounds; ++r) checkAll(); }) / rounds;
+	double compile = millisecondsOf([&] {
+		for (const std::string& path : paths) ok &= sendCompileRequest(socket, "compile " + path).starts_with("ok\n");
+	});
+	for (int r = 0; r < 2; ++r) {
+		if (!sendCompileRequest(socket, "compile " + classPath).starts_with("error\n")) {
+			std::cerr << "compiling a class value did not fail\n";
+			ok = false;
+		}
+	}
+	std::string stats = sendCompileRequest(socket, "stats").substr(3);
+	if (stats.find("\ncompile " + std::to_string(files + 2) + " requests") == std::string::npos) {
+		std::cerr << "compile requests missing from the latency stats\n";
+		ok = false;
+	}
+
+	std::cout << files << " files of " << functions << " functions\n";
+	std::cout << "cold check: " << cold / static_cast<double>(files) << " ms per file\n";
+	std::cout << "warm check: " << warm / static_cast<double>(files) << " ms per file\n";
+	std::cout << "compile:    " << compile / static_cast<double>(files) << " ms per file\n";
+	std::cout << stats;
+
+	sendCompileRequest(socket, "shutdown");
+	serving.join();
+	std::filesystem::remove_all(directory);
+	if (!ok) {
+		std::cerr << "a request failed\n";
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Deterministic generator of synthetic programs for the benchmarks. A shape fixes how much
+// of each construct to emit; the same shape and seed always give byte-identical output on
+// every platform (no <random> distributions, whose output is implementation-defined).
+// Programs are syntactically valid; they are not meant to pass the type checker.
+struct SourceShape {
+	std::string name;
+	size_t classes = 0;				// class declarations, each after the one it may refer to
+	size_t fieldsPerClass = 4;
+	size_t functions = 0;
+	size_t statements = 8;			// simple statements per block
+	size_t nesting = 1;				// depth of nested if/while/for blocks
+	size_t expressionTerms = 4;		// operands per expression
+	uint64_t seed = 1;
+
+	// Multiplies the counts that set the file size
+	SourceShape scaled(double factor) const {
+		SourceShape shape = *this;
+		auto scale = [factor](size_t n) { return n ? std::max<size_t>(1, static_cast<size_t>(static_cast<double>(n) * factor)) : 0; };
+		if (functions > 1) shape.functions = scale(functions);
+		else shape.statements = scale(statements);	// one function: grow its body instead
+		shape.classes = scale(classes);
+		return shape;
+	}
+};
+
+// The shapes compiler_bench runs by default, about 2-4 MB each at scale 1
+inline std::vector<SourceShape> standardShapes() {
+	std::vector<SourceShape> shapes(5);
+	shapes[0].name = "small-functions";
+	shapes[0].functions = 12000;
+	shapes[0].statements = 3;
+	shapes[0].nesting = 2;
+
+	shapes[1].name = "huge-function";
+	shapes[1].functions = 1;
+	shapes[1].statements = 50000;
+	shapes[1].nesting = 2;
+	shapes[1].expressionTerms = 6;
+
+	shapes[2].name = "deep-nesting";
+	shapes[2].functions = 400;
+	shapes[2].statements = 2;
+	shapes[2].nesting = 64;
+	shapes[2].expressionTerms = 3;
+
+	shapes[3].name = "long-expressions";
+	shapes[3].functions = 200;
+	shapes[3].statements = 4;
+	shapes[3].expressionTerms = 500;
+
+	shapes[4].name = "many-classes";
+	shapes[4].classes = 12000;
+	shapes[4].fieldsPerClass = 8;
+	shapes[4].functions = 2000;
+	shapes[4].statements = 4;
+	return shapes;
+}
+
+class SourceGenerator {
+public:
+	explicit SourceGenerator(const SourceShape& shape) : shape(shape), state(shape.seed) {}
+
+	std::string generate() {
+		out.str("");
+		for (size_t c = 0; c < shape.classes; ++c) emitClass(c);
+		for (size_t f = 0; f < shape.functions; ++f) emitFunction(f);
+		return out.str();
+	}
+
+private:
+	SourceShape shape;
+	uint64_t state;
+	std::ostringstream out;
+	size_t function = 0;	// index of the function being emitted
+	size_t locals = 0;		// locals v0..v(locals-1) declared so far in it
+
+	// splitmix64
+	uint64_t next() {
+		uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		return z ^ (z >> 31);
+	}
+	size_t below(size_t n) { return n ? static_cast<size_t>(next() % n) : 0; }
+
+	void indent(size_t depth) { out << std::string(depth, '\t'); }
+
+	void emitClass(size_t c) {
+		out << "class C" << c << " {\n";
+		for (size_t i = 0; i < shape.fieldsPerClass; ++i) {
+			out << '\t';
+			size_t kind = i == 0 ? 2 : below(4);	// x0 is always a float, for p.x0
+			if (kind == 0 && c > 0) out << "C" << below(c);
+			else if (kind == 1) out << "float[]";
+			else out << "float";
+			out << " x" << i << ";\n";
+		}
+		out << "}\n";
+	}
+
+	void emitFunction(size_t f) {
+		function = f;
+		locals = 0;
+		out << "float f" << f << "(float a, float b, float[] values";
+		if (shape.classes) out << ", C" << below(shape.classes) << " p";
+		out << ") {\n\tfloat t = a;\n\tfloat i = 0;\n";
+		emitBlock(1, 1);
+		out << "\treturn t;\n}\n";
+	}
+
+	// `statements` simple statements with one nested block among them while depth allows
+	void emitBlock(size_t depth, size_t level) {
+		size_t nestedAt = level < shape.nesting ? below(shape.statements + 1) : SIZE_MAX;
+		for (size_t s = 0; s <= shape.statements; ++s) {
+			if (s == nestedAt) emitNested(depth, level);
+			else if (s < shape.statements) emitSimple(depth);
+		}
+	}
+
+	void emitNested(size_t depth, size_t level) {
+		indent(depth);
+		switch (below(3)) {
+			case 0:
+				out << "if (" << expression(2) << " > " << below(100) << ") {\n";
+				emitBlock(depth + 1, level + 1);
+				indent(depth);
+				out << "} else {\n";
+				indent(depth + 1);
+				out << "t = t - 1;\n";
+				break;
+			case 1:
+				out << "while (t < " << below(1000) << ") {\n";
+				emitBlock(depth + 1, level + 1);
+				indent(depth + 1);
+				out << "break;\n";
+				break;
+			default:
+				out << "for (i = 0; i < " << 1 + below(64) << "; i++) {\n";
+				emitBlock(depth + 1, level + 1);
+				break;
+		}
+		indent(depth);
+		out << "}\n";
+	}
+
+	void emitSimple(size_t depth) {
+		indent(depth);
+		switch (below(4)) {
+			case 0: out << "float v" << locals++ << " = " << expression(shape.expressionTerms) << ";\n"; break;
+			case 1: out << "values[i] = " << expression(shape.expressionTerms) << ";\n"; break;
+			case 2:
+				if (function > 0) {
+					out << "t = f" << below(function) << "(" << expression(2) << ", t, values";
+					if (shape.classes) out << ", p";
+					out << ");\n";
+					break;
+				}
+				[[fallthrough]];
+			default: out << "t = " << expression(shape.expressionTerms) << ";\n"; break;
+		}
+	}
+
+	std::string operand() {
+		switch (below(locals ? 7 : 6)) {
+			case 0: return "a";
+			case 1: return "b";
+			case 2: return "t";
+			case 3: return std::to_string(below(1000));
+			case 4: return "values[i]";
+			case 5: return shape.classes ? "p.x0" : "(a - b)";
+			default: return "v" + std::to_string(below(locals));
+		}
+	}
+
+	std::string expression(size_t terms) {
+		static constexpr std::string_view operators[] = {" + ", " - ", " * ", " / ", " + ", " * "};
+		std::string text = operand();
+		for (size_t i = 1; i < terms; ++i) {
+			text += operators[below(std::size(operators))];
+			if (below(8) == 0) text += "(" + operand() + " - " + operand() + ")";
+			else text += operand();
+		}
+		return text;
+	}
+};
+
+inline std::string generateSource(const SourceShape& shape) { return SourceGenerator(shape).generate(); }
@@ -0,0 +1,58 @@
+// Lex + parse of a large synthetic program three ways: lex everything into a vector
+// and then parse, pull tokens on demand through a bounded window, and lex on a
+// producer thread feeding the parser through an SPSC queue. Reports time and the
+// memory held by tokens; the resulting ASTs must be identical.
+//
+// usage: stream_parse_bench [functions]
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Fixtures.hpp"
+#include "Parser.hpp"
+#include "Timing.hpp"
+#include "TokenStream.hpp"
+
+int main(int argc, char** argv) {
+	size_t functions = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+	std::string source = pointFunctions(functions);
+	const double megabytes = source.size() / 1e6;
+
+	FlatAst batch, pulled, threaded;
+	size_t tokenBytes = 0;
+
+	double batchTime = bestOf(1, [&] {
+		Lexer lexer;
+		std::vector<CompactToken> tokens = lexer.tokenizeBuffer(source);
+		tokenBytes = tokens.capacity() * sizeof(CompactToken);
+		batch = FlatParser(source, tokens).Parse();
+	});
+
+	double pulledTime = bestOf(1, [&] {
+		ScanningTokenSource stream(source);
+		pulled = FlatParser(source, stream).Parse();
+	});
+
+	double threadedTime = bestOf(1, [&] {
+		ThreadedTokenSource stream(source);
+		threaded = FlatParser(source, stream).Parse();
+	});
+
+	const size_t windowBytes = (TokenCursor::defaultWindow + 1) * sizeof(CompactToken);
+	const size_t queueBytes = ThreadedTokenSource::defaultCapacity * sizeof(CompactToken)
+		+ ThreadedTokenSource::batchSize * sizeof(CompactToken);
+
+	std::cout << megabytes << " MB, " << batch.size() << " nodes\n";
+	std::cout << "lex all, then parse : " << megabytes / batchTime << " MB/s, tokens hold " << tokenBytes / 1024 << " KiB\n";
+	std::cout << "pull through window : " << megabytes / pulledTime << " MB/s, tokens hold " << windowBytes / 1024 << " KiB\n";
+	std::cout << "lexer thread + queue: " << megabytes / threadedTime << " MB/s, tokens hold "
+			  << (windowBytes + queueBytes) / 1024 << " KiB\n";
+
+	if (!sameAst(batch, pulled) || !sameAst(batch, threaded)) {
+		std::cerr << "streamed parse differs from the batch parse\n";
+		return 1;
+	}
+	return 0;
+}
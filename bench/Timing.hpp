@@ -0,0 +1,26 @@
+#pragma once
+
+#include <chrono>
+
+// Wall-clock timing helpers shared by the benchmarks
+
+// One run of body, in milliseconds
+template<class F>
+double millisecondsOf(F&& body) {
+	auto start = std::chrono::steady_clock::now();
+	body();
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Fastest of `repeats` runs of body, in seconds
+template<class F>
+double bestOf(int repeats, F&& body) {
+	double best = 1e30;
+	for (int r = 0; r < repeats; ++r) {
+		auto start = std::chrono::steady_clock::now();
+		body();
+		double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		if (secs < best) best = secs;
+	}
+	return best;
+}
@@ -0,0 +1,63 @@
+// Resolve + type-check throughput on generated programs of growing size. Time per token
+// should stay flat as the program grows: checking is linear and compares types by pointer.
+// The largest program is then checked with its function bodies on 2, 4, ... threads.
+//
+// usage: type_check_bench [functions]
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Fixtures.hpp"
+#include "Parser.hpp"
+#include "Resolver.hpp"
+#include "Timing.hpp"
+#include "TypeChecker.hpp"
+
+int main(int argc, char** argv) {
+	size_t largest = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 64000;
+	for (size_t functions = largest / 16; functions <= largest; functions *= 2) {
+		std::string source = recordFunctions(functions);
+		Lexer lexer;
+		std::vector<CompactToken> tokens = lexer.tokenizeBuffer(source);
+		Program* program = Parser(source, tokens).Parse();
+
+		double resolve = bestOf(3, [&] { Resolver().resolve(*program); });
+		size_t errors = 0;
+		double check = bestOf(3, [&] {
+			TypeContext types;
+			TypeChecker checker(types);
+			checker.check(*program);
+			errors = checker.diagnostics().size();
+		});
+		if (errors != 0) {
+			std::cerr << errors << " type errors in the generated program\n";
+			return 1;
+		}
+		std::cout << functions << " functions, " << tokens.size() << " tokens: resolve "
+				  << resolve / tokens.size() * 1e9 << " ns/token, check " << check / tokens.size() * 1e9 << " ns/token\n";
+
+		if (functions * 2 > largest) {
+			unsigned maxThreads = std::thread::hardware_concurrency();
+			if (maxThreads < 2) maxThreads = 2;
+			for (unsigned threads = 2; threads <= maxThreads; threads *= 2) {
+				ThreadPool pool(threads);
+				double parallel = bestOf(3, [&] {
+					TypeContext types;
+					TypeChecker checker(types);
+					checker.check(*program, pool);
+					errors = checker.diagnostics().size();
+				});
+				if (errors != 0) {
+					std::cerr << errors << " type errors with " << threads << " threads\n";
+					return 1;
+				}
+				std::cout << "  check on " << threads << " threads: " << parallel / tokens.size() * 1e9
+						  << " ns/token, speedup " << check / parallel << "\n";
+			}
+		}
+		delete program;
+	}
+	return 0;
+}
@@ -0,0 +1,121 @@
+// Bytecode VM against the AST-walking interpreter on four kernels: recursive fib (calls),
+// a nested counting loop (branches and arithmetic), array fill + sum (indexing) and
+// operands that write a local read earlier in the same expression (evaluation order).
+// Each kernel runs on the VM with threaded dispatch, with switch dispatch, and on the
+// tree walker; all three must agree on the result.
+//
+// usage: vm_bench [scale]
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "AstInterpreter.hpp"
+#include "BytecodeCompiler.hpp"
+#include "Parser.hpp"
+#include "Resolver.hpp"
+#include "Timing.hpp"
+#include "TypeChecker.hpp"
+#include "VM.hpp"
+
+static const char* source = R"(
+float fib(float n) {
+	if (n < 2) { return n; }
+	return fib(n - 1) + fib(n - 2);
+}
+
+float loops(float n) {
+	float total = 0;
+	float i = 0;
+	for (i = 0; i < n; i++) {
+		float j = 0;
+		while (j < 100) {
+			if (j % 3 == 0) { total = total + j; } else { total = total - 1; }
+			j++;
+		}
+	}
+	return total;
+}
+
+float arraySum(float n) {
+	float[] values = array(n);
+	float i = 0;
+	for (i = 0; i < length(values); i++) { values[i] = i * 2 + 1; }
+	float total = 0;
+	float pass = 0;
+	for (pass = 0; pass < 10; pass++) {
+		for (i = 0; i < length(values); i++) { total = total + values[i]; }
+	}
+	return total;
+}
+
+float evalOrder(float n) {
+	float[] cells = array(4);
+	float total = 0;
+	float i = 0;
+	for (i = 0; i < n; i++) {
+		float x = i;
+		total = total + (x + (x = 5));
+		x = x++;
+		total = total + x;
+		x = x--;
+		total = total + x;
+		float k = 1;
+		total = total + (k + k++);
+		cells[k] = cells[k] + (k = 1);
+		total = total + cells[2] + cells[(k = 3) - 2];
+	}
+	return total;
+}
+)";
+
+int main(int argc, char** argv) {
+	double scale = argc > 1 ? std::strtod(argv[1], nullptr) : 1;
+	std::string text = source;
+	Lexer lexer;
+	std::vector<CompactToken> tokens = lexer.tokenizeBuffer(text);
+	Program* program = Parser(text, tokens).Parse();
+	Resolver().resolve(*program);
+	TypeContext types;
+	TypeChecker checker(types);
+	if (!checker.check(*program)) {
+		for (const Diagnostic& diagnostic : checker.diagnostics()) std::cerr << diagnostic << "\n";
+		return 1;
+	}
+	BytecodeModule module = BytecodeCompiler().compile(*program);
+	std::cout << module.instructionCount() << " instructions\n";
+
+	struct Kernel {
+		const char* name;
+		double argument;
+	};
+	const Kernel kernels[] = {
+		{"fib", 25 + (scale > 1 ? std::log2(scale) * 1.44 : 0)},
+		{"loops", 20000 * scale},
+		{"arraySum", 200000 * scale},
+		{"evalOrder", 200000 * scale},
+	};
+
+	VM vm(module);
+	AstInterpreter interpreter(*program);
+	for (const Kernel& kernel : kernels) {
+		uint32_t function = static_cast<uint32_t>(module.find(intern(kernel.name)));
+		Value args[] = {Value{std::floor(kernel.argument)}};
+		Value threaded, switched, walked;
+		double threadedTime = bestOf(3, [&] { threaded = vm.call(function, args, VM::Dispatch::Threaded); });
+		double switchTime = bestOf(3, [&] { switched = vm.call(function, args, VM::Dispatch::Switch); });
+		double walkTime = bestOf(3, [&] { walked = interpreter.call(function, args); });
+		if (threaded.number != walked.number || switched.number != walked.number) {
+			std::cerr << kernel.name << ": results differ: " << threaded.number << " / " << switched.number << " / "
+					  << walked.number << "\n";
+			return 1;
+		}
+		std::cout << kernel.name << "(" << args[0].number << ") = " << walked.number << "\n"
+				  << "  vm threaded " << threadedTime * 1e3 << " ms, vm switch " << switchTime * 1e3 << " ms, ast "
+				  << walkTime * 1e3 << " ms, speedup " << walkTime / threadedTime << "x\n";
+	}
+	delete program;
+	return 0;
+}
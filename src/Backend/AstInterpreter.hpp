@@ -0,0 +1,190 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Builtins.hpp"
+#include "SyntaxTree.hpp"
+#include "Value.hpp"
+
+// Runs a resolved, type-checked Program by walking its tree directly. This is the
+// straightforward reference the bytecode VM is measured and checked against; it covers
+// the same executable subset (float and float[]).
+class AstInterpreter {
+private:
+	enum class Flow { Next, Break, Continue, Return };
+
+	std::vector<FunctionDecl*> globals;	// by global slot
+	std::vector<Value>* frame = nullptr;
+	Value result;
+	Heap arrays;
+	size_t depth = 0;
+
+public:
+	static constexpr size_t maxDepth = 2000;
+
+	explicit AstInterpreter(const Program& program) {
+		for (ASTNode* decl : program.Code) {
+			if (auto* function = dynamic_cast<FunctionDecl*>(decl)) globals.push_back(function);
+		}
+	}
+
+	Value call(uint32_t function, std::span<const Value> args = {}) {
+		depth = 0;
+		frame = nullptr;
+		return invoke(function, args);
+	}
+
+private:
+	Value invoke(uint32_t function, std::span<const Value> args) {
+		FunctionDecl* callee = globals.at(function);
+		if (args.size() != callee->params.size()) throw std::runtime_error("Wrong number of arguments.");
+		if (++depth > maxDepth) throw std::runtime_error("Runtime error: stack overflow.");
+		std::vector<Value> locals(callee->frameSize);
+		std::copy(args.begin(), args.end(), locals.begin());
+		std::vector<Value>* caller = frame;
+		frame = &locals;
+		Value value = execute(callee->body) == Flow::Return ? result : Value{};
+		frame = caller;
+		--depth;
+		return value;
+	}
+
+	Value& local(const VariableExpr* variable) {
+		if (!variable || !variable->slot.isLocal()) throw std::runtime_error("Expected a local variable.");
+		return (*frame)[variable->slot.index];
+	}
+
+	double& element(const IndexExpr* index) {
+		ArrayObject* array = evaluate(index->target).array;
+		return elementAt(array, evaluate(index->index).number);
+	}
+
+	static double arithmetic(OpKind op, double left, double right) {
+		switch (op) {
+			case OpKind::Add: return left + right;
+			case OpKind::Sub: return left - right;
+			case OpKind::Mul: return left * right;
+			case OpKind::Div: return left / right;
+			case OpKind::Mod: return std::fmod(left, right);
+			case OpKind::Pow: return std::pow(left, right);
+			case OpKind::Equal: return left == right;
+			case OpKind::NotEqual: return left != right;
+			case OpKind::Less: return left < right;
+			case OpKind::LessEqual: return left <= right;
+			case OpKind::Greater: return left > right;
+			case OpKind::GreaterEqual: return left >= right;
+			default: throw std::runtime_error("Not a binary operator.");
+		}
+	}
+
+	Value unary(OpKind op, ASTNode* operand, bool prefix) {
+		if (op == OpKind::Sub) return Value{-evaluate(operand).number};
+		if (op == OpKind::Not) return Value{evaluate(operand).number == 0 ? 1.0 : 0.0};
+		const double step = op == OpKind::Increment ? 1 : -1;
+		double* target;
+		if (auto* index = dynamic_cast<IndexExpr*>(operand)) target = &element(index);
+		else target = &local(dynamic_cast<VariableExpr*>(operand)).number;
+		double before = *target;
+		*target = before + step;
+		return Value{prefix ? *target : before};
+	}
+
+	Value evaluate(ASTNode* node) {
+		if (auto* n = dynamic_cast<LiteralExpr*>(node)) {
+			return Value{static_cast<double>(n->value)};
+		} else if (auto* n = dynamic_cast<VariableExpr*>(node)) {
+			return local(n);
+		} else if (auto* n = dynamic_cast<BinaryExpr*>(node)) {
+			if (n->op == OpKind::Assign) {
+				if (auto* index = dynamic_cast<IndexExpr*>(n->left)) {
+					double& slot = element(index);
+					return Value{slot = evaluate(n->right).number};
+				}
+				Value value = evaluate(n->right);
+				return local(dynamic_cast<VariableExpr*>(n->left)) = value;
+			}
+			double left = evaluate(n->left).number;
+			return Value{arithmetic(n->op, left, evaluate(n->right).number)};
+		} else if (auto* n = dynamic_cast<PrefixExpr*>(node)) {
+			return unary(n->op, n->operand, true);
+		} else if (auto* n = dynamic_cast<UnaryExpr*>(node)) {
+			return unary(n->op, n->expr, true);
+		} else if (auto* n = dynamic_cast<PostfixExpr*>(node)) {
+			return unary(n->op, n->operand, false);
+		} else if (auto* n = dynamic_cast<IndexExpr*>(node)) {
+			return Value{element(n)};
+		} else if (auto* n = dynamic_cast<FunctionCallExpr*>(node)) {
+			if (n->target.isBuiltin()) {
+				Value argument = evaluate(n->arguments[0]);
+				switch (builtinFunctions[n->target.index].id) {
+					case Builtin::Array: { Value array; array.array = arrays.newArray(argument.number); return array; }
+					case Builtin::Length: return Value{arrayLength(argument.array)};
+				}
+			}
+			if (!n->target.isGlobal()) throw std::runtime_error("Indirect calls cannot be interpreted.");
+			std::vector<Value> args;
+			for (ASTNode* arg : n->arguments) args.push_back(evaluate(arg));
+			return invoke(n->target.index, args);
+		}
+		throw std::runtime_error("This expression cannot be interpreted.");
+	}
+
+	bool condition(ASTNode* node) { return evaluate(node).number != 0; }
+
+	// Runs a loop body; true when the loop should stop
+	bool iteration(ASTNode* body, Flow& flow) {
+		flow = execute(body);
+		if (flow == Flow::Break) {
+			flow = Flow::Next;
+			return true;
+		}
+		if (flow == Flow::Continue) flow = Flow::Next;
+		return flow == Flow::Return;
+	}
+
+	Flow execute(ASTNode* node) {
+		if (!node) return Flow::Next;
+		if (auto* n = dynamic_cast<CompoundStmt*>(node)) {
+			for (ASTNode* statement : n->statements) {
+				if (Flow flow = execute(statement); flow != Flow::Next) return flow;
+			}
+		} else if (auto* n = dynamic_cast<BlockStmt*>(node)) {
+			for (ASTNode* statement : n->statements) {
+				if (Flow flow = execute(statement); flow != Flow::Next) return flow;
+			}
+		} else if (auto* n = dynamic_cast<DefinitionStmt*>(node)) {
+			auto* assignment = dynamic_cast<BinaryExpr*>(n->expression);
+			Value value = assignment && assignment->op == OpKind::Assign ? evaluate(assignment->right) : Value{};
+			(*frame)[n->slot.index] = value;
+		} else if (auto* n = dynamic_cast<IfStmt*>(node)) {
+			return condition(n->condition) ? execute(n->thenBranch) : execute(n->elseBranch);
+		} else if (auto* n = dynamic_cast<WhileStmt*>(node)) {
+			Flow flow = Flow::Next;
+			while (condition(n->condition)) {
+				if (iteration(n->body, flow)) break;
+			}
+			return flow;
+		} else if (auto* n = dynamic_cast<ForStmt*>(node)) {
+			Flow flow = Flow::Next;
+			for (execute(n->initializer); condition(n->condition); evaluate(n->incrementor)) {
+				if (iteration(n->body, flow)) break;
+			}
+			return flow;
+		} else if (auto* n = dynamic_cast<ReturnStmt*>(node)) {
+			result = n->expression ? evaluate(n->expression) : Value{};
+			return Flow::Return;
+		} else if (dynamic_cast<BreakStmt*>(node)) {
+			return Flow::Break;
+		} else if (dynamic_cast<ContinueStmt*>(node)) {
+			return Flow::Continue;
+		} else {
+			evaluate(node);
+		}
+		return Flow::Next;
+	}
+};
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdint>
+#include <iterator>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+#include "StringInterner.hpp"
+
+// Register bytecode. Each function runs in a window of registers: its parameters are
+// r0..r(params-1), then its other locals (one register per frame slot), then temporaries.
+// Instructions are 8 bytes, an opcode and three 16-bit operands; b and c together form
+// the 32-bit operand bx of jumps, constants and calls.
+//
+//   op             a           b           c
+//   Move           dst         src                     r[a] = r[b]
+//   LoadK          dst         bx: constant            r[a] = K[bx]
+//   Add..Pow       dst         lhs         rhs         r[a] = r[b] op r[c]
+//   AddI           dst         src         imm (int16) r[a] = r[b] + imm
+//   Equal..        dst         lhs         rhs         r[a] = r[b] cmp r[c] ? 1 : 0
+//   Neg / Not      dst         src
+//   Jump                       bx: target
+//   JumpIfFalse    cond        bx: target              if r[a] == 0
+//   JumpIfTrue     cond        bx: target              if r[a] != 0
+//   NewArray       dst         length                  r[a] = array(r[b])
+//   Length         dst         array
+//   GetIndex       dst         array       index       r[a] = r[b][r[c]]
+//   SetIndex       array       index       value       r[a][r[b]] = r[c]
+//   Call           base        bx: function            callee window starts at r[a]; result lands in r[a]
+//   Return         src
+//
+// Jump targets are instruction indices within the function.
+
+#define BYTECODE_OPCODES(X) \
+	X(Move) X(LoadK) \
+	X(Add) X(Sub) X(Mul) X(Div) X(Mod) X(Pow) X(AddI) \
+	X(Equal) X(NotEqual) X(Less) X(LessEqual) X(Greater) X(GreaterEqual) \
+	X(Neg) X(Not) \
+	X(Jump) X(JumpIfFalse) X(JumpIfTrue) \
+	X(NewArray) X(Length) X(GetIndex) X(SetIndex) \
+	X(Call) X(Return)
+
+enum class Opcode : uint8_t {
+#define BYTECODE_ENUM(name) name,
+	BYTECODE_OPCODES(BYTECODE_ENUM)
+#undef BYTECODE_ENUM
+};
+
+inline constexpr std::string_view opcodeNames[] = {
+#define BYTECODE_NAME(name) #name,
+	BYTECODE_OPCODES(BYTECODE_NAME)
+#undef BYTECODE_NAME
+};
+
+inline constexpr size_t opcodeCount = std::size(opcodeNames);
+
+struct Instruction {
+	Opcode op;
+	uint16_t a = 0, b = 0, c = 0;
+
+	uint32_t bx() const { return b | static_cast<uint32_t>(c) << 16; }
+	void setBx(uint32_t value) {
+		b = static_cast<uint16_t>(value);
+		c = static_cast<uint16_t>(value >> 16);
+	}
+};
+
+static_assert(sizeof(Instruction) == 8);
+
+struct BytecodeFunction {
+	Symbol name;
+	uint16_t params = 0;
+	uint16_t registers = 0;		// window size: locals + temporaries
+	std::vector<Instruction> code;
+	std::vector<double> constants;
+};
+
+// Functions by global slot, so Call operands are the Resolver's slot indices
+struct BytecodeModule {
+	std::vector<BytecodeFunction> functions;
+
+	// Index of the function called name, or -1
+	int find(Symbol name) const {
+		for (size_t i = 0; i < functions.size(); ++i) {
+			if (functions[i].name == name) return static_cast<int>(i);
+		}
+		return -1;
+	}
+
+	size_t instructionCount() const {
+		size_t count = 0;
+		for (const BytecodeFunction& function : functions) count += function.code.size();
+		return count;
+	}
+
+	void print(std::ostream& out) const {
+		for (const BytecodeFunction& function : functions) {
+			out << function.name << " (" << function.params << " params, " << function.registers << " registers)\n";
+			for (size_t pc = 0; pc < function.code.size(); ++pc) {
+				const Instruction& in = function.code[pc];
+				out << "  " << pc << "\t" << opcodeNames[static_cast<size_t>(in.op)] << "\t" << in.a << " " << in.b << " " << in.c;
+				if (in.op == Opcode::LoadK) out << "\t; " << function.constants[in.bx()];
+				out << "\n";
+			}
+		}
+	}
+};
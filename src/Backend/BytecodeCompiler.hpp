@@ -0,0 +1,388 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Builtins.hpp"
+#include "Bytecode.hpp"
+#include "SyntaxTree.hpp"
+
+// Lowers a resolved, type-checked Program to register bytecode, one BytecodeFunction
+// per FunctionDecl. Frame slot i becomes register i; temporaries are handed out above
+// the locals like a stack and released when the expression that needed them is done, so
+// a function's window is its locals plus its deepest expression.
+//
+// Class values are not executable yet: a function with a class-typed slot, a field
+// access or a class literal is rejected with std::runtime_error.
+class BytecodeCompiler {
+private:
+	struct Loop {
+		std::vector<size_t> breaks;		// jumps to patch to the loop exit
+		std::vector<size_t> continues;	// jumps to patch to the continue point
+	};
+
+	static constexpr uint32_t maxRegisters = UINT16_MAX;
+
+	BytecodeFunction* out = nullptr;
+	const FunctionDecl* function = nullptr;
+	uint32_t nextTemp = 0;
+	uint32_t maxRegister = 0;
+	std::vector<Loop> loops;
+	std::unordered_map<uint64_t, uint32_t> constantIndex;	// bit pattern -> constant slot
+
+public:
+	BytecodeModule compile(const Program& program) {
+		BytecodeModule module;
+		for (const ASTNode* decl : program.Code) {
+			if (auto* f = dynamic_cast<const FunctionDecl*>(decl)) {
+				module.functions.emplace_back();
+				compileFunction(*f, module.functions.back());
+			}
+		}
+		return module;
+	}
+
+private:
+	[[noreturn]] void unsupported(const char* what) const {
+		throw std::runtime_error("In function '" + std::string(globalInterner().text(function->name)) + "': " + what +
+								 " cannot be compiled to bytecode yet.");
+	}
+
+	void compileFunction(const FunctionDecl& decl, BytecodeFunction& target) {
+		function = &decl;
+		out = &target;
+		loops.clear();
+		constantIndex.clear();
+		if (decl.frameTypes.size() != decl.frameSize) {
+			throw std::runtime_error("Function '" + std::string(globalInterner().text(decl.name)) + "' has not been type-checked.");
+		}
+		for (Type* type : decl.frameTypes) {
+			if (type && type->kind == Type::Kind::Struct) unsupported("A class value");
+		}
+		if (decl.signature && decl.signature->result->kind == Type::Kind::Struct) unsupported("A class value");
+		if (decl.frameSize > maxRegisters) unsupported("A function with this many locals");
+
+		target.name = decl.name;
+		target.params = static_cast<uint16_t>(decl.params.size());
+		nextTemp = maxRegister = decl.frameSize;
+
+		statement(decl.body);
+		uint16_t zero = temp();
+		emitBx(Opcode::LoadK, zero, constant(0));	// falling off the end returns 0
+		emit(Opcode::Return, zero);
+		target.registers = static_cast<uint16_t>(std::max(maxRegister, 1u));
+	}
+
+	//---------------------------------------------------------------------------------------------------------------------------------------------------------------
+	// Emission helpers
+
+	size_t emit(Opcode op, uint32_t a = 0, uint32_t b = 0, uint32_t c = 0) {
+		out->code.push_back({op, static_cast<uint16_t>(a), static_cast<uint16_t>(b), static_cast<uint16_t>(c)});
+		return out->code.size() - 1;
+	}
+
+	size_t emitBx(Opcode op, uint32_t a, uint32_t bx) {
+		Instruction in{op, static_cast<uint16_t>(a)};
+		in.setBx(bx);
+		out->code.push_back(in);
+		return out->code.size() - 1;
+	}
+
+	size_t here() const { return out->code.size(); }
+	void patch(size_t jump, size_t target) { out->code[jump].setBx(static_cast<uint32_t>(target)); }
+
+	uint32_t constant(double value) {
+		uint64_t bits;
+		std::memcpy(&bits, &value, sizeof bits);
+		auto [it, inserted] = constantIndex.emplace(bits, static_cast<uint32_t>(out->constants.size()));
+		if (inserted) out->constants.push_back(value);
+		return it->second;
+	}
+
+	uint16_t temp() {
+		if (nextTemp >= maxRegisters) unsupported("An expression this deep");
+		maxRegister = std::max(maxRegister, nextTemp + 1);
+		return static_cast<uint16_t>(nextTemp++);
+	}
+
+	// Releases the temporaries taken since mark when the scope ends
+	struct TempScope {
+		BytecodeCompiler& compiler;
+		uint32_t mark;
+		explicit TempScope(BytecodeCompiler& compiler) : compiler(compiler), mark(compiler.nextTemp) {}
+		~TempScope() { compiler.nextTemp = mark; }
+	};
+
+	static const VariableExpr* localVariable(const ASTNode* node) {
+		auto* variable = dynamic_cast<const VariableExpr*>(node);
+		return variable && variable->slot.isLocal() ? variable : nullptr;
+	}
+
+	static Opcode arithmetic(OpKind op) {
+		switch (op) {
+			case OpKind::Add: return Opcode::Add;
+			case OpKind::Sub: return Opcode::Sub;
+			case OpKind::Mul: return Opcode::Mul;
+			case OpKind::Div: return Opcode::Div;
+			case OpKind::Mod: return Opcode::Mod;
+			case OpKind::Pow: return Opcode::Pow;
+			case OpKind::Equal: return Opcode::Equal;
+			case OpKind::NotEqual: return Opcode::NotEqual;
+			case OpKind::Less: return Opcode::Less;
+			case OpKind::LessEqual: return Opcode::LessEqual;
+			case OpKind::Greater: return Opcode::Greater;
+			case OpKind::GreaterEqual: return Opcode::GreaterEqual;
+			default: throw std::runtime_error("Not a binary operator.");
+		}
+	}
+
+	// True if evaluating node cannot write a local: no assignment and no ++/--. A call
+	// runs in its own window above every live register, so only its arguments count.
+	static bool leavesLocals(const ASTNode* node) {
+		if (dynamic_cast<const LiteralExpr*>(node) || dynamic_cast<const VariableExpr*>(node)) return true;
+		if (auto* n = dynamic_cast<const BinaryExpr*>(node)) return n->op != OpKind::Assign && leavesLocals(n->left) && leavesLocals(n->right);
+		if (auto* n = dynamic_cast<const PrefixExpr*>(node)) return (n->op == OpKind::Sub || n->op == OpKind::Not) && leavesLocals(n->operand);
+		if (auto* n = dynamic_cast<const UnaryExpr*>(node)) return (n->op == OpKind::Sub || n->op == OpKind::Not) && leavesLocals(n->expr);
+		if (auto* n = dynamic_cast<const IndexExpr*>(node)) return leavesLocals(n->target) && leavesLocals(n->index);
+		if (auto* n = dynamic_cast<const FunctionCallExpr*>(node)) {
+			return std::all_of(n->arguments.begin(), n->arguments.end(), [](const ASTNode* argument) { return leavesLocals(argument); });
+		}
+		return false;
+	}
+
+	// Small integer literal that fits AddI's immediate
+	static bool smallInteger(const ASTNode* node, int sign, int& value) {
+		auto* literal = dynamic_cast<const LiteralExpr*>(node);
+		if (!literal || literal->value > INT16_MAX || literal->value < -INT16_MAX) return false;
+		value = sign * literal->value;
+		return true;
+	}
+
+	//---------------------------------------------------------------------------------------------------------------------------------------------------------------
+	// Expressions
+
+	// Register holding the value of node: a local's own register, or a fresh temporary
+	uint16_t expression(const ASTNode* node) {
+		if (const VariableExpr* variable = localVariable(node)) return static_cast<uint16_t>(variable->slot.index);
+		uint16_t dst = temp();
+		expressionTo(node, dst);
+		return dst;
+	}
+
+	// Register holding the value node had before the operands in later run. A local is
+	// read in place only when none of them can write it; otherwise it is copied first, so
+	// `x + (x = 5)` adds the old x as the interpreter does.
+	uint16_t operandBefore(const ASTNode* node, std::initializer_list<const ASTNode*> later) {
+		if (localVariable(node) && !std::all_of(later.begin(), later.end(), leavesLocals)) {
+			uint16_t copy = temp();
+			expressionTo(node, copy);
+			return copy;
+		}
+		return expression(node);
+	}
+
+	void expressionTo(const ASTNode* node, uint16_t dst) {
+		TempScope scope(*this);
+		if (auto* n = dynamic_cast<const LiteralExpr*>(node)) {
+			emitBx(Opcode::LoadK, dst, constant(n->value));
+		} else if (auto* n = dynamic_cast<const VariableExpr*>(node)) {
+			if (!n->slot.isLocal()) unsupported("A function used as a value");
+			if (n->slot.index != dst) emit(Opcode::Move, dst, n->slot.index);
+		} else if (auto* n = dynamic_cast<const BinaryExpr*>(node)) {
+			if (n->op == OpKind::Assign) {
+				uint16_t value = assign(*n);
+				if (value != dst) emit(Opcode::Move, dst, value);
+				return;
+			}
+			int immediate;
+			if ((n->op == OpKind::Add || n->op == OpKind::Sub) && smallInteger(n->right, n->op == OpKind::Add ? 1 : -1, immediate)) {
+				emit(Opcode::AddI, dst, expression(n->left), static_cast<uint16_t>(static_cast<int16_t>(immediate)));
+				return;
+			}
+			uint16_t left = operandBefore(n->left, {n->right});
+			uint16_t right = expression(n->right);
+			emit(arithmetic(n->op), dst, left, right);
+		} else if (auto* n = dynamic_cast<const PrefixExpr*>(node)) {
+			unary(n->op, n->operand, dst, true);
+		} else if (auto* n = dynamic_cast<const UnaryExpr*>(node)) {
+			unary(n->op, n->expr, dst, true);
+		} else if (auto* n = dynamic_cast<const PostfixExpr*>(node)) {
+			unary(n->op, n->operand, dst, false);
+		} else if (auto* n = dynamic_cast<const IndexExpr*>(node)) {
+			uint16_t array = operandBefore(n->target, {n->index});
+			uint16_t index = expression(n->index);
+			emit(Opcode::GetIndex, dst, array, index);
+		} else if (auto* n = dynamic_cast<const FunctionCallExpr*>(node)) {
+			call(*n, dst);
+		} else if (dynamic_cast<const ClassFieldAccessExpr*>(node) || dynamic_cast<const ClassInstanceExpr*>(node)) {
+			unsupported("A class value");
+		} else {
+			unsupported("This expression");
+		}
+	}
+
+	// Stores the right side and returns the register holding the stored value
+	uint16_t assign(const BinaryExpr& n) {
+		if (const VariableExpr* variable = localVariable(n.left)) {
+			uint16_t slot = static_cast<uint16_t>(variable->slot.index);
+			expressionTo(n.right, slot);
+			return slot;
+		}
+		if (auto* target = dynamic_cast<const IndexExpr*>(n.left)) {
+			uint16_t array = operandBefore(target->target, {target->index, n.right});
+			uint16_t index = operandBefore(target->index, {n.right});
+			uint16_t value = expression(n.right);
+			emit(Opcode::SetIndex, array, index, value);
+			return value;
+		}
+		unsupported("Assignment to a class field");
+	}
+
+	// -x, !x, ++x, --x, x++, x--; dst gets the expression's value
+	void unary(OpKind op, const ASTNode* operand, uint16_t dst, bool prefix) {
+		if (op == OpKind::Sub || op == OpKind::Not) {
+			emit(op == OpKind::Sub ? Opcode::Neg : Opcode::Not, dst, expression(operand));
+			return;
+		}
+		const uint16_t step = static_cast<uint16_t>(static_cast<int16_t>(op == OpKind::Increment ? 1 : -1));
+		if (const VariableExpr* variable = localVariable(operand)) {
+			uint16_t slot = static_cast<uint16_t>(variable->slot.index);
+			if (!prefix && dst == slot) {	// x = x++: the old value is stored back after the step
+				uint16_t before = temp();
+				emit(Opcode::Move, before, slot);
+				emit(Opcode::AddI, slot, slot, step);
+				emit(Opcode::Move, dst, before);
+				return;
+			}
+			if (!prefix && dst != slot) emit(Opcode::Move, dst, slot);
+			emit(Opcode::AddI, slot, slot, step);
+			if (prefix && dst != slot) emit(Opcode::Move, dst, slot);
+			return;
+		}
+		if (auto* target = dynamic_cast<const IndexExpr*>(operand)) {
+			uint16_t array = operandBefore(target->target, {target->index});
+			uint16_t index = expression(target->index);
+			uint16_t before = temp();
+			uint16_t after = temp();
+			emit(Opcode::GetIndex, before, array, index);
+			emit(Opcode::AddI, after, before, step);
+			emit(Opcode::SetIndex, array, index, after);
+			emit(Opcode::Move, dst, prefix ? after : before);	// last, dst may be array or index
+			return;
+		}
+		unsupported("Incrementing a class field");
+	}
+
+	void call(const FunctionCallExpr& n, uint16_t dst) {
+		if (n.target.isBuiltin()) {
+			switch (builtinFunctions[n.target.index].id) {
+				case Builtin::Array: emit(Opcode::NewArray, dst, expression(n.arguments[0])); return;
+				case Builtin::Length: emit(Opcode::Length, dst, expression(n.arguments[0])); return;
+			}
+		}
+		if (!n.target.isGlobal()) unsupported("An indirect call");
+
+		// Arguments go to the bottom of the callee's window, above every live register
+		uint16_t base = temp();
+		for (size_t i = 1; i < n.arguments.size(); ++i) temp();
+		for (size_t i = 0; i < n.arguments.size(); ++i) expressionTo(n.arguments[i], static_cast<uint16_t>(base + i));
+		emitBx(Opcode::Call, base, n.target.index);
+		if (dst != base) emit(Opcode::Move, dst, base);
+	}
+
+	//---------------------------------------------------------------------------------------------------------------------------------------------------------------
+	// Statements
+
+	void statement(const ASTNode* node) {
+		if (!node) return;
+		TempScope scope(*this);
+		if (auto* n = dynamic_cast<const CompoundStmt*>(node)) {
+			for (const ASTNode* stmt : n->statements) statement(stmt);
+		} else if (auto* n = dynamic_cast<const BlockStmt*>(node)) {
+			for (const ASTNode* stmt : n->statements) statement(stmt);
+		} else if (auto* n = dynamic_cast<const DefinitionStmt*>(node)) {
+			uint16_t slot = static_cast<uint16_t>(n->slot.index);
+			auto* assignment = dynamic_cast<const BinaryExpr*>(n->expression);
+			if (assignment && assignment->op == OpKind::Assign) expressionTo(assignment->right, slot);
+			else emitBx(Opcode::LoadK, slot, constant(0));
+		} else if (auto* n = dynamic_cast<const IfStmt*>(node)) {
+			size_t toElse = emitBx(Opcode::JumpIfFalse, expression(n->condition), 0);
+			statement(n->thenBranch);
+			if (n->elseBranch) {
+				size_t toEnd = emitBx(Opcode::Jump, 0, 0);
+				patch(toElse, here());
+				statement(n->elseBranch);
+				patch(toEnd, here());
+			} else {
+				patch(toElse, here());
+			}
+		} else if (auto* n = dynamic_cast<const WhileStmt*>(node)) {
+			loop(n->condition, n->body, nullptr);
+		} else if (auto* n = dynamic_cast<const ForStmt*>(node)) {
+			statement(n->initializer);
+			loop(n->condition, n->body, n->incrementor);
+		} else if (auto* n = dynamic_cast<const ReturnStmt*>(node)) {
+			uint16_t value;
+			if (n->expression) {
+				value = expression(n->expression);
+			} else {
+				value = temp();
+				emitBx(Opcode::LoadK, value, constant(0));
+			}
+			emit(Opcode::Return, value);
+		} else if (dynamic_cast<const BreakStmt*>(node)) {
+			loops.back().breaks.push_back(emitBx(Opcode::Jump, 0, 0));
+		} else if (dynamic_cast<const ContinueStmt*>(node)) {
+			loops.back().continues.push_back(emitBx(Opcode::Jump, 0, 0));
+		} else {
+			effect(node);
+		}
+	}
+
+	// An expression evaluated for its side effects only
+	void effect(const ASTNode* node) {
+		auto* binary = dynamic_cast<const BinaryExpr*>(node);
+		if (binary && binary->op == OpKind::Assign) {
+			assign(*binary);
+			return;
+		}
+		const ASTNode* operand = nullptr;
+		OpKind op = OpKind::None;
+		if (auto* n = dynamic_cast<const PostfixExpr*>(node)) operand = n->operand, op = n->op;
+		if (auto* n = dynamic_cast<const PrefixExpr*>(node)) operand = n->operand, op = n->op;
+		if (const VariableExpr* variable = localVariable(operand); variable && (op == OpKind::Increment || op == OpKind::Decrement)) {
+			uint16_t slot = static_cast<uint16_t>(variable->slot.index);
+			emit(Opcode::AddI, slot, slot, static_cast<uint16_t>(static_cast<int16_t>(op == OpKind::Increment ? 1 : -1)));
+			return;
+		}
+		expressionTo(node, temp());
+	}
+
+	// Condition at the bottom, so each iteration takes one branch:
+	//     jump test; body: ...; next: increment; test: if (condition) jump body
+	void loop(const ASTNode* condition, const ASTNode* body, const ASTNode* increment) {
+		size_t toTest = emitBx(Opcode::Jump, 0, 0);
+		size_t top = here();
+		loops.emplace_back();
+		statement(body);
+		size_t next = here();
+		if (increment) {
+			TempScope scope(*this);
+			effect(increment);
+		}
+		patch(toTest, here());
+		{
+			TempScope scope(*this);
+			emitBx(Opcode::JumpIfTrue, expression(condition), static_cast<uint32_t>(top));
+		}
+		for (size_t jump : loops.back().breaks) patch(jump, here());
+		for (size_t jump : loops.back().continues) patch(jump, next);
+		loops.pop_back();
+	}
+};
@@ -0,0 +1,216 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "IR.hpp"
+
+// Where the x86-64 backend keeps a value for its whole lifetime
+struct Location {
+	enum Kind : uint8_t {
+		None,		// never read: the value is computed for its side effects only
+		Xmm,		// index: xmm register number
+		Gp,			// index: general register number (hardware encoding)
+		Stack,		// index: spill slot, addressed off %rbp
+		Incoming,	// index: stack-passed argument number, above the return address
+		Constant,	// bits: the double (or null array) itself; rematerialized at each use
+	};
+
+	Kind kind = None;
+	int32_t index = 0;
+	uint64_t bits = 0;
+
+	bool operator==(const Location&) const = default;
+
+	static Location xmm(int n) { return {Xmm, n}; }
+	static Location gp(int n) { return {Gp, n}; }
+};
+
+// General registers by hardware encoding
+enum GpRegister : int { Rax, Rcx, Rdx, Rbx, Rsp, Rbp, Rsi, Rdi, R8, R9, R10, R11, R12, R13, R14, R15 };
+
+// Linear-scan register allocation (Poletto and Sarkar) over an SSA IRFunction. Blocks are
+// laid out in reverse postorder and instructions numbered along that order; block-level
+// liveness stretches each value into one interval that covers every point where it is
+// live. A phi operand counts as used at the end of the predecessor it comes from.
+//
+// Two register files: floats that are not live across a call live in xmm2..xmm15 (every
+// xmm register is caller-saved in the System V ABI); arrays and floats that must survive
+// a call go to the callee-saved rbx and r12..r15. When a file is full the interval that
+// ends last is spilled to a stack slot. Constants are never allocated.
+class LinearScanAllocator {
+public:
+	struct Allocation {
+		std::vector<Location> locations;	// by ValueId
+		std::vector<BlockId> layout;		// block emission order
+		uint32_t spillSlots = 0;
+		std::vector<int> calleeSaved;		// callee-saved registers handed out, to save in the prologue
+	};
+
+	static constexpr int xmmPool[] = {2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
+	static constexpr int gpPool[] = {Rbx, R12, R13, R14, R15};
+
+	// Instructions the backend implements with a call, which clobbers caller-saved registers
+	static bool callsOut(IROp op) {
+		return op == IROp::Call || op == IROp::Mod || op == IROp::Pow || op == IROp::NewArray;
+	}
+
+	Allocation allocate(const IRFunction& function) {
+		Allocation result;
+		result.layout = function.reversePostorder();
+		result.locations.assign(function.values.size(), Location{});
+		computeIntervals(function, result.layout);
+
+		for (Interval& interval : intervals) {
+			const IRInstruction& in = function.values[interval.value];
+			if (in.op == IROp::Const) {
+				Location constant{Location::Constant};
+				std::memcpy(&constant.bits, &in.constant, sizeof constant.bits);
+				if (in.type == IRType::Array) constant.bits = 0;
+				result.locations[interval.value] = constant;
+				interval.value = noValue;
+			}
+		}
+		std::erase_if(intervals, [](const Interval& interval) { return interval.value == noValue; });
+		std::sort(intervals.begin(), intervals.end(), [](const Interval& a, const Interval& b) { return a.start < b.start; });
+
+		scan(result, true);
+		scan(result, false);
+		return result;
+	}
+
+private:
+	struct Interval {
+		ValueId value;
+		uint32_t start;
+		uint32_t end;
+		bool general;	// needs a callee-saved general register
+	};
+
+	std::vector<Interval> intervals;
+
+	void computeIntervals(const IRFunction& function, const std::vector<BlockId>& layout) {
+		const size_t n = function.values.size();
+		const size_t words = (n + 63) / 64;
+		std::vector<uint32_t> position(n, 0), blockStart(function.blocks.size(), 0), blockEnd(function.blocks.size(), 0);
+		std::vector<uint32_t> calls;
+		uint32_t next = 0;
+		for (BlockId b : layout) {
+			blockStart[b] = next;
+			for (ValueId v : function.blocks[b].instructions) {
+				position[v] = next;
+				if (callsOut(function.values[v].op)) calls.push_back(next);
+				next += 2;
+			}
+			blockEnd[b] = next - 2;
+		}
+
+		// Block liveness: live-in = uses before any definition + (live-out - defs); phi
+		// operands are live out of their predecessor, phi results defined at block start
+		std::vector<std::vector<uint64_t>> liveIn(function.blocks.size(), std::vector<uint64_t>(words));
+		std::vector<std::vector<uint64_t>> liveOut = liveIn;
+		auto set = [](std::vector<uint64_t>& bits, ValueId v) { bits[v / 64] |= uint64_t(1) << (v % 64); };
+		for (bool changed = true; changed;) {
+			changed = false;
+			for (auto it = layout.rbegin(); it != layout.rend(); ++it) {
+				const BlockId b = *it;
+				std::vector<uint64_t> live(words);
+				function.blocks[b].forEachSuccessor(function.values, [&](BlockId s) {
+					for (size_t w = 0; w < words; ++w) live[w] |= liveIn[s][w];
+					const auto& preds = function.blocks[s].preds;
+					size_t slot = std::find(preds.begin(), preds.end(), b) - preds.begin();
+					for (ValueId v : function.blocks[s].instructions) {
+						const IRInstruction& phi = function.values[v];
+						if (phi.op != IROp::Phi) break;
+						set(live, phi.operands[slot]);
+					}
+				});
+				liveOut[b] = live;
+				const auto& list = function.blocks[b].instructions;
+				for (auto i = list.rbegin(); i != list.rend(); ++i) {
+					const IRInstruction& in = function.values[*i];
+					live[*i / 64] &= ~(uint64_t(1) << (*i % 64));
+					if (in.op == IROp::Phi) continue;
+					for (ValueId operand : in.operands) set(live, operand);
+				}
+				if (live != liveIn[b]) {
+					liveIn[b] = std::move(live);
+					changed = true;
+				}
+			}
+		}
+
+		std::vector<uint32_t> start(n, UINT32_MAX), end(n, 0);
+		auto cover = [&](ValueId v, uint32_t p) {
+			start[v] = std::min(start[v], p);
+			end[v] = std::max(end[v], p);
+		};
+		// Only the set bits of each block's sets, not every value per block
+		auto forEachBit = [](const std::vector<uint64_t>& bits, auto&& f) {
+			for (size_t w = 0; w < bits.size(); ++w) {
+				for (uint64_t word = bits[w]; word; word &= word - 1) f(static_cast<ValueId>(w * 64 + std::countr_zero(word)));
+			}
+		};
+		for (BlockId b : layout) {
+			forEachBit(liveIn[b], [&](ValueId v) { cover(v, blockStart[b]); });
+			forEachBit(liveOut[b], [&](ValueId v) { cover(v, blockEnd[b]); });
+			for (ValueId v : function.blocks[b].instructions) {
+				const IRInstruction& in = function.values[v];
+				cover(v, in.op == IROp::Param ? 0 : position[v]);	// parameters all arrive at once
+				if (in.op == IROp::Phi) continue;
+				for (ValueId operand : in.operands) cover(operand, position[v]);
+			}
+		}
+
+		intervals.clear();
+		for (ValueId v = 0; v < n; ++v) {
+			const IRInstruction& in = function.values[v];
+			if (in.dead || in.type == IRType::Void || start[v] == UINT32_MAX || in.users.empty()) continue;
+			auto call = std::upper_bound(calls.begin(), calls.end(), start[v]);
+			bool crossesCall = call != calls.end() && *call < end[v];
+			intervals.push_back({v, start[v], end[v], in.type == IRType::Array || crossesCall});
+		}
+	}
+
+	void scan(Allocation& result, bool general) {
+		std::vector<int> free;
+		if (general) free.assign(std::rbegin(gpPool), std::rend(gpPool));
+		else free.assign(std::rbegin(xmmPool), std::rend(xmmPool));
+		std::vector<const Interval*> active;	// sorted by end
+		auto makeLocation = [&](int reg) { return general ? Location::gp(reg) : Location::xmm(reg); };
+
+		for (const Interval& interval : intervals) {
+			if (interval.general != general) continue;
+			while (!active.empty() && active.front()->end <= interval.start) {
+				free.push_back(result.locations[active.front()->value].index);
+				active.erase(active.begin());
+			}
+			auto insertActive = [&](const Interval* i) {
+				active.insert(std::upper_bound(active.begin(), active.end(), i,
+											   [](const Interval* a, const Interval* b) { return a->end < b->end; }), i);
+			};
+			if (!free.empty()) {
+				int reg = free.back();
+				free.pop_back();
+				result.locations[interval.value] = makeLocation(reg);
+				if (general && std::find(result.calleeSaved.begin(), result.calleeSaved.end(), reg) == result.calleeSaved.end()) {
+					result.calleeSaved.push_back(reg);
+				}
+				insertActive(&interval);
+				continue;
+			}
+			const Interval* victim = active.back();
+			if (victim->end > interval.end) {
+				result.locations[interval.value] = result.locations[victim->value];
+				result.locations[victim->value] = Location{Location::Stack, static_cast<int32_t>(result.spillSlots++)};
+				active.pop_back();
+				insertActive(&interval);
+			} else {
+				result.locations[interval.value] = Location{Location::Stack, static_cast<int32_t>(result.spillSlots++)};
+			}
+		}
+	}
+};
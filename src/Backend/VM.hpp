@@ -0,0 +1,150 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Bytecode.hpp"
+#include "Value.hpp"
+
+// GCC and Clang can dispatch through a table of label addresses ("computed goto"), which
+// gives every instruction its own indirect branch instead of one shared switch jump.
+// Other compilers get the switch loop.
+#if defined(__GNUC__)
+#define VM_COMPUTED_GOTO 1
+#endif
+
+// Runs a BytecodeModule. Registers of all active calls live in one preallocated stack;
+// a call slides the window up to the argument registers, so arguments are never copied.
+class VM {
+public:
+	enum class Dispatch { Threaded, Switch };
+
+#if defined(VM_COMPUTED_GOTO)
+	static constexpr Dispatch defaultDispatch = Dispatch::Threaded;
+#else
+	static constexpr Dispatch defaultDispatch = Dispatch::Switch;
+#endif
+
+	explicit VM(const BytecodeModule& module, size_t stackSize = 1 << 20)
+		: module(module), stack(std::make_unique<Value[]>(stackSize)), stackEnd(stack.get() + stackSize) {}
+
+	// Runs module.functions[function] with args and returns its result. Runtime faults
+	// (bad index, stack overflow, ...) throw std::runtime_error.
+	Value call(uint32_t function, std::span<const Value> args = {}, Dispatch dispatch = defaultDispatch) {
+		const BytecodeFunction& callee = module.functions.at(function);
+		if (args.size() != callee.params) throw std::runtime_error("Wrong number of arguments.");
+		if (stack.get() + callee.registers > stackEnd) throw std::runtime_error("Runtime error: stack overflow.");
+		std::copy(args.begin(), args.end(), stack.get());
+		frames.clear();
+#if defined(VM_COMPUTED_GOTO)
+		if (dispatch == Dispatch::Threaded) return execute<true>(&callee, stack.get());
+#endif
+		return execute<false>(&callee, stack.get());
+	}
+
+	Heap& heap() { return arrays; }
+
+private:
+	struct Frame {
+		const BytecodeFunction* function;
+		const Instruction* returnTo;
+		Value* base;
+	};
+
+	const BytecodeModule& module;
+	std::unique_ptr<Value[]> stack;
+	Value* stackEnd;
+	std::vector<Frame> frames;
+	Heap arrays;
+
+	template<bool Threaded>
+	Value execute(const BytecodeFunction* function, Value* r) {
+		const Instruction* pc = function->code.data();
+		const double* k = function->constants.data();
+
+#if defined(VM_COMPUTED_GOTO)
+		static void* const labels[] = {
+#define VM_LABEL(name) &&op_##name,
+			BYTECODE_OPCODES(VM_LABEL)
+#undef VM_LABEL
+		};
+#define VM_NEXT() do { if constexpr (Threaded) goto *labels[static_cast<size_t>(pc->op)]; else goto dispatch; } while (0)
+#else
+#define VM_NEXT() goto dispatch
+#endif
+#define VM_CASE(name) case Opcode::name: op_##name:
+#define A r[pc->a]
+#define B r[pc->b]
+#define C r[pc->c]
+
+	[[maybe_unused]] dispatch:
+		switch (pc->op) {
+			VM_CASE(Move) A = B; ++pc; VM_NEXT();
+			VM_CASE(LoadK) A.number = k[pc->bx()]; ++pc; VM_NEXT();
+
+			VM_CASE(Add) A.number = B.number + C.number; ++pc; VM_NEXT();
+			VM_CASE(Sub) A.number = B.number - C.number; ++pc; VM_NEXT();
+			VM_CASE(Mul) A.number = B.number * C.number; ++pc; VM_NEXT();
+			VM_CASE(Div) A.number = B.number / C.number; ++pc; VM_NEXT();
+			VM_CASE(Mod) A.number = std::fmod(B.number, C.number); ++pc; VM_NEXT();
+			VM_CASE(Pow) A.number = std::pow(B.number, C.number); ++pc; VM_NEXT();
+			VM_CASE(AddI) A.number = B.number + static_cast<int16_t>(pc->c); ++pc; VM_NEXT();
+
+			VM_CASE(Equal) A.number = B.number == C.number; ++pc; VM_NEXT();
+			VM_CASE(NotEqual) A.number = B.number != C.number; ++pc; VM_NEXT();
+			VM_CASE(Less) A.number = B.number < C.number; ++pc; VM_NEXT();
+			VM_CASE(LessEqual) A.number = B.number <= C.number; ++pc; VM_NEXT();
+			VM_CASE(Greater) A.number = B.number > C.number; ++pc; VM_NEXT();
+			VM_CASE(GreaterEqual) A.number = B.number >= C.number; ++pc; VM_NEXT();
+
+			VM_CASE(Neg) A.number = -B.number; ++pc; VM_NEXT();
+			VM_CASE(Not) A.number = B.number == 0; ++pc; VM_NEXT();
+
+			VM_CASE(Jump) pc = function->code.data() + pc->bx(); VM_NEXT();
+			VM_CASE(JumpIfFalse) pc = A.number == 0 ? function->code.data() + pc->bx() : pc + 1; VM_NEXT();
+			VM_CASE(JumpIfTrue) pc = A.number != 0 ? function->code.data() + pc->bx() : pc + 1; VM_NEXT();
+
+			VM_CASE(NewArray) A.array = arrays.newArray(B.number); ++pc; VM_NEXT();
+			VM_CASE(Length) A.number = arrayLength(B.array); ++pc; VM_NEXT();
+			VM_CASE(GetIndex) A.number = elementAt(B.array, C.number); ++pc; VM_NEXT();
+			VM_CASE(SetIndex) elementAt(A.array, B.number) = C.number; ++pc; VM_NEXT();
+
+			VM_CASE(Call) {
+				const BytecodeFunction* callee = &module.functions[pc->bx()];
+				Value* base = r + pc->a;
+				if (base + callee->registers > stackEnd) throw std::runtime_error("Runtime error: stack overflow.");
+				frames.push_back({function, pc + 1, r});
+				function = callee;
+				r = base;
+				pc = callee->code.data();
+				k = callee->constants.data();
+				VM_NEXT();
+			}
+			VM_CASE(Return) {
+				Value result = A;
+				if (frames.empty()) return result;
+				r[0] = result;	// the caller's argument base
+				const Frame& caller = frames.back();
+				function = caller.function;
+				pc = caller.returnTo;
+				r = caller.base;
+				k = function->constants.data();
+				frames.pop_back();
+				VM_NEXT();
+			}
+		}
+		throw std::runtime_error("Corrupt bytecode.");
+
+#undef A
+#undef B
+#undef C
+#undef VM_CASE
+#undef VM_NEXT
+	}
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+#include "Arena.hpp"
+
+// Runtime values shared by the VM and the AST interpreter. The executable part of the
+// language has two kinds of value: float, held as a double, and float[], a reference to
+// an array of doubles. The type checker guarantees every read agrees with what was
+// stored, so a Value carries no tag. A zero Value is 0.0 and the null array.
+struct ArrayObject {
+	double* elements;
+	size_t length;
+};
+
+union Value {
+	double number = 0;
+	ArrayObject* array;
+};
+
+// Allocates arrays for a running program. Everything is released with the heap; there
+// is no collector, which is fine for the batch programs this runs.
+class Heap {
+private:
+	Arena arena;
+
+public:
+	static constexpr double maxLength = 1u << 30;
+
+	ArrayObject* newArray(double length) {
+		if (!(length >= 0 && length <= maxLength)) {
+			throw std::runtime_error("Runtime error: invalid array length " + std::to_string(length) + ".");
+		}
+		const size_t count = static_cast<size_t>(length);
+		auto* elements = static_cast<double*>(arena.allocate(sizeof(double) * (count ? count : 1), alignof(double)));
+		std::fill(elements, elements + count, 0.0);
+		return arena.make<ArrayObject>(ArrayObject{elements, count});
+	}
+
+	size_t bytesUsed() const { return arena.bytesUsed(); }
+};
+
+// Bounds-checked element access; index is the float the program computed
+inline double& elementAt(ArrayObject* array, double index) {
+	if (!array) throw std::runtime_error("Runtime error: use of an array that was never assigned.");
+	if (!(index >= 0 && index < static_cast<double>(array->length))) {
+		throw std::runtime_error("Runtime error: index " + std::to_string(index) + " out of range for an array of " +
+								 std::to_string(array->length) + ".");
+	}
+	return array->elements[static_cast<size_t>(index)];
+}
+
+inline double arrayLength(ArrayObject* array) {
+	if (!array) throw std::runtime_error("Runtime error: use of an array that was never assigned.");
+	return static_cast<double>(array->length);
+}
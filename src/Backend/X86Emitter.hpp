@@ -0,0 +1,470 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "FManager.hpp"
+#include "IR.hpp"
+#include "LinearScan.hpp"
+
+// x86-64 System V backend: lowers an optimized IRModule to GNU assembler text (AT&T
+// syntax) for the host's `as`/`cc`. Every function is a global symbol, its source name
+// after the emitter's symbol prefix, with the C signature given by cHeader(), so the object
+// links straight into a C or C++ program. With the default empty prefix the functions share
+// the C namespace; a name the generated code calls itself (pow, fmod, calloc, abort,
+// compiler_runtime_fault) is rejected, and any other libc name would interpose on it, so
+// hosts that link untrusted names should pass a prefix:
+//
+//   float       double, passed and returned in xmm registers
+//   float[]     struct compiler_array* ({double* elements; size_t length}, the layout of
+//               ArrayObject), passed in general registers and returned in rax
+//
+// Arguments that do not fit in registers go on the stack as the ABI says. Arrays made by
+// compiled code come from calloc and are never freed. Run-time errors (null array, index
+// out of range, bad array length, out of memory) call compiler_runtime_fault(code); the
+// module carries a weak default that aborts, which the host may replace.
+//
+// Phis are resolved with parallel moves on each incoming edge; a branch gets a small stub
+// for the edge that needs moves, so critical edges are never shared.
+class X86Emitter {
+public:
+	enum Fault : int { NullArray = 1, IndexOutOfRange, BadLength, OutOfMemory };
+
+	explicit X86Emitter(std::string symbolPrefix = {}) : symbolPrefix(std::move(symbolPrefix)) {}
+
+	// Throws std::runtime_error if a function's symbol is one the generated code calls
+	std::string emit(const IRModule& module) {
+		for (const IRFunction& function : module.functions) {
+			const std::string name = symbolOf(function);
+			for (const char* reserved : runtimeSymbols) {
+				if (name == reserved) {
+					throw std::runtime_error("Function symbol '" + name +
+											 "' is used by the generated code; emit with a symbol prefix.");
+				}
+			}
+		}
+		out.str({});
+		constants.clear();
+		out << "\t.text\n";
+		for (const IRFunction& function : module.functions) emitFunction(module, function);
+		emitRuntime();
+		return out.str();
+	}
+
+	bool writeAssembly(const IRModule& module, const FManager& files, const std::string& filename) {
+		return files.writeFile(filename, emit(module));
+	}
+
+	// C declarations of the module's functions, for the host side of the link
+	std::string cHeader(const IRModule& module) const {
+		std::ostringstream h;
+		h << "#pragma once\n\n#include <stddef.h>\n\n#ifdef __cplusplus\nextern \"C\" {\n#endif\n\n"
+		  << "struct compiler_array {\n\tdouble* elements;\n\tsize_t length;\n};\n\n"
+		  << "void compiler_runtime_fault(int code);\n";
+		for (const IRFunction& function : module.functions) {
+			h << cType(function.result) << " " << symbolOf(function) << "(";
+			for (size_t i = 0; i < function.params.size(); ++i) h << (i ? ", " : "") << cType(function.params[i]);
+			if (function.params.empty()) h << "void";
+			h << ");\n";
+		}
+		h << "\n#ifdef __cplusplus\n}\n#endif\n";
+		return h.str();
+	}
+
+private:
+	// Called from every module, so no function may take these names
+	static constexpr const char* runtimeSymbols[] = {"pow", "fmod", "calloc", "abort", "compiler_runtime_fault"};
+
+	std::string symbolPrefix;	// prepended to every function's source name
+	std::ostringstream out;
+	std::unordered_map<uint64_t, uint32_t> constants;	// bits -> label number
+	const IRFunction* fn = nullptr;
+	LinearScanAllocator::Allocation alloc;
+	std::string prefix;			// local labels of the current function
+	int32_t frameBase = 0;		// rbp offset just below the saved registers
+	uint32_t faults = 0;		// bitmask of fault stubs the function needs
+	uint32_t stubs = 0;
+
+	static constexpr const char* gpNames[] = {"%rax", "%rcx", "%rdx", "%rbx", "%rsp", "%rbp", "%rsi", "%rdi",
+											  "%r8", "%r9", "%r10", "%r11", "%r12", "%r13", "%r14", "%r15"};
+	static constexpr int gpArguments[] = {Rdi, Rsi, Rdx, Rcx, R8, R9};
+
+	std::string symbolOf(const IRFunction& function) const {
+		std::ostringstream name;
+		name << symbolPrefix << function.name;
+		return name.str();
+	}
+
+	static const char* cType(IRType type) {
+		return type == IRType::Array ? "struct compiler_array*" : type == IRType::Float ? "double" : "void";
+	}
+
+	static std::string xmm(int n) { return "%xmm" + std::to_string(n); }
+
+	std::string label(BlockId b) const { return prefix + "b" + std::to_string(b); }
+	std::string faultLabel(Fault fault) {
+		faults |= 1u << fault;
+		return prefix + "fault" + std::to_string(fault);
+	}
+
+	std::string constant(uint64_t bits) {
+		auto [it, inserted] = constants.emplace(bits, static_cast<uint32_t>(constants.size()));
+		return ".LC" + std::to_string(it->second) + "(%rip)";
+	}
+
+	std::string memory(const Location& at) const {
+		int32_t offset = at.kind == Location::Incoming ? 16 + 8 * at.index : frameBase - 8 * (at.index + 1);
+		return std::to_string(offset) + "(%rbp)";
+	}
+
+	// Operand text for a location that an SSE instruction can read directly; a value in a
+	// general register is copied to the scratch xmm register first
+	std::string xmmSource(const Location& at, int scratch) {
+		switch (at.kind) {
+			case Location::Xmm: return xmm(at.index);
+			case Location::Stack: case Location::Incoming: return memory(at);
+			case Location::Constant: return constant(at.bits);
+			default:
+				out << "\tmovq\t" << gpNames[at.index] << ", " << xmm(scratch) << "\n";
+				return xmm(scratch);
+		}
+	}
+
+	void loadXmm(const Location& at, int reg) {
+		if (at.kind == Location::Xmm && at.index == reg) return;
+		if (at.kind == Location::Constant && at.bits == 0) {
+			out << "\txorpd\t" << xmm(reg) << ", " << xmm(reg) << "\n";
+			return;
+		}
+		if (at.kind == Location::Xmm) out << "\tmovapd\t" << xmm(at.index) << ", " << xmm(reg) << "\n";
+		else if (at.kind == Location::Gp) out << "\tmovq\t" << gpNames[at.index] << ", " << xmm(reg) << "\n";
+		else out << "\tmovsd\t" << xmmSource(at, reg) << ", " << xmm(reg) << "\n";
+	}
+
+	void storeXmm(int reg, const Location& at) {
+		switch (at.kind) {
+			case Location::None: return;
+			case Location::Xmm: if (at.index != reg) out << "\tmovapd\t" << xmm(reg) << ", " << xmm(at.index) << "\n"; return;
+			case Location::Gp: out << "\tmovq\t" << xmm(reg) << ", " << gpNames[at.index] << "\n"; return;
+			default: out << "\tmovsd\t" << xmm(reg) << ", " << memory(at) << "\n"; return;
+		}
+	}
+
+	void loadGp(const Location& at, int reg) {
+		switch (at.kind) {
+			case Location::Gp: if (at.index != reg) out << "\tmovq\t" << gpNames[at.index] << ", " << gpNames[reg] << "\n"; return;
+			case Location::Xmm: out << "\tmovq\t" << xmm(at.index) << ", " << gpNames[reg] << "\n"; return;
+			case Location::Constant:
+				if (at.bits == 0) out << "\txorq\t" << gpNames[reg] << ", " << gpNames[reg] << "\n";
+				else out << "\tmovabsq\t$" << at.bits << ", " << gpNames[reg] << "\n";
+				return;
+			default: out << "\tmovq\t" << memory(at) << ", " << gpNames[reg] << "\n"; return;
+		}
+	}
+
+	void storeGp(int reg, const Location& at) {
+		switch (at.kind) {
+			case Location::None: return;
+			case Location::Gp: if (at.index != reg) out << "\tmovq\t" << gpNames[reg] << ", " << gpNames[at.index] << "\n"; return;
+			case Location::Xmm: out << "\tmovq\t" << gpNames[reg] << ", " << xmm(at.index) << "\n"; return;
+			default: out << "\tmovq\t" << gpNames[reg] << ", " << memory(at) << "\n"; return;
+		}
+	}
+
+	void move(const Location& from, const Location& to) {
+		if (from == to || to.kind == Location::None) return;
+		if (to.kind == Location::Xmm) loadXmm(from, to.index);
+		else if (to.kind == Location::Gp) loadGp(from, to.index);
+		else if (from.kind == Location::Xmm) storeXmm(from.index, to);
+		else if (from.kind == Location::Gp) storeGp(from.index, to);
+		else {
+			loadGp(from, R10);
+			storeGp(R10, to);
+		}
+	}
+
+	// Performs all moves as if at once. A move is safe once no other pending move still
+	// reads its destination; when only cycles are left, one destination is saved in r11
+	// and its readers redirected there, which opens the cycle. r10 is left free for
+	// memory-to-memory moves.
+	void parallelMove(std::vector<std::pair<Location, Location>> moves) {
+		std::erase_if(moves, [](const auto& m) { return m.first == m.second || m.second.kind == Location::None; });
+		while (!moves.empty()) {
+			bool progress = false;
+			for (size_t i = 0; i < moves.size(); ++i) {
+				bool blocked = false;
+				for (size_t j = 0; j < moves.size() && !blocked; ++j) blocked = j != i && moves[j].first == moves[i].second;
+				if (blocked) continue;
+				move(moves[i].first, moves[i].second);
+				moves.erase(moves.begin() + i);
+				progress = true;
+				break;
+			}
+			if (progress) continue;
+			const Location saved = moves[0].second, temp = Location::gp(R11);
+			move(saved, temp);
+			for (auto& m : moves) {
+				if (m.first == saved) m.first = temp;
+			}
+		}
+	}
+
+	const Location& at(ValueId v) const { return alloc.locations[v]; }
+
+	// Where the ABI puts each of a signature's arguments
+	static std::vector<Location> argumentLocations(const std::vector<IRType>& types, uint32_t& stackWords) {
+		std::vector<Location> locations;
+		int floats = 0, integers = 0;
+		stackWords = 0;
+		for (IRType type : types) {
+			if (type == IRType::Array && integers < 6) locations.push_back(Location::gp(gpArguments[integers++]));
+			else if (type != IRType::Array && floats < 8) locations.push_back(Location::xmm(floats++));
+			else locations.push_back({Location::Incoming, static_cast<int32_t>(stackWords++)});
+		}
+		return locations;
+	}
+
+	void emitFunction(const IRModule& module, const IRFunction& function) {
+		fn = &function;
+		alloc = LinearScanAllocator().allocate(function);
+		const std::string symbol = symbolOf(function);
+		prefix = ".L" + symbol + "_";
+		faults = 0;
+		stubs = 0;
+
+		// Frame: saved rbp, saved callee-saved registers, spill slots, one scratch slot;
+		// rsp stays 16-byte aligned from the end of the prologue on
+		const int32_t saved = static_cast<int32_t>(alloc.calleeSaved.size());
+		frameBase = -8 * saved;
+		uint32_t slots = alloc.spillSlots + 1;
+		if ((saved + slots) % 2) ++slots;
+		const Location scratch{Location::Stack, static_cast<int32_t>(alloc.spillSlots)};
+
+		out << "\n\t.globl\t" << symbol << "\n\t.type\t" << symbol << ", @function\n"
+			<< "\t.p2align 4\n" << symbol << ":\n\t.cfi_startproc\n"
+			<< "\tpushq\t%rbp\n\t.cfi_def_cfa_offset 16\n\t.cfi_offset %rbp, -16\n"
+			<< "\tmovq\t%rsp, %rbp\n\t.cfi_def_cfa_register %rbp\n";
+		for (int32_t i = 0; i < saved; ++i) {
+			out << "\tpushq\t" << gpNames[alloc.calleeSaved[i]] << "\n\t.cfi_offset " << gpNames[alloc.calleeSaved[i]]
+				<< ", " << -24 - 8 * i << "\n";
+		}
+		out << "\tsubq\t$" << 8 * slots << ", %rsp\n";
+
+		uint32_t stackWords;
+		std::vector<Location> incoming = argumentLocations(function.params, stackWords);
+		std::vector<std::pair<Location, Location>> params;
+		for (const IRInstruction& in : function.values) {
+			if (in.op == IROp::Param && !in.dead) params.push_back({incoming[in.index], at(&in - function.values.data())});
+		}
+		parallelMove(std::move(params));
+
+		for (size_t i = 0; i < alloc.layout.size(); ++i) {
+			const BlockId b = alloc.layout[i];
+			const BlockId next = i + 1 < alloc.layout.size() ? alloc.layout[i + 1] : noValue;
+			out << label(b) << ":\n";
+			for (ValueId v : function.blocks[b].instructions) emitInstruction(module, b, v, next, scratch);
+		}
+
+		// The last block in the layout falls into the epilogue; fault stubs go after it
+		out << prefix << "return:\n\t.cfi_remember_state\n";
+		if (saved) out << "\tleaq\t" << frameBase << "(%rbp), %rsp\n";
+		else out << "\tmovq\t%rbp, %rsp\n";
+		for (int32_t i = saved - 1; i >= 0; --i) out << "\tpopq\t" << gpNames[alloc.calleeSaved[i]] << "\n";
+		out << "\tpopq\t%rbp\n\t.cfi_def_cfa %rsp, 8\n\tret\n\t.cfi_restore_state\n";
+		for (int fault = NullArray; fault <= OutOfMemory; ++fault) {
+			if (!(faults & (1u << fault))) continue;
+			out << prefix << "fault" << fault << ":\n\tmovl\t$" << fault << ", %edi\n"
+				<< "\tcall\tcompiler_runtime_fault@PLT\n\tud2\n";
+		}
+		out << "\t.cfi_endproc\n\t.size\t" << symbol << ", .-" << symbol << "\n";
+	}
+
+	// Phi moves for the edge from -> to
+	std::vector<std::pair<Location, Location>> edgeMoves(BlockId from, BlockId to) const {
+		std::vector<std::pair<Location, Location>> moves;
+		const auto& preds = fn->blocks[to].preds;
+		size_t slot = std::find(preds.begin(), preds.end(), from) - preds.begin();
+		for (ValueId v : fn->blocks[to].instructions) {
+			const IRInstruction& phi = fn->values[v];
+			if (phi.op != IROp::Phi) break;
+			moves.push_back({at(phi.operands[slot]), at(v)});
+		}
+		return moves;
+	}
+
+	void jumpTo(BlockId from, BlockId to, BlockId next) {
+		parallelMove(edgeMoves(from, to));
+		if (to != next) out << "\tjmp\t" << label(to) << "\n";
+	}
+
+	void call(const char* target) { out << "\tcall\t" << target << "@PLT\n"; }
+
+	// Array pointer into rax, faulting on null
+	void loadArray(ValueId v) {
+		loadGp(at(v), Rax);
+		out << "\ttestq\t%rax, %rax\n\tje\t" << faultLabel(NullArray) << "\n";
+	}
+
+	void emitInstruction(const IRModule& module, BlockId b, ValueId v, BlockId next, const Location& scratch) {
+		const IRInstruction& in = fn->values[v];
+		const Location& dst = at(v);
+		auto operand = [&](size_t i) -> const Location& { return at(in.operands[i]); };
+
+		switch (in.op) {
+			case IROp::Const: case IROp::Param: case IROp::Phi: case IROp::Read: case IROp::Write:
+				return;
+			case IROp::Add: case IROp::Sub: case IROp::Mul: case IROp::Div: {
+				if (dst.kind == Location::None) return;
+				static constexpr const char* names[] = {"addsd", "subsd", "mulsd", "divsd"};
+				const char* name = names[static_cast<int>(in.op) - static_cast<int>(IROp::Add)];
+				// Compute in place when the destination is a register the right operand is not in
+				int reg = dst.kind == Location::Xmm && !(operand(1) == dst) ? dst.index : 0;
+				loadXmm(operand(0), reg);
+				const std::string rhs = xmmSource(operand(1), 1);
+				out << "\t" << name << "\t" << rhs << ", " << xmm(reg) << "\n";
+				storeXmm(reg, dst);
+				return;
+			}
+			case IROp::Mod: case IROp::Pow:
+				if (dst.kind == Location::None) return;
+				loadXmm(operand(0), 0);
+				loadXmm(operand(1), 1);
+				call(in.op == IROp::Mod ? "fmod" : "pow");
+				storeXmm(0, dst);
+				return;
+			case IROp::Equal: case IROp::NotEqual: case IROp::Less: case IROp::LessEqual:
+			case IROp::Greater: case IROp::GreaterEqual: {
+				if (dst.kind == Location::None) return;
+				// cmpXXsd leaves an all-ones mask when true; masking 1.0 with it gives 1 or 0
+				const char* name = "cmpeqsd";
+				bool swap = in.op == IROp::Greater || in.op == IROp::GreaterEqual;
+				if (in.op == IROp::NotEqual) name = "cmpneqsd";
+				else if (in.op == IROp::Less || in.op == IROp::Greater) name = "cmpltsd";
+				else if (in.op == IROp::LessEqual || in.op == IROp::GreaterEqual) name = "cmplesd";
+				loadXmm(operand(swap ? 1 : 0), 0);
+				const std::string rhs = xmmSource(operand(swap ? 0 : 1), 1);
+				out << "\t" << name << "\t" << rhs << ", %xmm0\n";
+				out << "\tandpd\t.LCone(%rip), %xmm0\n";
+				storeXmm(0, dst);
+				return;
+			}
+			case IROp::Neg:
+				if (dst.kind == Location::None) return;
+				loadXmm(operand(0), 0);
+				out << "\txorpd\t.LCsign(%rip), %xmm0\n";
+				storeXmm(0, dst);
+				return;
+			case IROp::Not:
+				if (dst.kind == Location::None) return;
+				loadXmm(operand(0), 0);
+				out << "\txorpd\t%xmm1, %xmm1\n\tcmpeqsd\t%xmm1, %xmm0\n\tandpd\t.LCone(%rip), %xmm0\n";
+				storeXmm(0, dst);
+				return;
+			case IROp::NewArray: {
+				// Length must be a number in [0, 2^30]; the object and its elements are one block
+				const std::string bad = faultLabel(BadLength);
+				loadXmm(operand(0), 0);
+				out << "\txorpd\t%xmm1, %xmm1\n\tucomisd\t%xmm1, %xmm0\n\tjp\t" << bad << "\n\tjb\t" << bad << "\n"
+					<< "\tucomisd\t.LCmaxLength(%rip), %xmm0\n\tja\t" << bad << "\n"
+					<< "\tcvttsd2si\t%xmm0, %rax\n\tmovq\t%rax, " << memory(scratch) << "\n"
+					<< "\tleaq\t16(,%rax,8), %rsi\n\tmovl\t$1, %edi\n";
+				call("calloc");
+				out << "\ttestq\t%rax, %rax\n\tje\t" << faultLabel(OutOfMemory) << "\n"
+					<< "\tmovq\t" << memory(scratch) << ", %rcx\n\tmovq\t%rcx, 8(%rax)\n"
+					<< "\tleaq\t16(%rax), %rcx\n\tmovq\t%rcx, (%rax)\n";
+				storeGp(Rax, dst);
+				return;
+			}
+			case IROp::Length:
+				loadArray(in.operands[0]);
+				if (dst.kind == Location::None) return;
+				out << "\tcvtsi2sdq\t8(%rax), %xmm0\n";
+				storeXmm(0, dst);
+				return;
+			case IROp::GetIndex: case IROp::SetIndex: {
+				// Same rule as ArrayObject access in the VM: 0 <= index < length, then truncate
+				const std::string range = faultLabel(IndexOutOfRange);
+				loadArray(in.operands[0]);
+				loadXmm(operand(1), 0);
+				out << "\txorpd\t%xmm1, %xmm1\n\tucomisd\t%xmm1, %xmm0\n\tjp\t" << range << "\n\tjb\t" << range << "\n"
+					<< "\tcvtsi2sdq\t8(%rax), %xmm1\n\tucomisd\t%xmm1, %xmm0\n\tjae\t" << range << "\n"
+					<< "\tcvttsd2si\t%xmm0, %rcx\n\tmovq\t(%rax), %rdx\n";
+				if (in.op == IROp::GetIndex) {
+					if (dst.kind == Location::None) return;
+					out << "\tmovsd\t(%rdx,%rcx,8), %xmm0\n";
+					storeXmm(0, dst);
+				} else {
+					loadGp(operand(2), Rsi);
+					out << "\tmovq\t%rsi, (%rdx,%rcx,8)\n";
+				}
+				return;
+			}
+			case IROp::Call: {
+				const IRFunction& callee = module.functions[in.index];
+				uint32_t stackWords;
+				std::vector<Location> targets = argumentLocations(callee.params, stackWords);
+				const uint32_t padding = stackWords % 2;
+				if (padding) out << "\tsubq\t$8, %rsp\n";
+				for (size_t i = in.operands.size(); i-- > 0;) {
+					if (targets[i].kind != Location::Incoming) continue;
+					const Location& arg = operand(i);
+					if (arg.kind == Location::Gp) out << "\tpushq\t" << gpNames[arg.index] << "\n";
+					else if (arg.kind == Location::Stack) out << "\tpushq\t" << memory(arg) << "\n";
+					else {
+						loadGp(arg, R10);
+						out << "\tpushq\t%r10\n";
+					}
+				}
+				std::vector<std::pair<Location, Location>> moves;
+				for (size_t i = 0; i < in.operands.size(); ++i) {
+					if (targets[i].kind != Location::Incoming) moves.push_back({operand(i), targets[i]});
+				}
+				parallelMove(std::move(moves));
+				call(symbolOf(callee).c_str());
+				if (stackWords) out << "\taddq\t$" << 8 * (stackWords + padding) << ", %rsp\n";
+				if (in.type == IRType::Array) storeGp(Rax, dst);
+				else if (in.type == IRType::Float) storeXmm(0, dst);
+				return;
+			}
+			case IROp::Jump:
+				jumpTo(b, in.targets[0], next);
+				return;
+			case IROp::Branch: {
+				// Nonzero (NaN included) takes targets[0]; an edge with phi moves gets its own stub
+				const BlockId taken = in.targets[0], other = in.targets[1];
+				const bool stub = !edgeMoves(b, taken).empty();
+				const std::string target = stub ? prefix + "edge" + std::to_string(stubs++) : label(taken);
+				loadXmm(operand(0), 0);
+				out << "\txorpd\t%xmm1, %xmm1\n\tucomisd\t%xmm1, %xmm0\n\tjne\t" << target << "\n\tjp\t" << target << "\n";
+				jumpTo(b, other, stub ? noValue : next);
+				if (stub) {
+					out << target << ":\n";
+					jumpTo(b, taken, next);
+				}
+				return;
+			}
+			case IROp::Return:
+				if (fn->result == IRType::Array) loadGp(operand(0), Rax);
+				else loadXmm(operand(0), 0);
+				if (next != noValue) out << "\tjmp\t" << prefix << "return\n";
+				return;
+		}
+	}
+
+	void emitRuntime() {
+		out << "\n\t.weak\tcompiler_runtime_fault\n\t.type\tcompiler_runtime_fault, @function\n"
+			<< "compiler_runtime_fault:\n\t.cfi_startproc\n\tsubq\t$8, %rsp\n\t.cfi_def_cfa_offset 16\n"
+			<< "\tcall\tabort@PLT\n\t.cfi_endproc\n\t.size\tcompiler_runtime_fault, .-compiler_runtime_fault\n";
+		out << "\n\t.section\t.rodata\n\t.p2align 4\n"
+			<< ".LCone:\n\t.quad\t" << std::bit_cast<uint64_t>(1.0) << ", 0\n"
+			<< ".LCsign:\n\t.quad\t" << (uint64_t(1) << 63) << ", 0\n"
+			<< ".LCmaxLength:\n\t.quad\t" << std::bit_cast<uint64_t>(double(1 << 30)) << "\n";
+		for (const auto& [bits, n] : constants) out << ".LC" << n << ":\n\t.quad\t" << bits << "\n";
+		out << "\t.section\t.note.GNU-stack,\"\",@progbits\n";
+	}
+};
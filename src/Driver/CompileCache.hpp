@@ -0,0 +1,459 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <ostream>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "BytecodeCompiler.hpp"
+#include "FManager.hpp"
+#include "ParallelParse.hpp"
+#include "Resolver.hpp"
+#include "TypeChecker.hpp"
+#include "XXHash.hpp"
+
+struct CacheStats {
+	size_t hits = 0;		// functions whose bytecode came from the cache
+	size_t misses = 0;		// functions compiled from source
+	size_t stores = 0;		// entries written
+	size_t evictions = 0;	// entries deleted to stay under the size limit
+	size_t compactions = 0;	// pack rewrites that dropped deleted entries
+	size_t corrupt = 0;		// entries that failed to load and were dropped
+	size_t builds = 0;		// compile() calls
+	size_t fullHits = 0;	// builds that needed no parsing at all
+
+	double hitRate() const { return hits + misses ? static_cast<double>(hits) / static_cast<double>(hits + misses) : 0; }
+};
+
+inline std::ostream& operator<<(std::ostream& out, const CacheStats& stats) {
+	return out << stats.builds << " builds (" << stats.fullHits << " without parsing), " << stats.hits << " hits, "
+			   << stats.misses << " misses (" << stats.hitRate() * 100 << "% hit rate), " << stats.stores << " stores, "
+			   << stats.evictions << " evictions, " << stats.compactions << " compactions, " << stats.corrupt << " corrupt";
+}
+
+// On-disk cache of compiled functions, keyed by content. A source file is lexed and split
+// into top-level declarations (scanTopLevel); each function's key is the XXH64 of its
+// tokens plus, for every name it mentions that is another top-level declaration, that
+// declaration's global slot and the hash of its signature (a class: its whole body). A
+// change to a function's text, or to anything it calls or uses as a type, changes the
+// key; moving it around the file or editing an unrelated function does not.
+//
+// When every key hits, the BytecodeModule is assembled from the cache without parsing any
+// function; only the class declarations are parsed and checked, since a class that no
+// function mentions is part of no key.
+// Otherwise the functions that missed are parsed, resolved, checked and compiled for
+// real against a program in which the others are reduced to their signature and an empty
+// body, and the new bytecode is stored. The result is the module BytecodeCompiler would
+// produce for the whole file.
+//
+// Storage is two files in the directory given to the constructor, both through FManager:
+// a pack that new entries are appended to and that is read through one mapping, and an
+// index of each entry's place in the pack and last use, written by flush(). When the live
+// entries pass the size limit the least recently used are dropped, and once more than
+// half the pack is dropped entries it is rewritten. Every entry carries its key and is
+// checked on load, so a pack and index that disagree only cost misses. Not thread-safe:
+// one cache per thread, or a lock around it.
+class CompileCache {
+public:
+	static constexpr uint32_t formatVersion = 1;
+
+	// directory must exist; maxBytes bounds the live entries, not the pack file
+	explicit CompileCache(const std::string& directory, uint64_t maxBytes = uint64_t(64) << 20)
+		: files(directory), maxBytes(maxBytes) {
+		loadIndex();
+		mapPack();
+		packBytes = pack.view().size();
+	}
+
+	~CompileCache() { flush(); }
+
+	CompileCache(const CompileCache&) = delete;
+	CompileCache& operator=(const CompileCache&) = delete;
+
+	// Throws std::runtime_error on lexing, parsing or resolution errors, and with every
+	// diagnostic on type errors; nothing is stored for a file that fails.
+	BytecodeModule compile(std::string_view source) {
+		++counters.builds;
+		Lexer lexer;
+		std::vector<CompactToken> tokens = lexer.tokenizeBuffer(source);
+		TopLevelScan scan = scanTopLevel(tokens);
+		if (!scan.ok) return compileProgram(source, tokens);	// reports the parse error
+
+		std::vector<Declaration> decls;
+		if (!describe(source, tokens, scan, decls)) return compileProgram(source, tokens);	// reports the redefinition
+		std::vector<std::unique_ptr<BytecodeFunction>> cached(decls.size());
+		size_t missing = 0;
+		for (size_t d = 0; d < decls.size(); ++d) {
+			if (!decls[d].function) continue;
+			cached[d] = load(decls[d].key);
+			if (cached[d]) ++counters.hits;
+			else {
+				++counters.misses;
+				++missing;
+			}
+		}
+
+		BytecodeModule module;
+		if (missing == 0) {
+			checkClasses(source, tokens, decls);	// keys only cover the classes functions mention
+			++counters.fullHits;
+			for (auto& function : cached) {
+				if (function) module.functions.push_back(std::move(*function));
+			}
+			evict();
+			return module;
+		}
+
+		// Cached functions keep their signature and lose their body
+		std::vector<CompactToken> reduced;
+		reduced.reserve(tokens.size());
+		for (size_t d = 0; d < decls.size(); ++d) {
+			const Declaration& decl = decls[d];
+			if (cached[d]) {
+				reduced.insert(reduced.end(), tokens.begin() + decl.first, tokens.begin() + decl.body + 1);
+				reduced.push_back(tokens[decl.end - 1]);
+			} else {
+				reduced.insert(reduced.end(), tokens.begin() + decl.first, tokens.begin() + decl.end);
+			}
+		}
+		module = compileProgram(source, reduced);
+
+		size_t next = 0;
+		for (size_t d = 0; d < decls.size(); ++d) {
+			if (!decls[d].function) continue;
+			BytecodeFunction& function = module.functions[next++];
+			if (cached[d]) function = std::move(*cached[d]);
+			else store(decls[d].key, function);
+		}
+		evict();
+		return module;
+	}
+
+	// Writes the index; entries themselves are written as they are made
+	void flush() {
+		if (!dirty) return;
+		std::string out;
+		put(out, indexMagic);
+		put(out, formatVersion);
+		put(out, clock);
+		put(out, static_cast<uint64_t>(index.size()));
+		for (const auto& [key, entry] : index) {
+			put(out, key);
+			put(out, entry.offset);
+			put(out, entry.bytes);
+			put(out, entry.lastUse);
+		}
+		if (files.writeFile(indexFile, out)) dirty = false;
+	}
+
+	// Deletes every entry
+	void clear() {
+		pack = MappedFile();
+		if (files.fileExists(packFile)) files.deleteFile(packFile);
+		index.clear();
+		totalBytes = packBytes = 0;
+		packStale = dirty = true;
+	}
+
+	const CacheStats& stats() const { return counters; }
+	size_t entries() const { return index.size(); }
+	uint64_t bytes() const { return totalBytes; }
+
+private:
+	static constexpr uint32_t entryMagic = 0x31464342;	// "BCF1"
+	static constexpr uint32_t indexMagic = 0x31494342;	// "BCI1"
+	static constexpr const char* indexFile = "index.bin";
+	static constexpr const char* packFile = "entries.pack";
+
+	struct Entry {
+		uint64_t offset;	// in the pack
+		uint64_t bytes;
+		uint64_t lastUse;
+	};
+
+	// A top-level declaration as token indices: [first, end); body is the '{' of a function
+	struct Declaration {
+		uint32_t first;
+		uint32_t end;
+		uint32_t name;
+		uint32_t body;
+		bool function;
+		uint64_t key;
+	};
+
+	FManager files;
+	uint64_t maxBytes;
+	uint64_t totalBytes = 0;	// live entries
+	uint64_t packBytes = 0;		// the pack file, dropped entries included
+	uint64_t clock = 0;			// logical time of the last use, persisted
+	bool dirty = false;			// index changed since the last flush
+	MappedFile pack;
+	bool packStale = true;		// pack grew or was rewritten since it was mapped
+	std::unordered_map<uint64_t, Entry> index;
+	CacheStats counters;
+
+	template<class T>
+	static void put(std::string& out, const T& value) {
+		out.append(reinterpret_cast<const char*>(&value), sizeof value);
+	}
+
+	// Reads a T at `at`, advancing it; false past the end
+	template<class T>
+	static bool get(std::string_view in, size_t& at, T& value) {
+		if (at > in.size() || in.size() - at < sizeof value) return false;
+		std::memcpy(&value, in.data() + at, sizeof value);
+		at += sizeof value;
+		return true;
+	}
+
+	static BytecodeModule compileProgram(std::string_view source, std::span<const CompactToken> tokens) {
+		std::unique_ptr<Program> program(Parser(source, tokens).Parse());
+		Resolver().resolve(*program);
+		TypeContext types;
+		check(*program, types);
+		return BytecodeCompiler().compile(*program);
+	}
+
+	// A build that hits everywhere parses nothing, but a class no function uses is in no
+	// key, so the class declarations alone are parsed and checked: the build must fail
+	// exactly when a cold one would
+	static void checkClasses(std::string_view source, std::span<const CompactToken> tokens,
+							 const std::vector<Declaration>& decls) {
+		std::vector<CompactToken> classes;
+		for (const Declaration& decl : decls) {
+			if (!decl.function) classes.insert(classes.end(), tokens.begin() + decl.first, tokens.begin() + decl.end);
+		}
+		if (classes.empty()) return;
+		std::unique_ptr<Program> program(Parser(source, classes).Parse());
+		Resolver().resolve(*program);
+		TypeContext types;
+		check(*program, types);
+	}
+
+	// Throws with every diagnostic on type errors
+	static void check(Program& program, TypeContext& types) {
+		TypeChecker checker(types);
+		if (!checker.check(program)) {
+			std::string message;
+			for (const Diagnostic& diagnostic : checker.diagnostics()) {
+				std::ostringstream line;
+				line << diagnostic;
+				message += (message.empty() ? "" : "\n") + line.str();
+			}
+			throw std::runtime_error(message);
+		}
+	}
+
+	static uint64_t hashTokens(std::string_view source, std::span<const CompactToken> tokens) {
+		XXHash64 h(formatVersion);
+		for (const CompactToken& token : tokens) {
+			uint64_t shape = static_cast<uint64_t>(token.type) | static_cast<uint64_t>(token.op) << 8 | uint64_t(token.length) << 32;
+			h.add(shape).update(token.text(source));
+		}
+		return h.digest();
+	}
+
+	// False if two top-level declarations share a name
+	bool describe(std::string_view source, std::span<const CompactToken> tokens, const TopLevelScan& scan,
+				  std::vector<Declaration>& decls) const {
+		const Symbol classKeyword = intern("class");
+		const size_t count = scan.declarationCount();
+		decls.resize(count);
+		std::vector<uint64_t> signature(count);	// what a user of the declaration depends on
+		std::unordered_map<Symbol, uint32_t> names;	// top-level name -> declaration
+		uint32_t slot = 0;
+		std::vector<uint32_t> slots(count);
+		for (size_t d = 0; d < count; ++d) {
+			Declaration& decl = decls[d];
+			decl.first = scan.starts[d];
+			decl.end = scan.starts[d + 1];
+			decl.function = tokens[decl.first].symbol != classKeyword;
+			if (decl.function) {
+				decl.name = decl.first + 1;
+				if (tokens[decl.name].type == TokenType::o_bracket) decl.name += 2;
+				if (!names.emplace(tokens[decl.name].symbol, static_cast<uint32_t>(d)).second) return false;
+				decl.body = decl.first;
+				while (tokens[decl.body].type != TokenType::o_brace) ++decl.body;
+				signature[d] = hashTokens(source, tokens.subspan(decl.first, decl.body - decl.first));
+				slots[d] = slot++;
+			} else {
+				decl.name = decl.first + 1;
+				if (!names.emplace(tokens[decl.name].symbol, static_cast<uint32_t>(d)).second) return false;
+				decl.body = decl.first + 2;
+				signature[d] = hashTokens(source, tokens.subspan(decl.first, decl.end - decl.first));
+			}
+		}
+
+		for (size_t d = 0; d < count; ++d) {
+			Declaration& decl = decls[d];
+			if (!decl.function) continue;
+			XXHash64 h(formatVersion);
+			h.add(hashTokens(source, tokens.subspan(decl.first, decl.end - decl.first)));
+			for (uint32_t t = decl.first; t < decl.end; ++t) {
+				if (tokens[t].type != TokenType::identifier || t == decl.name) continue;	// a recursive call still counts
+				auto it = names.find(tokens[t].symbol);
+				if (it == names.end()) continue;
+				h.add(slots[it->second]).add(signature[it->second]);
+			}
+			decl.key = h.digest();
+		}
+		return true;
+	}
+
+	void mapPack() {
+		if (!packStale) return;
+		pack = files.fileExists(packFile) ? files.mapFile(packFile) : MappedFile();
+		packStale = false;
+	}
+
+	std::unique_ptr<BytecodeFunction> load(uint64_t key) {
+		auto it = index.find(key);
+		if (it == index.end()) return nullptr;
+		mapPack();
+		std::string_view in = pack.view();
+		const Entry& entry = it->second;
+		std::unique_ptr<BytecodeFunction> function;
+		if (entry.offset <= in.size() && in.size() - entry.offset >= entry.bytes) {
+			function = decode(in.substr(entry.offset, entry.bytes), key);
+		}
+		if (!function) {
+			++counters.corrupt;
+			totalBytes -= entry.bytes;
+			index.erase(it);
+			dirty = true;
+			return nullptr;
+		}
+		it->second.lastUse = ++clock;
+		dirty = true;
+		return function;
+	}
+
+	// Entry: magic, version, key, XXH64 of the rest, then the function
+	static std::unique_ptr<BytecodeFunction> decode(std::string_view in, uint64_t key) {
+		size_t at = 0;
+		uint32_t magic, version, nameLength, codeCount, constantCount;
+		uint64_t storedKey, checksum;
+		auto function = std::make_unique<BytecodeFunction>();
+		if (!get(in, at, magic) || magic != entryMagic || !get(in, at, version) || version != formatVersion ||
+			!get(in, at, storedKey) || storedKey != key || !get(in, at, checksum) || xxh64(in.substr(at)) != checksum ||
+			!get(in, at, nameLength) || in.size() - at < nameLength) {
+			return nullptr;
+		}
+		function->name = intern(in.substr(at, nameLength));
+		at += nameLength;
+		if (!get(in, at, function->params) || !get(in, at, function->registers) || !get(in, at, codeCount) ||
+			!get(in, at, constantCount)) {
+			return nullptr;
+		}
+		if ((in.size() - at) != uint64_t(codeCount) * sizeof(Instruction) + uint64_t(constantCount) * sizeof(double)) {
+			return nullptr;
+		}
+		function->code.resize(codeCount);
+		function->constants.resize(constantCount);
+		std::memcpy(function->code.data(), in.data() + at, codeCount * sizeof(Instruction));
+		std::memcpy(function->constants.data(), in.data() + at + codeCount * sizeof(Instruction), constantCount * sizeof(double));
+		for (const Instruction& instruction : function->code) {
+			if (static_cast<size_t>(instruction.op) >= opcodeCount) return nullptr;
+		}
+		return function;
+	}
+
+	void store(uint64_t key, const BytecodeFunction& function) {
+		std::string body;
+		std::string_view name = globalInterner().text(function.name);
+		put(body, static_cast<uint32_t>(name.size()));
+		body += name;
+		put(body, function.params);
+		put(body, function.registers);
+		put(body, static_cast<uint32_t>(function.code.size()));
+		put(body, static_cast<uint32_t>(function.constants.size()));
+		body.append(reinterpret_cast<const char*>(function.code.data()), function.code.size() * sizeof(Instruction));
+		body.append(reinterpret_cast<const char*>(function.constants.data()), function.constants.size() * sizeof(double));
+		std::string out;
+		put(out, entryMagic);
+		put(out, formatVersion);
+		put(out, key);
+		put(out, xxh64(body));
+		out += body;
+		if (!files.appendToFile(packFile, out)) return;
+
+		auto [it, inserted] = index.try_emplace(key, Entry{0, 0, 0});
+		totalBytes += out.size() - it->second.bytes;
+		it->second = {packBytes, out.size(), ++clock};
+		packBytes += out.size();
+		packStale = true;
+		++counters.stores;
+		dirty = true;
+	}
+
+	// Least recently used first, until the cache fits in maxBytes; then the pack is
+	// rewritten if most of it is dropped entries
+	void evict() {
+		if (totalBytes > maxBytes) {
+			std::vector<std::pair<uint64_t, uint64_t>> byAge;	// (lastUse, key)
+			byAge.reserve(index.size());
+			for (const auto& [key, entry] : index) byAge.push_back({entry.lastUse, key});
+			std::sort(byAge.begin(), byAge.end());
+			for (const auto& [lastUse, key] : byAge) {
+				if (totalBytes <= maxBytes) break;
+				totalBytes -= index[key].bytes;
+				index.erase(key);
+				++counters.evictions;
+			}
+			dirty = true;
+		}
+		if (packBytes - totalBytes > totalBytes) compact();
+	}
+
+	void compact() {
+		mapPack();
+		std::string_view in = pack.view();
+		std::string out;
+		out.reserve(totalBytes);
+		for (auto it = index.begin(); it != index.end();) {
+			Entry& entry = it->second;
+			if (entry.offset > in.size() || in.size() - entry.offset < entry.bytes) {
+				it = index.erase(it);
+				continue;
+			}
+			out.append(in.substr(entry.offset, entry.bytes));
+			entry.offset = out.size() - entry.bytes;
+			++it;
+		}
+		pack = MappedFile();	// unmap before the file is truncated
+		packStale = dirty = true;
+		totalBytes = out.size();
+		if (files.writeFile(packFile, out)) packBytes = out.size();
+		++counters.compactions;
+	}
+
+	void loadIndex() {
+		if (!files.fileExists(indexFile)) return;
+		MappedFile file = files.mapFile(indexFile);
+		std::string_view in = file.view();
+		size_t at = 0;
+		uint32_t magic, version;
+		uint64_t count;
+		if (!get(in, at, magic) || magic != indexMagic || !get(in, at, version) || version != formatVersion ||
+			!get(in, at, clock) || !get(in, at, count)) {
+			clock = 0;
+			dirty = true;	// rewritten on the next flush
+			return;
+		}
+		for (uint64_t i = 0; i < count; ++i) {
+			uint64_t key;
+			Entry entry;
+			if (!get(in, at, key) || !get(in, at, entry.offset) || !get(in, at, entry.bytes) || !get(in, at, entry.lastUse)) break;
+			index[key] = entry;
+			totalBytes += entry.bytes;
+		}
+	}
+};
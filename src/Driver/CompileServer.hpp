@@ -0,0 +1,409 @@
+#pragma once
+
+#ifndef _WIN32
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "BytecodeCompiler.hpp"
+#include "Parser.hpp"
+#include "Resolver.hpp"
+#include "ThreadPool.hpp"
+#include "TypeChecker.hpp"
+#include "XXHash.hpp"
+
+// Request latencies of one command: running totals plus the last `window` samples for
+// percentiles
+class LatencyStats {
+public:
+	static constexpr size_t window = 1024;
+
+	void add(double milliseconds) {
+		++count;
+		total += milliseconds;
+		worst = std::max(worst, milliseconds);
+		if (recent.size() < window) recent.push_back(milliseconds);
+		else recent[next] = milliseconds;
+		next = (next + 1) % window;
+	}
+
+	size_t requests() const { return count; }
+	double mean() const { return count ? total / static_cast<double>(count) : 0; }
+	double max() const { return worst; }
+
+	// p in [0, 1], over the recent window
+	double percentile(double p) const {
+		if (recent.empty()) return 0;
+		std::vector<double> sorted = recent;
+		size_t rank = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+		std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+		return sorted[rank];
+	}
+
+private:
+	size_t count = 0;
+	double total = 0;
+	double worst = 0;
+	std::vector<double> recent;
+	size_t next = 0;
+};
+
+// Long-running compiler behind a Unix domain socket. Clients send one request line per
+// connection and read the reply until the server closes it:
+//
+//   check <path>      parse, resolve and type check; replies with the diagnostics
+//   compile <path>    as check, then replies with the bytecode listing
+//   stats             cache counters and per-command latency
+//   shutdown          stops accepting connections; serve() returns
+//
+// The first line of a reply is "ok" or "error", the rest is the payload. Paths are
+// opened by the server, so clients should send absolute ones.
+//
+// Everything a build produces for a file stays in memory: the Program, its TypeContext,
+// the diagnostics and, once asked for, the bytecode listing or the reason it could not be
+// made. A request re-reads the file and compares its XXH64 with the cached one; an
+// unchanged file is answered without parsing. The string interner is process-wide and
+// stays warm across all files.
+//
+// Connections are handled on a ThreadPool. Requests for different files run in parallel;
+// requests for the same file serialize on that file's lock, so it is built once. A client
+// gets `ioTimeout` to send its request line and the same to take each part of the reply;
+// after that the connection is dropped, so idle clients cannot hold every worker.
+class CompileServer {
+public:
+	struct CacheCounters {
+		size_t hits = 0;		// requests answered from a cached build
+		size_t misses = 0;		// requests that (re)built a file
+		size_t failures = 0;	// requests for files that could not be read
+		size_t timeouts = 0;	// connections dropped before a whole request arrived
+	};
+
+	CompileServer(std::string socketPath, unsigned jobs = 0, std::chrono::milliseconds ioTimeout = std::chrono::seconds(5))
+		: socketPath(std::move(socketPath)), ioTimeout(ioTimeout), pool(jobs ? jobs : std::thread::hardware_concurrency()) {
+		sockaddr_un address = makeAddress(this->socketPath);
+		listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+		if (listener < 0) throw std::runtime_error("Unable to create socket: " + std::string(std::strerror(errno)));
+		::unlink(this->socketPath.c_str());	// a stale socket from a server that did not exit cleanly
+		if (::bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof address) != 0 || ::listen(listener, 64) != 0) {
+			std::string reason = std::strerror(errno);
+			::close(listener);
+			throw std::runtime_error("Unable to listen on " + this->socketPath + ": " + reason);
+		}
+	}
+
+	~CompileServer() {
+		stop();
+		pool.wait();
+		::close(listener);
+		::unlink(socketPath.c_str());
+	}
+
+	CompileServer(const CompileServer&) = delete;
+	CompileServer& operator=(const CompileServer&) = delete;
+
+	// Accepts connections until stop() or a shutdown request; requests still running
+	// finish before it returns
+	void serve() {
+		while (!stopping.load(std::memory_order_acquire)) {
+			int client = ::accept(listener, nullptr, nullptr);
+			if (client < 0) {
+				if (errno == EINTR || errno == ECONNABORTED) continue;
+				break;	// shut down by stop()
+			}
+			setTimeouts(client);
+			pool.submit([this, client] { handleConnection(client); });
+		}
+		pool.wait();
+	}
+
+	// Safe from any thread, including a request handler
+	void stop() {
+		if (!stopping.exchange(true, std::memory_order_acq_rel)) ::shutdown(listener, SHUT_RDWR);
+	}
+
+	// Runs one request line and returns the reply; what a connection gets, without the socket
+	std::string handle(std::string_view request) {
+		auto start = std::chrono::steady_clock::now();
+		size_t space = request.find(' ');
+		std::string_view command = request.substr(0, space);
+		std::string_view argument = space == std::string_view::npos ? std::string_view() : request.substr(space + 1);
+
+		std::string reply;
+		if (command == "check" || command == "compile") {
+			reply = argument.empty() ? error("Missing file path.") : build(std::string(argument), command == "compile");
+		} else if (command == "stats") {
+			reply = "ok\n" + statsReport();
+		} else if (command == "shutdown") {
+			stop();
+			reply = "ok\n";
+		} else {
+			reply = error("Unknown command '" + std::string(command) + "'.");
+		}
+
+		double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		std::lock_guard<std::mutex> guard(statsLock);
+		auto known = latencies.find(std::string(command));
+		(known != latencies.end() ? known->second : latencies["other"]).add(milliseconds);
+		return reply;
+	}
+
+	CacheCounters counters() const {
+		std::lock_guard<std::mutex> guard(statsLock);
+		return cache;
+	}
+
+	const std::string& path() const { return socketPath; }
+
+private:
+	// One file's last build. Members are destroyed in reverse order, so the program goes
+	// before the types it is annotated with.
+	struct Build {
+		uint64_t hash = 0;
+		std::unique_ptr<TypeContext> types;
+		std::unique_ptr<Program> program;
+		bool ok = false;
+		std::string diagnostics;	// the error text when !ok
+		std::string listing;		// bytecode, filled by the first compile request
+		std::string listingError;	// why that compile request could not produce it
+	};
+
+	struct FileSlot {
+		std::mutex lock;
+		std::unique_ptr<Build> build;
+	};
+
+	std::string socketPath;
+	std::chrono::milliseconds ioTimeout;
+	int listener = -1;
+	std::atomic<bool> stopping{false};
+	std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+
+	std::mutex filesLock;
+	std::unordered_map<std::string, std::unique_ptr<FileSlot>> files;	// slots are never removed
+
+	mutable std::mutex statsLock;
+	CacheCounters cache;
+	std::unordered_map<std::string, LatencyStats> latencies{
+		{"check", {}}, {"compile", {}}, {"stats", {}}, {"shutdown", {}}, {"other", {}}};
+
+	ThreadPool pool;	// last: its workers stop before anything they use is destroyed
+
+	static sockaddr_un makeAddress(const std::string& path) {
+		sockaddr_un address{};
+		address.sun_family = AF_UNIX;
+		if (path.size() >= sizeof address.sun_path) throw std::runtime_error("Socket path too long: " + path);
+		std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+		return address;
+	}
+
+	static std::string error(const std::string& message) { return "error\n" + message + "\n"; }
+
+	// Read, not mapped: an editor may truncate the file while it is being loaded, and
+	// touching a mapping past the new end of file raises SIGBUS in the whole server
+	static bool readFile(const std::string& path, std::string& out) {
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0) return false;
+		struct stat st;
+		if (fstat(fd, &st) == 0 && st.st_size > 0) out.reserve(static_cast<size_t>(st.st_size));
+		char buffer[64 * 1024];
+		for (;;) {
+			ssize_t n = ::read(fd, buffer, sizeof buffer);
+			if (n < 0 && errno == EINTR) continue;
+			if (n < 0) {
+				::close(fd);
+				return false;
+			}
+			if (n == 0) break;
+			out.append(buffer, static_cast<size_t>(n));
+		}
+		::close(fd);
+		return true;
+	}
+
+	void count(size_t CacheCounters::*counter) {
+		std::lock_guard<std::mutex> guard(statsLock);
+		++(cache.*counter);
+	}
+
+	FileSlot& slotFor(const std::string& path) {
+		std::lock_guard<std::mutex> guard(filesLock);
+		std::unique_ptr<FileSlot>& slot = files[path];
+		if (!slot) slot = std::make_unique<FileSlot>();
+		return *slot;
+	}
+
+	std::string build(const std::string& path, bool wantBytecode) {
+		std::string source;
+		if (!readFile(path, source)) {
+			count(&CacheCounters::failures);
+			return error("Unable to open file " + path);
+		}
+		uint64_t hash = xxh64(source);
+
+		FileSlot& slot = slotFor(path);
+		std::lock_guard<std::mutex> guard(slot.lock);
+		if (slot.build && slot.build->hash == hash) {
+			count(&CacheCounters::hits);
+		} else {
+			count(&CacheCounters::misses);
+			slot.build = compile(source, hash);
+		}
+
+		Build& built = *slot.build;
+		if (!built.ok) return error(built.diagnostics);
+		if (!wantBytecode) return "ok\n";
+		if (built.listing.empty() && built.listingError.empty()) {
+			try {
+				std::ostringstream out;
+				BytecodeCompiler().compile(*built.program).print(out);
+				built.listing = out.str();
+			} catch (const std::runtime_error& e) {
+				built.listingError = e.what();	// kept, so repeats of an unchanged file do not compile again
+			}
+		}
+		if (!built.listingError.empty()) return error(built.listingError);
+		return "ok\n" + built.listing;
+	}
+
+	static std::unique_ptr<Build> compile(std::string_view source, uint64_t hash) {
+		auto built = std::make_unique<Build>();
+		built->hash = hash;
+		built->types = std::make_unique<TypeContext>();
+		try {
+			Lexer lexer;
+			std::vector<CompactToken> tokens = lexer.tokenizeBuffer(source);
+			built->program.reset(Parser(source, tokens).Parse());
+			Resolver().resolve(*built->program);
+			TypeChecker checker(*built->types);
+			built->ok = checker.check(*built->program);
+			for (const Diagnostic& diagnostic : checker.diagnostics()) {
+				std::ostringstream line;
+				line << diagnostic;
+				built->diagnostics += (built->diagnostics.empty() ? "" : "\n") + line.str();
+			}
+		} catch (const std::exception& e) {
+			built->program.reset();
+			built->ok = false;
+			built->diagnostics = e.what();
+		}
+		return built;
+	}
+
+	std::string statsReport() const {
+		std::ostringstream out;
+		std::lock_guard<std::mutex> guard(statsLock);
+		double uptime = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+		out << "uptime " << uptime << " s, " << globalInterner().size() << " interned strings\n";
+		out << "cache " << cache.hits << " hits, " << cache.misses << " builds, " << cache.failures << " unreadable, "
+			<< cache.timeouts << " timed out\n";
+		for (const char* command : {"check", "compile", "stats", "shutdown", "other"}) {
+			const LatencyStats& stats = latencies.at(command);
+			if (!stats.requests()) continue;
+			out << command << " " << stats.requests() << " requests, mean " << stats.mean() << " ms, p50 "
+				<< stats.percentile(0.5) << " ms, p99 " << stats.percentile(0.99) << " ms, max " << stats.max() << " ms\n";
+		}
+		return out.str();
+	}
+
+	// Bounds every recv and send on the socket; an expired one fails with EAGAIN
+	void setTimeouts(int client) const {
+		timeval limit{};
+		limit.tv_sec = static_cast<time_t>(ioTimeout.count() / 1000);
+		limit.tv_usec = static_cast<suseconds_t>(ioTimeout.count() % 1000 * 1000);
+		::setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &limit, sizeof limit);
+		::setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &limit, sizeof limit);
+	}
+
+	void handleConnection(int client) {
+		// The whole request line must arrive within ioTimeout, not just each piece of it,
+		// or a client trickling one byte at a time would keep the worker forever
+		auto deadline = std::chrono::steady_clock::now() + ioTimeout;
+		std::string request;
+		char buffer[1024];
+		while (request.find('\n') == std::string::npos && request.size() < 64 * 1024) {
+			ssize_t n = ::recv(client, buffer, sizeof buffer, 0);
+			if (n < 0 && errno == EINTR) continue;
+			bool expired = (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) ||
+						   (n > 0 && std::chrono::steady_clock::now() > deadline);
+			if (expired) {
+				count(&CacheCounters::timeouts);
+				::close(client);
+				return;
+			}
+			if (n <= 0) break;
+			request.append(buffer, static_cast<size_t>(n));
+		}
+		request = request.substr(0, request.find('\n'));
+		if (!request.empty() && request.back() == '\r') request.pop_back();
+
+		std::string reply;
+		try {
+			reply = handle(request);
+		} catch (const std::exception& e) {
+			reply = error(e.what());
+		}
+		for (size_t sent = 0; sent < reply.size();) {
+			ssize_t n = ::send(client, reply.data() + sent, reply.size() - sent, MSG_NOSIGNAL);
+			if (n < 0 && errno == EINTR) continue;
+			if (n <= 0) break;	// the client went away or stopped reading
+			sent += static_cast<size_t>(n);
+		}
+		::close(client);
+	}
+};
+
+// The client side: sends one request line to a CompileServer and returns the whole reply.
+// Throws std::runtime_error if the server cannot be reached.
+inline std::string sendCompileRequest(const std::string& socketPath, std::string_view request) {
+	sockaddr_un address{};
+	address.sun_family = AF_UNIX;
+	if (socketPath.size() >= sizeof address.sun_path) throw std::runtime_error("Socket path too long: " + socketPath);
+	std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+
+	int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof address) != 0) {
+		std::string reason = std::strerror(errno);
+		if (fd >= 0) ::close(fd);
+		throw std::runtime_error("Unable to connect to " + socketPath + ": " + reason);
+	}
+
+	std::string line = std::string(request) + "\n";
+	for (size_t sent = 0; sent < line.size();) {
+		ssize_t n = ::send(fd, line.data() + sent, line.size() - sent, MSG_NOSIGNAL);
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) break;
+		sent += static_cast<size_t>(n);
+	}
+	::shutdown(fd, SHUT_WR);
+
+	std::string reply;
+	char buffer[16 * 1024];
+	for (;;) {
+		ssize_t n = ::recv(fd, buffer, sizeof buffer, 0);
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) break;
+		reply.append(buffer, static_cast<size_t>(n));
+	}
+	::close(fd);
+	return reply;
+}
+
+#endif
@@ -0,0 +1,164 @@
+#pragma once
+
+#include "MappedFile.hpp"
+#include "Parser.hpp"
+#include "ThreadPool.hpp"
+#include "TokenStream.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct DriverOptions {
+	unsigned jobs = 0;					// worker threads; 0 = one per hardware thread
+	std::vector<std::string> inputs;	// files and/or directories
+	std::string extension = ".src";		// files picked up when an input is a directory
+};
+
+// Parses `-j N`, `-jN`, `--jobs N` and `--jobs=N`; every other argument is an input path.
+// Throws std::runtime_error on a malformed job count.
+inline DriverOptions parseDriverArgs(int argc, char** argv) {
+	DriverOptions options;
+	auto jobCount = [](std::string_view text) {
+		char* end = nullptr;
+		std::string value(text);
+		unsigned long n = std::strtoul(value.c_str(), &end, 10);
+		if (value.empty() || *end != '\0' || n == 0) {
+			throw std::runtime_error("Invalid job count: '" + value + "'");
+		}
+		return static_cast<unsigned>(n);
+	};
+
+	for (int i = 1; i < argc; ++i) {
+		std::string_view arg = argv[i];
+		if (arg == "-j" || arg == "--jobs") {
+			if (i + 1 >= argc) throw std::runtime_error("Missing job count after " + std::string(arg));
+			options.jobs = jobCount(argv[++i]);
+		} else if (arg.starts_with("--jobs=")) {
+			options.jobs = jobCount(arg.substr(7));
+		} else if (arg.starts_with("-j")) {
+			options.jobs = jobCount(arg.substr(2));
+		} else {
+			options.inputs.emplace_back(arg);
+		}
+	}
+	return options;
+}
+
+// Outcome of one source file. `program` is null when the file could not be read or
+// failed to parse; `error` then says why.
+struct FileResult {
+	std::string path;
+	MappedFile source;	// kept mapped for later passes and diagnostics
+	std::unique_ptr<Program> program;
+	std::string error;
+	double milliseconds = 0;
+
+	bool ok() const { return program != nullptr; }
+};
+
+// All files of one build, in input order. declarations() is the merged view: every
+// top-level declaration of every successfully parsed file, file by file.
+struct BuildResult {
+	std::vector<FileResult> files;
+
+	std::vector<ASTNode*> declarations() const {
+		std::vector<ASTNode*> merged;
+		for (const FileResult& file : files) {
+			if (file.ok()) merged.insert(merged.end(), file.program->Code.begin(), file.program->Code.end());
+		}
+		return merged;
+	}
+
+	size_t failures() const {
+		return static_cast<size_t>(std::count_if(files.begin(), files.end(), [](const FileResult& f) { return !f.ok(); }));
+	}
+};
+
+// Runs read -> lex -> parse (and any registered per-file passes) for every input file
+// as independent tasks on a work-stealing pool. Files share nothing but the string
+// interner, which is thread-safe.
+class Driver {
+public:
+	// Runs after a file parsed successfully, on the same worker; may throw to fail the file
+	using FilePass = std::function<void(FileResult&)>;
+
+	explicit Driver(DriverOptions options) : options(std::move(options)) {}
+
+	void addPass(FilePass pass) { passes.push_back(std::move(pass)); }
+
+	// Expands directories (recursively, sorted for a deterministic order) into source files
+	std::vector<std::string> sourceFiles() const {
+		std::vector<std::string> files;
+		for (const std::string& input : options.inputs) {
+			if (std::filesystem::is_directory(input)) {
+				std::vector<std::string> found;
+				for (const auto& entry : std::filesystem::recursive_directory_iterator(input)) {
+					if (entry.is_regular_file() && entry.path().extension() == options.extension) {
+						found.push_back(entry.path().string());
+					}
+				}
+				std::sort(found.begin(), found.end());
+				files.insert(files.end(), found.begin(), found.end());
+			} else {
+				files.push_back(input);
+			}
+		}
+		return files;
+	}
+
+	BuildResult run() const {
+		BuildResult build;
+		std::vector<std::string> paths = sourceFiles();
+		build.files.resize(paths.size());
+
+		// Biggest files first, so a large file is not left running alone at the end
+		std::vector<size_t> order(paths.size());
+		std::vector<uintmax_t> sizes(paths.size());
+		for (size_t i = 0; i < paths.size(); ++i) {
+			order[i] = i;
+			std::error_code ec;
+			sizes[i] = std::filesystem::file_size(paths[i], ec);
+			if (ec) sizes[i] = 0;
+		}
+		std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sizes[a] > sizes[b]; });
+
+		ThreadPool pool(options.jobs ? options.jobs : std::thread::hardware_concurrency());
+		for (size_t i : order) {
+			FileResult& result = build.files[i];
+			result.path = paths[i];
+			pool.submit([this, &result] { compileFile(result); });
+		}
+		pool.wait();
+		return build;
+	}
+
+private:
+	DriverOptions options;
+	std::vector<FilePass> passes;
+
+	void compileFile(FileResult& result) const {
+		auto start = std::chrono::steady_clock::now();
+		try {
+			result.source = MappedFile::open(result.path);
+			if (!result.source.isOpen()) throw std::runtime_error("Unable to open file " + result.path);
+
+			std::string_view text = result.source.view();
+			ScanningTokenSource tokens(text);
+			result.program.reset(Parser(text, tokens).Parse());
+			for (const FilePass& pass : passes) pass(result);
+		} catch (const std::exception& e) {
+			result.program.reset();
+			result.error = e.what();
+		}
+		result.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+};
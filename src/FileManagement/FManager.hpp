@@ -3,7 +3,9 @@
 #include <fstream>
 #include <iostream>
 #include <string>
+#include <vector>
 #include <filesystem>
+#include "MappedFile.hpp"
 
 class FManager {
 private:
@@ -35,6 +37,16 @@ public:
 		return lines;
 	}
 
+	// Map a file read-only without copying it. The returned handle owns the mapping;
+	// its view() is what Lexer::tokenizeBuffer expects.
+	MappedFile mapFile(const std::string& filename) const {
+		MappedFile file = MappedFile::open(directoryPath + "/" + filename);
+		if (!file.isOpen()) {
+			std::cerr << "Error: Unable to open file " << filename << std::endl;
+		}
+		return file;
+	}
+
     // Write a string to a file (overwrites if file exists)
     bool writeFile(const std::string& filename, const std::string& content) const {
         std::ofstream file(directoryPath + "/" + filename);
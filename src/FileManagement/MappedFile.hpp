@@ -0,0 +1,141 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <utility>
+#include <fstream>
+#include <algorithm>
+#include <cerrno>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+// Read-only view of a whole source file. Regular files are memory-mapped; pipes and
+// special files are read into a heap buffer instead. The view stays valid for the
+// lifetime of the handle.
+class MappedFile {
+private:
+	const char* data = nullptr;
+	size_t size = 0;
+	bool mapped = false;				// true if data points into an mmap'd region
+	std::unique_ptr<char[]> buffer;	// owns the data for the read() fallback
+	bool opened = false;
+
+public:
+	MappedFile() = default;
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	MappedFile(MappedFile&& other) noexcept { *this = std::move(other); }
+
+	MappedFile& operator=(MappedFile&& other) noexcept {
+		if (this != &other) {
+			release();
+			data = std::exchange(other.data, nullptr);
+			size = std::exchange(other.size, 0);
+			mapped = std::exchange(other.mapped, false);
+			opened = std::exchange(other.opened, false);
+			buffer = std::move(other.buffer);
+		}
+		return *this;
+	}
+
+	~MappedFile() { release(); }
+
+	// Opens a file; check isOpen() for failure
+	static MappedFile open(const std::string& path) {
+		MappedFile file;
+#ifndef _WIN32
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0) return file;
+
+		// A size of 0 is treated as unknown: procfs and sysfs files report it but have
+		// content, and mmap rejects empty mappings anyway
+		struct stat st;
+		if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+			file.opened = true;
+			file.size = static_cast<size_t>(st.st_size);
+			void* region = mmap(nullptr, file.size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (region != MAP_FAILED) {
+				madvise(region, file.size, MADV_SEQUENTIAL);
+				file.data = static_cast<const char*>(region);
+				file.mapped = true;
+				::close(fd);
+				return file;
+			}
+			file.opened = file.readAll(fd, file.size);
+		} else {
+			file.opened = file.readAll(fd, 0);
+		}
+		::close(fd);
+#else
+		std::ifstream in(path, std::ios::binary | std::ios::ate);
+		if (!in.is_open()) return file;
+		std::streamsize length = in.tellg();
+		in.seekg(0);
+		if (length < 0 || !in) return file;
+		file.buffer = std::make_unique<char[]>(length > 0 ? static_cast<size_t>(length) : 1);
+		in.read(file.buffer.get(), length);
+		if (in.bad() || (in.fail() && !in.eof())) {
+			file.buffer.reset();
+			return file;
+		}
+		file.data = file.buffer.get();
+		file.size = static_cast<size_t>(in.gcount());
+		file.opened = true;
+#endif
+		return file;
+	}
+
+	bool isOpen() const { return opened; }
+	explicit operator bool() const { return opened; }
+	bool isMapped() const { return mapped; }
+
+	std::string_view view() const { return {data, size}; }
+
+private:
+#ifndef _WIN32
+	// Bulk read fallback. sizeHint is the expected size (0 if unknown, e.g. a pipe). The
+	// spare byte lets the final zero-length read happen without growing an exact buffer.
+	bool readAll(int fd, size_t sizeHint) {
+		size_t capacity = sizeHint ? sizeHint + 1 : 64 * 1024;
+		size_t used = 0;
+		buffer = std::make_unique<char[]>(capacity);
+		while (true) {
+			if (used == capacity) {
+				auto grown = std::make_unique<char[]>(capacity * 2);
+				std::copy(buffer.get(), buffer.get() + used, grown.get());
+				buffer = std::move(grown);
+				capacity *= 2;
+			}
+			ssize_t n = ::read(fd, buffer.get() + used, capacity - used);
+			if (n < 0) {
+				if (errno == EINTR) continue;
+				return false;
+			}
+			if (n == 0) break;
+			used += static_cast<size_t>(n);
+		}
+		data = buffer.get();
+		size = used;
+		return true;
+	}
+#endif
+
+	void release() {
+#ifndef _WIN32
+		if (mapped) munmap(const_cast<char*>(data), size);
+#endif
+		buffer.reset();
+		data = nullptr;
+		size = 0;
+		mapped = false;
+		opened = false;
+	}
+};
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "IR.hpp"
+#include "PassManager.hpp"
+
+// Sparse conditional constant propagation (Wegman and Zadeck). Values start unknown and
+// only move down the lattice unknown -> constant -> varying; blocks start unreachable and
+// become reachable along edges whose branch condition is not known to go the other way.
+// Both are driven by worklists, so each instruction is revisited only when an input
+// changes. Afterwards constant values become Const instructions, branches on a constant
+// become jumps, and blocks that were never reached are deleted.
+//
+// Constants evaluate exactly as the VM would (IEEE doubles, fmod, pow); arrays are always
+// varying.
+class SparseConditionalConstantPropagation : public FunctionPass {
+private:
+	enum class State : uint8_t { Unknown, Constant, Varying };
+
+	struct Lattice {
+		State state = State::Unknown;
+		double value = 0;
+	};
+
+	std::vector<Lattice> lattice;
+	std::vector<uint8_t> reachable;
+	std::vector<std::vector<uint8_t>> edgeTaken;	// per block, per predecessor index
+	std::vector<std::pair<BlockId, BlockId>> edgeWork;
+	std::vector<ValueId> valueWork;
+
+public:
+	std::string_view name() const override { return "sccp"; }
+
+	bool run(IRFunction& function) override {
+		const size_t blockCount = function.blocks.size();
+		lattice.assign(function.values.size(), {});
+		reachable.assign(blockCount, 0);
+		edgeTaken.assign(blockCount, {});
+		for (BlockId b = 0; b < blockCount; ++b) edgeTaken[b].assign(function.blocks[b].preds.size(), 0);
+		edgeWork.clear();
+		valueWork.clear();
+
+		edgeWork.push_back({noValue, 0});
+		while (!edgeWork.empty() || !valueWork.empty()) {
+			while (!edgeWork.empty()) {
+				auto [from, to] = edgeWork.back();
+				edgeWork.pop_back();
+				visitEdge(function, from, to);
+			}
+			while (!valueWork.empty()) {
+				ValueId v = valueWork.back();
+				valueWork.pop_back();
+				for (ValueId user : function.values[v].users) {
+					if (reachable[function.values[user].block]) visit(function, user);
+				}
+			}
+		}
+		return rewrite(function);
+	}
+
+private:
+	void visitEdge(IRFunction& function, BlockId from, BlockId to) {
+		if (from != noValue) {
+			const auto& preds = function.blocks[to].preds;
+			size_t position = std::find(preds.begin(), preds.end(), from) - preds.begin();
+			if (edgeTaken[to][position]) return;
+			edgeTaken[to][position] = 1;
+		}
+		if (reachable[to]) {	// a new way into a block already seen: only its phis can change
+			for (ValueId v : function.blocks[to].instructions) {
+				if (function.values[v].op != IROp::Phi) break;
+				visit(function, v);
+			}
+			return;
+		}
+		reachable[to] = 1;
+		for (ValueId v : function.blocks[to].instructions) visit(function, v);
+	}
+
+	void set(ValueId v, Lattice value) {
+		Lattice& old = lattice[v];
+		if (old.state == State::Varying) return;
+		if (old.state == value.state && (value.state != State::Constant || old.value == value.value ||
+										  (std::isnan(old.value) && std::isnan(value.value)))) {
+			return;
+		}
+		if (old.state == State::Constant && value.state == State::Constant) value.state = State::Varying;
+		old = value;
+		valueWork.push_back(v);
+	}
+
+	static bool evaluate(IROp op, double a, double b, double& result) {
+		switch (op) {
+			case IROp::Add: result = a + b; return true;
+			case IROp::Sub: result = a - b; return true;
+			case IROp::Mul: result = a * b; return true;
+			case IROp::Div: result = a / b; return true;
+			case IROp::Mod: result = std::fmod(a, b); return true;
+			case IROp::Pow: result = std::pow(a, b); return true;
+			case IROp::Equal: result = a == b; return true;
+			case IROp::NotEqual: result = a != b; return true;
+			case IROp::Less: result = a < b; return true;
+			case IROp::LessEqual: result = a <= b; return true;
+			case IROp::Greater: result = a > b; return true;
+			case IROp::GreaterEqual: result = a >= b; return true;
+			case IROp::Neg: result = -a; return true;
+			case IROp::Not: result = a == 0; return true;
+			default: return false;
+		}
+	}
+
+	void visit(IRFunction& function, ValueId v) {
+		const IRInstruction& in = function.values[v];
+		const BlockId block = in.block;
+		switch (in.op) {
+			case IROp::Const:
+				set(v, in.type == IRType::Float ? Lattice{State::Constant, in.constant} : Lattice{State::Varying});
+				return;
+			case IROp::Phi: {
+				Lattice merged;
+				for (size_t i = 0; i < in.operands.size(); ++i) {
+					if (!edgeTaken[block][i]) continue;
+					const Lattice& incoming = lattice[in.operands[i]];
+					if (incoming.state == State::Unknown) continue;
+					if (incoming.state == State::Varying || (merged.state == State::Constant && merged.value != incoming.value)) {
+						merged.state = State::Varying;
+						break;
+					}
+					merged = incoming;
+				}
+				set(v, merged);
+				return;
+			}
+			case IROp::Jump:
+				edgeWork.push_back({block, in.targets[0]});
+				return;
+			case IROp::Branch: {
+				const Lattice& condition = lattice[in.operands[0]];
+				if (condition.state == State::Unknown) return;
+				if (condition.state == State::Varying || condition.value != 0) edgeWork.push_back({block, in.targets[0]});
+				if (condition.state == State::Varying || condition.value == 0) edgeWork.push_back({block, in.targets[1]});
+				return;
+			}
+			default:
+				break;
+		}
+		if (in.type == IRType::Void) return;
+
+		double operands[2] = {0, 0};
+		bool foldable = (isBinary(in.op) || in.op == IROp::Neg || in.op == IROp::Not) && in.operands.size() <= 2;
+		for (size_t i = 0; foldable && i < in.operands.size(); ++i) {
+			const Lattice& operand = lattice[in.operands[i]];
+			if (operand.state == State::Unknown) return;
+			if (operand.state == State::Varying) foldable = false;
+			else operands[i] = operand.value;
+		}
+		double result;
+		if (foldable && evaluate(in.op, operands[0], operands[1], result)) set(v, {State::Constant, result});
+		else set(v, {State::Varying});
+	}
+
+	// Constants made by rewrite() are past the end of the lattice
+	Lattice stateOf(const IRFunction& function, ValueId v) const {
+		return v < lattice.size() ? lattice[v] : Lattice{State::Constant, function.values[v].constant};
+	}
+
+	bool rewrite(IRFunction& function) {
+		bool changed = false;
+		ValueId insertPoint = noValue;	// constants go at the top of the entry block, which dominates everything
+		for (ValueId v : function.blocks[0].instructions) {
+			if (function.values[v].op != IROp::Phi) {
+				insertPoint = v;
+				break;
+			}
+		}
+
+		for (BlockId b = 0; b < function.blocks.size(); ++b) {
+			if (!reachable[b]) continue;
+			const std::vector<ValueId> list = function.blocks[b].instructions;	// constants may be added to it
+			for (ValueId v : list) {
+				IRInstruction& in = function.values[v];
+				if (in.op == IROp::Branch && stateOf(function, in.operands[0]).state == State::Constant) {
+					const bool taken = stateOf(function, in.operands[0]).value != 0;
+					const BlockId kept = in.targets[taken ? 0 : 1], dropped = in.targets[taken ? 1 : 0];
+					function.remove(v);
+					in.dead = false;
+					in.op = IROp::Jump;
+					in.targets[0] = kept;
+					in.targets[1] = noValue;
+					if (dropped != kept) function.removeEdge(b, dropped);
+					changed = true;
+					continue;
+				}
+				if (in.op == IROp::Const || hasSideEffects(in.op) || lattice[v].state != State::Constant) continue;
+				IRInstruction constant{IROp::Const, IRType::Float};
+				constant.constant = lattice[v].value;
+				ValueId replacement = function.insertBefore(insertPoint, std::move(constant));
+				function.replaceAllUses(v, replacement);
+				function.remove(v);
+				changed = true;
+			}
+		}
+		changed |= function.removeUnreachableBlocks();
+		if (changed) function.sweep();
+		return changed;
+	}
+};
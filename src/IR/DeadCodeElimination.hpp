@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vector>
+
+#include "IR.hpp"
+#include "PassManager.hpp"
+
+// Mark and sweep: instructions with side effects are live, and so is every operand of a
+// live instruction. Everything else goes, including cycles of phis that only feed each
+// other.
+class DeadCodeElimination : public FunctionPass {
+public:
+	std::string_view name() const override { return "dce"; }
+
+	bool run(IRFunction& function) override {
+		std::vector<uint8_t> live(function.values.size(), 0);
+		std::vector<ValueId> work;
+		for (const IRBlock& block : function.blocks) {
+			for (ValueId v : block.instructions) {
+				if (hasSideEffects(function.values[v].op)) {
+					live[v] = 1;
+					work.push_back(v);
+				}
+			}
+		}
+		while (!work.empty()) {
+			ValueId v = work.back();
+			work.pop_back();
+			for (ValueId operand : function.values[v].operands) {
+				if (!live[operand]) {
+					live[operand] = 1;
+					work.push_back(operand);
+				}
+			}
+		}
+
+		bool changed = false;
+		for (const IRBlock& block : function.blocks) {
+			for (ValueId v : block.instructions) {
+				if (live[v]) continue;
+				function.values[v].users.clear();	// every user is dead as well
+				function.remove(v);
+				changed = true;
+			}
+		}
+		if (changed) function.sweep();
+		return changed;
+	}
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <vector>
+
+#include "IR.hpp"
+
+// Dominator tree and dominance frontiers of an IRFunction's reachable blocks, computed
+// with the iterative algorithm of Cooper, Harvey and Kennedy over reverse postorder.
+// Unreachable blocks have no idom and appear nowhere.
+class DominatorTree {
+public:
+	std::vector<BlockId> order;						// reverse postorder
+	std::vector<BlockId> idom;						// immediate dominator; the entry is its own
+	std::vector<std::vector<BlockId>> children;		// dominator tree
+	std::vector<std::vector<BlockId>> frontier;		// dominance frontier
+
+	explicit DominatorTree(const IRFunction& function) {
+		const size_t n = function.blocks.size();
+		order = function.reversePostorder();
+		std::vector<uint32_t> rank(n, noValue);
+		for (uint32_t i = 0; i < order.size(); ++i) rank[order[i]] = i;
+
+		idom.assign(n, noValue);
+		idom[0] = 0;
+		auto intersect = [&](BlockId a, BlockId b) {
+			while (a != b) {
+				while (rank[a] > rank[b]) a = idom[a];
+				while (rank[b] > rank[a]) b = idom[b];
+			}
+			return a;
+		};
+		for (bool changed = true; changed;) {
+			changed = false;
+			for (size_t i = 1; i < order.size(); ++i) {
+				BlockId block = order[i];
+				BlockId dom = noValue;
+				for (BlockId pred : function.blocks[block].preds) {
+					if (idom[pred] == noValue) continue;	// unreachable or not yet visited
+					dom = dom == noValue ? pred : intersect(pred, dom);
+				}
+				if (dom != idom[block]) {
+					idom[block] = dom;
+					changed = true;
+				}
+			}
+		}
+
+		children.assign(n, {});
+		frontier.assign(n, {});
+		for (size_t i = 1; i < order.size(); ++i) children[idom[order[i]]].push_back(order[i]);
+		for (BlockId block : order) {
+			const auto& preds = function.blocks[block].preds;
+			if (preds.size() < 2) continue;
+			for (BlockId pred : preds) {
+				if (idom[pred] == noValue) continue;
+				for (BlockId runner = pred; runner != idom[block]; runner = idom[runner]) {
+					auto& df = frontier[runner];
+					if (df.empty() || df.back() != block) df.push_back(block);
+				}
+			}
+		}
+	}
+
+	bool reachable(BlockId block) const { return idom[block] != noValue; }
+
+	// False when either block is unreachable: those are outside the tree
+	bool dominates(BlockId a, BlockId b) const {
+		if (!reachable(a) || !reachable(b)) return false;
+		while (b != a && b != 0) b = idom[b];
+		return b == a;
+	}
+};
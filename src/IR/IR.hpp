@@ -0,0 +1,364 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "StringInterner.hpp"
+
+// SSA intermediate representation. An IRFunction owns two dense arrays, its values and its
+// blocks, and everything refers to them by index: a ValueId names the instruction that
+// defines a value, a BlockId a basic block. Every value records its users, so a pass can
+// replace a value everywhere in time proportional to its uses.
+//
+// A block holds its phis first and ends with exactly one terminator (Jump, Branch or
+// Return). Phi operand i is the value flowing in from preds[i]. Removed instructions stay
+// in the value array marked dead, so ids are stable for the life of the function.
+//
+//   op          operands             other fields
+//   Const                            constant (a null array when type is Array)
+//   Param                            index: parameter number
+//   Add..Pow    lhs rhs
+//   Equal..     lhs rhs              1 or 0
+//   Neg / Not   x
+//   NewArray    length
+//   Length      array
+//   GetIndex    array index
+//   SetIndex    array index value
+//   Call        args...              index: callee's global slot
+//   Phi         one per predecessor
+//   Read        -                    index: frame slot; only while the builder runs
+//   Write       value                index: frame slot; only while the builder runs
+//   Jump                             targets[0]
+//   Branch      condition            targets[0] if nonzero, else targets[1]
+//   Return      value
+
+#define IR_OPCODES(X) \
+	X(Const) X(Param) \
+	X(Add) X(Sub) X(Mul) X(Div) X(Mod) X(Pow) \
+	X(Equal) X(NotEqual) X(Less) X(LessEqual) X(Greater) X(GreaterEqual) \
+	X(Neg) X(Not) \
+	X(NewArray) X(Length) X(GetIndex) X(SetIndex) \
+	X(Call) X(Phi) X(Read) X(Write) \
+	X(Jump) X(Branch) X(Return)
+
+enum class IROp : uint8_t {
+#define IR_ENUM(name) name,
+	IR_OPCODES(IR_ENUM)
+#undef IR_ENUM
+};
+
+inline constexpr std::string_view irOpNames[] = {
+#define IR_NAME(name) #name,
+	IR_OPCODES(IR_NAME)
+#undef IR_NAME
+};
+
+enum class IRType : uint8_t { Void, Float, Array };
+
+inline constexpr std::string_view irTypeNames[] = {"void", "float", "float[]"};
+
+using ValueId = uint32_t;
+using BlockId = uint32_t;
+
+inline constexpr uint32_t noValue = UINT32_MAX;
+
+inline bool isTerminator(IROp op) { return op == IROp::Jump || op == IROp::Branch || op == IROp::Return; }
+inline bool isBinary(IROp op) { return op >= IROp::Add && op <= IROp::GreaterEqual; }
+
+// Must be kept even when unused: stores, calls, instructions that can fault at run
+// time (allocation, indexing, length of a null array) and terminators
+inline bool hasSideEffects(IROp op) {
+	switch (op) {
+		case IROp::NewArray: case IROp::Length: case IROp::GetIndex: case IROp::SetIndex:
+		case IROp::Call: case IROp::Write: case IROp::Jump: case IROp::Branch: case IROp::Return:
+			return true;
+		default:
+			return false;
+	}
+}
+
+struct IRInstruction {
+	IROp op;
+	IRType type = IRType::Void;
+	bool dead = false;
+	BlockId block = noValue;
+	uint32_t index = 0;
+	double constant = 0;
+	BlockId targets[2] = {noValue, noValue};
+	std::vector<ValueId> operands;
+	std::vector<ValueId> users;	// one entry per use, so a user appears once per operand
+
+	explicit IRInstruction(IROp op, IRType type = IRType::Void) : op(op), type(type) {}
+};
+
+struct IRBlock {
+	std::vector<ValueId> instructions;	// phis first, terminator last
+	std::vector<BlockId> preds;
+	bool dead = false;
+
+	// Successors come from the terminator
+	template<class F>
+	void forEachSuccessor(const std::vector<IRInstruction>& values, F&& f) const {
+		if (instructions.empty()) return;
+		const IRInstruction& last = values[instructions.back()];
+		if (last.op == IROp::Jump) f(last.targets[0]);
+		if (last.op == IROp::Branch) {
+			f(last.targets[0]);
+			if (last.targets[1] != last.targets[0]) f(last.targets[1]);
+		}
+	}
+};
+
+class IRFunction {
+public:
+	Symbol name;
+	IRType result = IRType::Float;
+	std::vector<IRType> params;
+	std::vector<IRInstruction> values;
+	std::vector<IRBlock> blocks;	// blocks[0] is the entry
+
+	BlockId addBlock() {
+		blocks.emplace_back();
+		return static_cast<BlockId>(blocks.size() - 1);
+	}
+
+	// Appends to block, before nothing: callers add the terminator last
+	ValueId append(BlockId block, IRInstruction in) {
+		ValueId id = create(block, std::move(in));
+		blocks[block].instructions.push_back(id);
+		return id;
+	}
+
+	ValueId addPhi(BlockId block, IRType type) {
+		IRInstruction phi{IROp::Phi, type};
+		phi.operands.assign(blocks[block].preds.size(), noValue);
+		ValueId id = create(block, std::move(phi));
+		auto& list = blocks[block].instructions;
+		list.insert(std::find_if(list.begin(), list.end(), [&](ValueId v) { return values[v].op != IROp::Phi; }), id);
+		return id;
+	}
+
+	// Inserts a new instruction right before `before` in its block
+	ValueId insertBefore(ValueId before, IRInstruction in) {
+		BlockId block = values[before].block;
+		ValueId id = create(block, std::move(in));
+		auto& list = blocks[block].instructions;
+		list.insert(std::find(list.begin(), list.end(), before), id);
+		return id;
+	}
+
+	void setOperand(ValueId user, size_t i, ValueId value) {
+		ValueId& slot = values[user].operands[i];
+		if (slot != noValue) dropUse(slot, user);
+		slot = value;
+		if (value != noValue) values[value].users.push_back(user);
+	}
+
+	// Makes every use of from a use of to
+	void replaceAllUses(ValueId from, ValueId to) {
+		if (from == to) return;
+		std::vector<ValueId> users = std::move(values[from].users);
+		values[from].users.clear();
+		for (ValueId user : users) {
+			for (ValueId& operand : values[user].operands) {
+				if (operand == from) operand = to;
+			}
+			values[to].users.push_back(user);
+		}
+	}
+
+	// Marks id dead and releases its operands. Its own users must be gone already.
+	void remove(ValueId id) {
+		IRInstruction& in = values[id];
+		for (ValueId operand : in.operands) {
+			if (operand != noValue) dropUse(operand, id);
+		}
+		in.operands.clear();
+		in.dead = true;
+	}
+
+	// Drops dead instructions from the block lists
+	void sweep() {
+		for (IRBlock& block : blocks) {
+			std::erase_if(block.instructions, [&](ValueId v) { return values[v].dead; });
+		}
+	}
+
+	// Removes the edge from -> to: to loses that predecessor and the matching phi operand
+	void removeEdge(BlockId from, BlockId to) {
+		IRBlock& target = blocks[to];
+		auto it = std::find(target.preds.begin(), target.preds.end(), from);
+		if (it == target.preds.end()) return;
+		size_t position = it - target.preds.begin();
+		target.preds.erase(it);
+		for (ValueId v : target.instructions) {
+			IRInstruction& phi = values[v];
+			if (phi.op != IROp::Phi) break;
+			if (phi.dead) continue;		// removed, not yet swept
+			if (phi.operands[position] != noValue) dropUse(phi.operands[position], v);
+			phi.operands.erase(phi.operands.begin() + position);
+		}
+	}
+
+	// Reverse postorder of the blocks reachable from the entry
+	std::vector<BlockId> reversePostorder() const {
+		std::vector<BlockId> order;
+		std::vector<uint8_t> state(blocks.size(), 0);	// 0 new, 1 on stack, 2 done
+		std::vector<std::pair<BlockId, std::vector<BlockId>>> stack;
+		auto successors = [&](BlockId b) {
+			std::vector<BlockId> out;
+			blocks[b].forEachSuccessor(values, [&](BlockId s) { out.push_back(s); });
+			std::reverse(out.begin(), out.end());
+			return out;
+		};
+		stack.emplace_back(0, successors(0));
+		state[0] = 1;
+		while (!stack.empty()) {
+			auto& [block, pending] = stack.back();
+			if (pending.empty()) {
+				order.push_back(block);
+				state[block] = 2;
+				stack.pop_back();
+				continue;
+			}
+			BlockId next = pending.back();
+			pending.pop_back();
+			if (state[next] == 0) {
+				state[next] = 1;
+				stack.emplace_back(next, successors(next));
+			}
+		}
+		std::reverse(order.begin(), order.end());
+		return order;
+	}
+
+	// Deletes blocks the entry cannot reach, with their instructions and outgoing edges
+	bool removeUnreachableBlocks() {
+		std::vector<uint8_t> reachable(blocks.size(), 0);
+		for (BlockId b : reversePostorder()) reachable[b] = 1;
+		bool changed = false;
+		for (BlockId b = 0; b < blocks.size(); ++b) {
+			if (reachable[b] || blocks[b].dead) continue;
+			changed = true;
+			blocks[b].forEachSuccessor(values, [&](BlockId s) { removeEdge(b, s); });
+			for (ValueId v : blocks[b].instructions) {
+				values[v].users.clear();	// any user is unreachable too, or a phi edge just removed
+				remove(v);
+			}
+			blocks[b].instructions.clear();
+			blocks[b].preds.clear();
+			blocks[b].dead = true;
+		}
+		return changed;
+	}
+
+	size_t liveInstructionCount() const {
+		size_t count = 0;
+		for (const IRBlock& block : blocks) count += block.instructions.size();
+		return count;
+	}
+
+	// Checks the structural invariants; throws std::runtime_error naming the first broken one
+	void verify() const {
+		auto fail = [&](const std::string& what) {
+			throw std::runtime_error("IR of '" + std::string(globalInterner().text(name)) + "': " + what);
+		};
+		for (BlockId b = 0; b < blocks.size(); ++b) {
+			const IRBlock& block = blocks[b];
+			if (block.dead) continue;
+			if (block.instructions.empty() || !isTerminator(values[block.instructions.back()].op)) {
+				fail("block " + std::to_string(b) + " has no terminator");
+			}
+			bool phis = true;
+			for (size_t i = 0; i < block.instructions.size(); ++i) {
+				ValueId v = block.instructions[i];
+				const IRInstruction& in = values[v];
+				if (in.dead || in.block != b) fail("v" + std::to_string(v) + " is listed in the wrong block");
+				if (in.op != IROp::Phi) phis = false;
+				else if (!phis) fail("phi v" + std::to_string(v) + " after a non-phi");
+				if (isTerminator(in.op) && i + 1 != block.instructions.size()) fail("terminator in the middle of a block");
+				if (in.op == IROp::Phi && in.operands.size() != block.preds.size()) fail("phi v" + std::to_string(v) + " arity");
+				for (ValueId operand : in.operands) {
+					if (operand == noValue || values[operand].dead) fail("v" + std::to_string(v) + " uses a dead value");
+					const auto& users = values[operand].users;
+					if (std::find(users.begin(), users.end(), v) == users.end()) fail("use-list of v" + std::to_string(operand));
+				}
+			}
+			block.forEachSuccessor(values, [&](BlockId s) {
+				const auto& preds = blocks[s].preds;
+				if (blocks[s].dead || std::find(preds.begin(), preds.end(), b) == preds.end()) {
+					fail("edge " + std::to_string(b) + " -> " + std::to_string(s) + " missing from preds");
+				}
+			});
+		}
+	}
+
+	void print(std::ostream& out) const {
+		out << "function " << name << "(";
+		for (size_t i = 0; i < params.size(); ++i) out << (i ? ", " : "") << irTypeNames[static_cast<size_t>(params[i])];
+		out << ") -> " << irTypeNames[static_cast<size_t>(result)] << "\n";
+		for (BlockId b = 0; b < blocks.size(); ++b) {
+			const IRBlock& block = blocks[b];
+			if (block.dead) continue;
+			out << "b" << b << ":";
+			if (!block.preds.empty()) {
+				out << "\t\t; preds";
+				for (BlockId p : block.preds) out << " b" << p;
+			}
+			out << "\n";
+			for (ValueId v : block.instructions) {
+				const IRInstruction& in = values[v];
+				out << "  ";
+				if (in.type != IRType::Void) out << "v" << v << ": " << irTypeNames[static_cast<size_t>(in.type)] << " = ";
+				out << irOpNames[static_cast<size_t>(in.op)];
+				if (in.op == IROp::Const) out << " " << in.constant;
+				if (in.op == IROp::Param || in.op == IROp::Call || in.op == IROp::Read || in.op == IROp::Write) out << " #" << in.index;
+				for (ValueId operand : in.operands) out << " v" << operand;
+				if (in.op == IROp::Jump || in.op == IROp::Branch) out << " -> b" << in.targets[0];
+				if (in.op == IROp::Branch) out << ", b" << in.targets[1];
+				out << "\n";
+			}
+		}
+	}
+
+private:
+	ValueId create(BlockId block, IRInstruction in) {
+		in.block = block;
+		ValueId id = static_cast<ValueId>(values.size());
+		for (ValueId operand : in.operands) {
+			if (operand != noValue) values[operand].users.push_back(id);
+		}
+		values.push_back(std::move(in));
+		return id;
+	}
+
+	void dropUse(ValueId value, ValueId user) {
+		auto& users = values[value].users;
+		auto it = std::find(users.begin(), users.end(), user);
+		if (it != users.end()) {
+			*it = users.back();
+			users.pop_back();
+		}
+	}
+};
+
+// Functions by global slot, so Call indices are the Resolver's slot numbers
+struct IRModule {
+	std::vector<IRFunction> functions;
+
+	size_t instructionCount() const {
+		size_t count = 0;
+		for (const IRFunction& function : functions) count += function.liveInstructionCount();
+		return count;
+	}
+
+	void print(std::ostream& out) const {
+		for (const IRFunction& function : functions) function.print(out);
+	}
+};
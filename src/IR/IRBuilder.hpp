@@ -0,0 +1,396 @@
+#pragma once
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Builtins.hpp"
+#include "Dominators.hpp"
+#include "IR.hpp"
+#include "SyntaxTree.hpp"
+
+// Builds SSA form from a resolved, type-checked Program, one IRFunction per FunctionDecl.
+// Lowering first treats every frame slot as a variable: reads and writes become Read and
+// Write instructions. SSA construction then follows Cytron et al.: phis go on the
+// iterated dominance frontier of each slot's writes, and a walk of the dominator tree
+// renames every Read to the value that reaches it. Nothing but phis and real
+// instructions survives.
+//
+// Locals start out as 0 (or the null array), so every slot is written in the entry
+// block; the phis this creates for slots that are not live are left to dead-code
+// elimination. Like the bytecode compiler, this rejects class values.
+class IRBuilder {
+private:
+	struct Loop {
+		BlockId continueTarget;
+		BlockId breakTarget;
+	};
+
+	std::vector<const FunctionDecl*> globals;
+	IRFunction* fn = nullptr;
+	const FunctionDecl* decl = nullptr;
+	BlockId current = 0;
+	std::vector<IRType> slotTypes;
+	std::vector<Loop> loops;
+
+public:
+	IRModule build(const Program& program) {
+		globals.clear();
+		for (const ASTNode* node : program.Code) {
+			if (auto* function = dynamic_cast<const FunctionDecl*>(node)) globals.push_back(function);
+		}
+		IRModule module;
+		module.functions.resize(globals.size());
+		for (size_t i = 0; i < globals.size(); ++i) buildFunction(*globals[i], module.functions[i]);
+		return module;
+	}
+
+private:
+	[[noreturn]] void unsupported(const char* what) const {
+		throw std::runtime_error("In function '" + std::string(globalInterner().text(decl->name)) + "': " + what +
+								 " cannot be lowered to IR yet.");
+	}
+
+	IRType typeOf(const Type* type) const {
+		if (!type) throw std::runtime_error("Function '" + std::string(globalInterner().text(decl->name)) + "' has not been type-checked.");
+		switch (type->kind) {
+			case Type::Kind::Array: return IRType::Array;
+			case Type::Kind::Primitive: return type->size == 0 ? IRType::Void : IRType::Float;
+			default: unsupported("A class value");
+		}
+	}
+
+	void buildFunction(const FunctionDecl& function, IRFunction& target) {
+		decl = &function;
+		fn = &target;
+		loops.clear();
+		if (!function.signature || function.frameTypes.size() != function.frameSize) typeOf(nullptr);
+		target.name = function.name;
+		target.result = typeOf(function.signature->result);
+		slotTypes.clear();
+		for (const Type* type : function.frameTypes) slotTypes.push_back(typeOf(type));
+		target.params.assign(slotTypes.begin(), slotTypes.begin() + function.params.size());
+
+		current = target.addBlock();
+		for (uint32_t slot = 0; slot < function.frameSize; ++slot) {
+			ValueId initial = slot < function.params.size() ? emit(IROp::Param, slotTypes[slot], {}, slot)
+															: zero(slotTypes[slot]);
+			write(slot, initial);
+		}
+		statement(function.body);
+		if (!terminated()) emitReturn(zero(IRType::Float));
+
+		target.removeUnreachableBlocks();
+		target.sweep();
+		constructSsa();
+	}
+
+	//---------------------------------------------------------------------------------------------------------------------------------------------------------------
+	// Emission helpers
+
+	ValueId emit(IRInstruction in) {
+		if (terminated()) current = fn->addBlock();	// code after return/break: unreachable, dropped later
+		return fn->append(current, std::move(in));
+	}
+
+	ValueId emit(IROp op, IRType type, std::vector<ValueId> operands, uint32_t index = 0) {
+		IRInstruction in{op, type};
+		in.index = index;
+		in.operands = std::move(operands);
+		return emit(std::move(in));
+	}
+
+	ValueId constant(double value, IRType type = IRType::Float) {
+		IRInstruction in{IROp::Const, type};
+		in.constant = value;
+		return emit(std::move(in));
+	}
+
+	ValueId zero(IRType type) { return constant(0, type == IRType::Array ? IRType::Array : IRType::Float); }
+
+	ValueId read(uint32_t slot) { return emit(IROp::Read, slotTypes[slot], {}, slot); }
+	void write(uint32_t slot, ValueId value) { emit(IROp::Write, IRType::Void, {value}, slot); }
+
+	bool terminated() const {
+		const auto& list = fn->blocks[current].instructions;
+		return !list.empty() && isTerminator(fn->values[list.back()].op);
+	}
+
+	void addEdge(BlockId to) {
+		auto& preds = fn->blocks[to].preds;
+		if (std::find(preds.begin(), preds.end(), current) == preds.end()) preds.push_back(current);
+	}
+
+	void jump(BlockId target) {
+		if (terminated()) return;
+		IRInstruction in{IROp::Jump};
+		in.targets[0] = target;
+		fn->append(current, std::move(in));
+		addEdge(target);
+	}
+
+	void branch(ValueId condition, BlockId ifTrue, BlockId ifFalse) {
+		IRInstruction in{IROp::Branch};
+		in.operands = {condition};
+		in.targets[0] = ifTrue;
+		in.targets[1] = ifFalse;
+		fn->append(current, std::move(in));
+		addEdge(ifTrue);
+		addEdge(ifFalse);
+	}
+
+	void emitReturn(ValueId value) { emit(IROp::Return, IRType::Void, {value}); }
+
+	void startBlock(BlockId block) { current = block; }
+
+	static IROp arithmetic(OpKind op) {
+		switch (op) {
+			case OpKind::Add: return IROp::Add;
+			case OpKind::Sub: return IROp::Sub;
+			case OpKind::Mul: return IROp::Mul;
+			case OpKind::Div: return IROp::Div;
+			case OpKind::Mod: return IROp::Mod;
+			case OpKind::Pow: return IROp::Pow;
+			case OpKind::Equal: return IROp::Equal;
+			case OpKind::NotEqual: return IROp::NotEqual;
+			case OpKind::Less: return IROp::Less;
+			case OpKind::LessEqual: return IROp::LessEqual;
+			case OpKind::Greater: return IROp::Greater;
+			case OpKind::GreaterEqual: return IROp::GreaterEqual;
+			default: throw std::runtime_error("Not a binary operator.");
+		}
+	}
+
+	//---------------------------------------------------------------------------------------------------------------------------------------------------------------
+	// Expressions
+
+	ValueId expression(const ASTNode* node) {
+		if (auto* n = dynamic_cast<const LiteralExpr*>(node)) {
+			return constant(n->value);
+		} else if (auto* n = dynamic_cast<const VariableExpr*>(node)) {
+			if (!n->slot.isLocal()) unsupported("A function used as a value");
+			return read(n->slot.index);
+		} else if (auto* n = dynamic_cast<const BinaryExpr*>(node)) {
+			if (n->op == OpKind::Assign) return assign(*n);
+			ValueId left = expression(n->left);
+			ValueId right = expression(n->right);
+			return emit(arithmetic(n->op), IRType::Float, {left, right});
+		} else if (auto* n = dynamic_cast<const PrefixExpr*>(node)) {
+			return unary(n->op, n->operand, true);
+		} else if (auto* n = dynamic_cast<const UnaryExpr*>(node)) {
+			return unary(n->op, n->expr, true);
+		} else if (auto* n = dynamic_cast<const PostfixExpr*>(node)) {
+			return unary(n->op, n->operand, false);
+		} else if (auto* n = dynamic_cast<const IndexExpr*>(node)) {
+			ValueId array = expression(n->target);
+			ValueId index = expression(n->index);
+			return emit(IROp::GetIndex, IRType::Float, {array, index});
+		} else if (auto* n = dynamic_cast<const FunctionCallExpr*>(node)) {
+			return call(*n);
+		} else if (dynamic_cast<const ClassFieldAccessExpr*>(node) || dynamic_cast<const ClassInstanceExpr*>(node)) {
+			unsupported("A class value");
+		}
+		unsupported("This expression");
+	}
+
+	ValueId assign(const BinaryExpr& n) {
+		if (auto* variable = dynamic_cast<const VariableExpr*>(n.left); variable && variable->slot.isLocal()) {
+			ValueId value = expression(n.right);
+			write(variable->slot.index, value);
+			return value;
+		}
+		if (auto* target = dynamic_cast<const IndexExpr*>(n.left)) {
+			ValueId array = expression(target->target);
+			ValueId index = expression(target->index);
+			ValueId value = expression(n.right);
+			emit(IROp::SetIndex, IRType::Void, {array, index, value});
+			return value;
+		}
+		unsupported("Assignment to a class field");
+	}
+
+	ValueId unary(OpKind op, const ASTNode* operand, bool prefix) {
+		if (op == OpKind::Sub) return emit(IROp::Neg, IRType::Float, {expression(operand)});
+		if (op == OpKind::Not) return emit(IROp::Not, IRType::Float, {expression(operand)});
+		const double step = op == OpKind::Increment ? 1 : -1;
+		if (auto* variable = dynamic_cast<const VariableExpr*>(operand); variable && variable->slot.isLocal()) {
+			ValueId before = read(variable->slot.index);
+			ValueId after = emit(IROp::Add, IRType::Float, {before, constant(step)});
+			write(variable->slot.index, after);
+			return prefix ? after : before;
+		}
+		if (auto* target = dynamic_cast<const IndexExpr*>(operand)) {
+			ValueId array = expression(target->target);
+			ValueId index = expression(target->index);
+			ValueId before = emit(IROp::GetIndex, IRType::Float, {array, index});
+			ValueId after = emit(IROp::Add, IRType::Float, {before, constant(step)});
+			emit(IROp::SetIndex, IRType::Void, {array, index, after});
+			return prefix ? after : before;
+		}
+		unsupported("Incrementing a class field");
+	}
+
+	ValueId call(const FunctionCallExpr& n) {
+		if (n.target.isBuiltin()) {
+			ValueId argument = expression(n.arguments[0]);
+			switch (builtinFunctions[n.target.index].id) {
+				case Builtin::Array: return emit(IROp::NewArray, IRType::Array, {argument});
+				case Builtin::Length: return emit(IROp::Length, IRType::Float, {argument});
+			}
+		}
+		if (!n.target.isGlobal()) unsupported("An indirect call");
+		std::vector<ValueId> args;
+		for (const ASTNode* arg : n.arguments) args.push_back(expression(arg));
+		IRType result = typeOf(globals[n.target.index]->signature->result);
+		return emit(IROp::Call, result, std::move(args), n.target.index);
+	}
+
+	//---------------------------------------------------------------------------------------------------------------------------------------------------------------
+	// Statements
+
+	void statement(const ASTNode* node) {
+		if (!node) return;
+		if (auto* n = dynamic_cast<const CompoundStmt*>(node)) {
+			for (const ASTNode* stmt : n->statements) statement(stmt);
+		} else if (auto* n = dynamic_cast<const BlockStmt*>(node)) {
+			for (const ASTNode* stmt : n->statements) statement(stmt);
+		} else if (auto* n = dynamic_cast<const DefinitionStmt*>(node)) {
+			auto* assignment = dynamic_cast<const BinaryExpr*>(n->expression);
+			ValueId value = assignment && assignment->op == OpKind::Assign ? expression(assignment->right)
+																		   : zero(slotTypes[n->slot.index]);
+			write(n->slot.index, value);
+		} else if (auto* n = dynamic_cast<const IfStmt*>(node)) {
+			ValueId condition = expression(n->condition);
+			BlockId thenBlock = fn->addBlock(), endBlock = fn->addBlock();
+			BlockId elseBlock = n->elseBranch ? fn->addBlock() : endBlock;
+			branch(condition, thenBlock, elseBlock);
+			startBlock(thenBlock);
+			statement(n->thenBranch);
+			jump(endBlock);
+			if (n->elseBranch) {
+				startBlock(elseBlock);
+				statement(n->elseBranch);
+				jump(endBlock);
+			}
+			startBlock(endBlock);
+		} else if (auto* n = dynamic_cast<const WhileStmt*>(node)) {
+			loop(n->condition, n->body, nullptr);
+		} else if (auto* n = dynamic_cast<const ForStmt*>(node)) {
+			statement(n->initializer);
+			loop(n->condition, n->body, n->incrementor);
+		} else if (auto* n = dynamic_cast<const ReturnStmt*>(node)) {
+			emitReturn(n->expression ? expression(n->expression) : zero(IRType::Float));
+		} else if (dynamic_cast<const BreakStmt*>(node)) {
+			jump(loops.back().breakTarget);
+		} else if (dynamic_cast<const ContinueStmt*>(node)) {
+			jump(loops.back().continueTarget);
+		} else {
+			expression(node);
+		}
+	}
+
+	//     header: if (condition) body else exit; body: ...; latch: increment; jump header
+	void loop(const ASTNode* condition, const ASTNode* body, const ASTNode* increment) {
+		BlockId header = fn->addBlock(), bodyBlock = fn->addBlock(), exit = fn->addBlock();
+		BlockId latch = increment ? fn->addBlock() : header;
+		jump(header);
+		startBlock(header);
+		branch(expression(condition), bodyBlock, exit);
+		startBlock(bodyBlock);
+		loops.push_back({latch, exit});
+		statement(body);
+		loops.pop_back();
+		jump(latch);
+		if (increment) {
+			startBlock(latch);
+			statement(increment);
+			jump(header);
+		}
+		startBlock(exit);
+	}
+
+	//---------------------------------------------------------------------------------------------------------------------------------------------------------------
+	// SSA construction
+
+	void constructSsa() {
+		DominatorTree dom(*fn);
+		const size_t slots = slotTypes.size();
+		std::vector<uint32_t> phiSlot(fn->values.size(), noValue);
+
+		// Phis on the iterated dominance frontier of each slot's writes
+		std::vector<std::vector<BlockId>> writeBlocks(slots);
+		for (BlockId b : dom.order) {
+			for (ValueId v : fn->blocks[b].instructions) {
+				const IRInstruction& in = fn->values[v];
+				if (in.op == IROp::Write && (writeBlocks[in.index].empty() || writeBlocks[in.index].back() != b)) {
+					writeBlocks[in.index].push_back(b);
+				}
+			}
+		}
+		std::vector<uint32_t> hasPhi(fn->blocks.size(), noValue), queued(fn->blocks.size(), noValue);
+		for (uint32_t slot = 0; slot < slots; ++slot) {
+			std::vector<BlockId> work = writeBlocks[slot];
+			for (BlockId b : work) queued[b] = slot;
+			while (!work.empty()) {
+				BlockId b = work.back();
+				work.pop_back();
+				for (BlockId f : dom.frontier[b]) {
+					if (hasPhi[f] == slot) continue;
+					hasPhi[f] = slot;
+					ValueId phi = fn->addPhi(f, slotTypes[slot]);
+					phiSlot.resize(fn->values.size(), noValue);
+					phiSlot[phi] = slot;
+					if (queued[f] != slot) {
+						queued[f] = slot;
+						work.push_back(f);
+					}
+				}
+			}
+		}
+
+		// Rename along the dominator tree; each slot's stack holds its reaching value
+		std::vector<std::vector<ValueId>> reaching(slots);
+		struct Visit {
+			BlockId block;
+			bool leaving;
+			std::vector<uint32_t> pushed;
+		};
+		std::vector<Visit> stack;
+		stack.push_back({0, false, {}});
+		while (!stack.empty()) {
+			if (stack.back().leaving) {
+				for (uint32_t slot : stack.back().pushed) reaching[slot].pop_back();
+				stack.pop_back();
+				continue;
+			}
+			stack.back().leaving = true;
+			const BlockId b = stack.back().block;
+			std::vector<uint32_t> pushed;
+			for (ValueId v : fn->blocks[b].instructions) {
+				IRInstruction& in = fn->values[v];
+				if (in.op == IROp::Phi && phiSlot[v] != noValue) {
+					reaching[phiSlot[v]].push_back(v);
+					pushed.push_back(phiSlot[v]);
+				} else if (in.op == IROp::Read) {
+					fn->replaceAllUses(v, reaching[in.index].back());
+					fn->remove(v);
+				} else if (in.op == IROp::Write) {
+					reaching[in.index].push_back(in.operands[0]);
+					pushed.push_back(in.index);
+					fn->remove(v);
+				}
+			}
+			fn->blocks[b].forEachSuccessor(fn->values, [&](BlockId s) {
+				const auto& preds = fn->blocks[s].preds;
+				size_t position = std::find(preds.begin(), preds.end(), b) - preds.begin();
+				for (ValueId v : fn->blocks[s].instructions) {
+					if (fn->values[v].op != IROp::Phi) break;
+					if (phiSlot[v] != noValue) fn->setOperand(v, position, reaching[phiSlot[v]].back());
+				}
+			});
+			stack.back().pushed = std::move(pushed);
+			for (BlockId child : dom.children[b]) stack.push_back({child, false, {}});
+		}
+		fn->sweep();
+	}
+};
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <ostream>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "IR.hpp"
+
+// A transformation of one function. run() returns whether it changed anything.
+class FunctionPass {
+public:
+	virtual ~FunctionPass() = default;
+	virtual std::string_view name() const = 0;
+	virtual bool run(IRFunction& function) = 0;
+};
+
+// Runs passes in the order they were added, each over every function of the module, and
+// keeps per-pass wall time and instruction counts. With verification on, the IR is
+// checked after every pass, so a broken invariant is blamed on the pass that broke it.
+class PassManager {
+public:
+	struct Timing {
+		std::string_view pass;
+		double seconds = 0;
+		size_t functionsChanged = 0;
+		size_t instructionsBefore = 0;
+		size_t instructionsAfter = 0;
+	};
+
+private:
+	std::vector<std::unique_ptr<FunctionPass>> passes;
+	std::vector<Timing> results;
+	bool verifyEach = false;
+
+public:
+	template<class P, class... Args>
+	PassManager& add(Args&&... args) {
+		passes.push_back(std::make_unique<P>(std::forward<Args>(args)...));
+		return *this;
+	}
+
+	PassManager& verify(bool enabled = true) {
+		verifyEach = enabled;
+		return *this;
+	}
+
+	// Returns whether any pass changed anything
+	bool run(IRModule& module) {
+		results.clear();
+		bool changed = false;
+		for (auto& pass : passes) {
+			Timing timing{pass->name()};
+			timing.instructionsBefore = module.instructionCount();
+			auto start = std::chrono::steady_clock::now();
+			for (IRFunction& function : module.functions) {
+				if (pass->run(function)) ++timing.functionsChanged;
+			}
+			timing.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			timing.instructionsAfter = module.instructionCount();
+			changed |= timing.functionsChanged != 0;
+			if (verifyEach) {
+				for (const IRFunction& function : module.functions) function.verify();
+			}
+			results.push_back(timing);
+		}
+		return changed;
+	}
+
+	const std::vector<Timing>& timings() const { return results; }
+
+	void printTimings(std::ostream& out) const {
+		for (const Timing& t : results) {
+			out << t.pass << ": " << t.seconds * 1e3 << " ms, " << t.functionsChanged << " functions changed, "
+				<< t.instructionsBefore << " -> " << t.instructionsAfter << " instructions\n";
+		}
+	}
+};
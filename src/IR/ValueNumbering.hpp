@@ -0,0 +1,125 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+#include "Dominators.hpp"
+#include "IR.hpp"
+#include "PassManager.hpp"
+
+// Dominator-based global value numbering. Walking the dominator tree in preorder, an
+// instruction that computes the same thing as one in a dominating block (same opcode,
+// type and operands; commutative operands in either order) is replaced by it. The table
+// is scoped like the resolver's symbol table: entries made in a block are undone when
+// the walk leaves it. Phis whose operands are all one value (or the phi itself) are
+// replaced by that value.
+//
+// Only pure instructions are numbered, plus Length: an array's length never changes, and
+// if the dominating Length did not fault, neither would the copy.
+class GlobalValueNumbering : public FunctionPass {
+private:
+	struct Key {
+		IROp op;
+		IRType type;
+		uint32_t index;
+		uint64_t constant;
+		BlockId block;		// phis are only equal within one block
+		std::vector<ValueId> operands;
+
+		bool operator==(const Key&) const = default;
+	};
+
+	struct KeyHash {
+		size_t operator()(const Key& key) const {
+			uint64_t h = 1469598103934665603ull;
+			auto mix = [&](uint64_t x) { h = (h ^ x) * 1099511628211ull; };
+			mix(static_cast<uint64_t>(key.op) | static_cast<uint64_t>(key.type) << 8);
+			mix(key.index);
+			mix(key.constant);
+			mix(key.block);
+			for (ValueId v : key.operands) mix(v);
+			return static_cast<size_t>(h);
+		}
+	};
+
+	std::unordered_map<Key, ValueId, KeyHash> table;
+	std::vector<const Key*> undo;
+
+public:
+	std::string_view name() const override { return "gvn"; }
+
+	bool run(IRFunction& function) override {
+		table.clear();
+		undo.clear();
+		DominatorTree dom(function);
+		bool changed = false;
+
+		struct Visit {
+			BlockId block;
+			size_t undoMark;	// noValue until entered
+		};
+		std::vector<Visit> stack{{0, noValue}};
+		while (!stack.empty()) {
+			Visit& visit = stack.back();
+			if (visit.undoMark != noValue) {
+				while (undo.size() > visit.undoMark) {
+					table.erase(*undo.back());
+					undo.pop_back();
+				}
+				stack.pop_back();
+				continue;
+			}
+			visit.undoMark = undo.size();
+			const BlockId b = visit.block;
+			for (ValueId v : function.blocks[b].instructions) {
+				if (function.values[v].dead) continue;
+				ValueId same = trivialPhi(function, v);
+				if (same == noValue && numbered(function.values[v].op)) {
+					auto [it, inserted] = table.emplace(keyOf(function, v), v);
+					if (inserted) undo.push_back(&it->first);
+					else same = it->second;
+				}
+				if (same != noValue) {
+					function.replaceAllUses(v, same);
+					function.remove(v);
+					changed = true;
+				}
+			}
+			for (BlockId child : dom.children[b]) stack.push_back({child, noValue});
+		}
+		if (changed) function.sweep();
+		return changed;
+	}
+
+private:
+	static bool numbered(IROp op) {
+		return op == IROp::Length || op == IROp::Phi || (!hasSideEffects(op) && op != IROp::Param && op != IROp::Read);
+	}
+
+	static bool commutative(IROp op) {
+		return op == IROp::Add || op == IROp::Mul || op == IROp::Equal || op == IROp::NotEqual;
+	}
+
+	static Key keyOf(const IRFunction& function, ValueId v) {
+		const IRInstruction& in = function.values[v];
+		Key key{in.op, in.type, in.index, 0, in.op == IROp::Phi ? in.block : noValue, in.operands};
+		std::memcpy(&key.constant, &in.constant, sizeof key.constant);
+		if (commutative(in.op) && key.operands[0] > key.operands[1]) std::swap(key.operands[0], key.operands[1]);
+		return key;
+	}
+
+	// The one value a phi merges, ignoring its own back edges; noValue if it merges several
+	static ValueId trivialPhi(const IRFunction& function, ValueId v) {
+		const IRInstruction& in = function.values[v];
+		if (in.op != IROp::Phi) return noValue;
+		ValueId same = noValue;
+		for (ValueId operand : in.operands) {
+			if (operand == v || operand == same) continue;
+			if (same != noValue) return noValue;
+			same = operand;
+		}
+		return same;
+	}
+};
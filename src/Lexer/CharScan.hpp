@@ -0,0 +1,188 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <string_view>
+
+#if defined(__x86_64__) || defined(_M_X64) || (defined(__i386__) && defined(__SSE2__))
+#define LEXER_SCAN_SSE2 1
+#include <emmintrin.h>
+#if defined(__GNUC__)
+#define LEXER_SCAN_AVX2 1
+#include <immintrin.h>
+#endif
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Character classification and run scanning for the lexer. Every byte is classified
+// through one 256-entry table; runs of a class (whitespace, identifier tail, number
+// tail) are skipped 16 or 32 bytes at a time when SSE2/AVX2 is available. Operators get
+// no run scan: a run such as "=-" is several tokens, each matched by matchOperator, and
+// a token is at most two bytes, so their class is only used to classify.
+namespace charscan {
+
+enum CharClass : uint8_t {
+	Space      = 1 << 0,	// blanks other than '\n'
+	Newline    = 1 << 1,
+	Alpha      = 1 << 2,	// can start an identifier
+	Digit      = 1 << 3,
+	IdentTail  = 1 << 4,	// letters, digits, '_'
+	NumberTail = 1 << 5,	// digits, '.'
+	Operator   = 1 << 6,	// + - * / % ^ < > = ! .
+};
+
+constexpr std::array<uint8_t, 256> makeClassTable() {
+	std::array<uint8_t, 256> table{};
+	for (int c = 0; c < 256; ++c) {
+		uint8_t cls = 0;
+		if (c == ' ' || c == '\t' || c == '\v' || c == '\f' || c == '\r') cls |= Space;
+		if (c == '\n') cls |= Newline;
+		if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) cls |= Alpha | IdentTail;
+		if (c >= '0' && c <= '9') cls |= Digit | IdentTail | NumberTail;
+		if (c == '_') cls |= IdentTail;
+		if (c == '.') cls |= NumberTail;
+		for (char op : std::string_view("+-*/%^<>=!.")) {
+			if (c == op) cls |= Operator;
+		}
+		table[c] = cls;
+	}
+	return table;
+}
+
+inline constexpr std::array<uint8_t, 256> classTable = makeClassTable();
+
+inline uint8_t classOf(char c) { return classTable[static_cast<unsigned char>(c)]; }
+
+enum class ScanLevel { Scalar, SSE2, AVX2 };
+
+inline ScanLevel detectScanLevel() {
+#if defined(LEXER_SCAN_AVX2)
+	if (__builtin_cpu_supports("avx2")) return ScanLevel::AVX2;
+#endif
+#if defined(LEXER_SCAN_SSE2)
+	return ScanLevel::SSE2;
+#else
+	return ScanLevel::Scalar;
+#endif
+}
+
+// Selected once at startup; may be lowered (e.g. by benchmarks) but never raised past the CPU
+inline ScanLevel activeLevel = detectScanLevel();
+
+inline unsigned firstSetBit(unsigned mask) {
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return index;
+#else
+	return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+
+#if defined(LEXER_SCAN_SSE2)
+namespace sse2 {
+	inline __m128i inRange(__m128i x, char lo, char hi) {
+		return _mm_and_si128(_mm_cmpeq_epi8(_mm_max_epu8(x, _mm_set1_epi8(lo)), x),
+							 _mm_cmpeq_epi8(_mm_min_epu8(x, _mm_set1_epi8(hi)), x));
+	}
+	inline __m128i eq(__m128i x, char c) { return _mm_cmpeq_epi8(x, _mm_set1_epi8(c)); }
+
+	// 0xFF in every lane whose byte belongs to Cls
+	template<uint8_t Cls>
+	inline __m128i members(__m128i x) {
+		if constexpr (Cls == Space) {
+			return _mm_or_si128(_mm_or_si128(eq(x, ' '), eq(x, '\t')), inRange(x, '\v', '\r'));
+		} else if constexpr (Cls == IdentTail) {
+			__m128i lower = _mm_or_si128(x, _mm_set1_epi8(0x20));
+			return _mm_or_si128(_mm_or_si128(inRange(lower, 'a', 'z'), inRange(x, '0', '9')), eq(x, '_'));
+		} else {
+			static_assert(Cls == NumberTail, "no SSE2 matcher for this class");
+			return _mm_or_si128(inRange(x, '0', '9'), eq(x, '.'));
+		}
+	}
+
+	template<uint8_t Cls>
+	inline size_t scan(const char* p, size_t i, size_t n) {
+		while (i + 16 <= n) {
+			__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+			unsigned outside = ~static_cast<unsigned>(_mm_movemask_epi8(members<Cls>(x))) & 0xFFFF;
+			if (outside) return i + firstSetBit(outside);
+			i += 16;
+		}
+		return i;
+	}
+}
+#endif
+
+#if defined(LEXER_SCAN_AVX2)
+namespace avx2 {
+	// Nibble lookup tables derived from classTable: byte c is in Cls iff
+	// lo[c & 15] & hi[c >> 4] != 0. Exact for every class because classes are ASCII only.
+	struct NibbleTables { std::array<uint8_t, 16> lo{}, hi{}; };
+
+	constexpr NibbleTables makeNibbleTables(uint8_t cls) {
+		NibbleTables t;
+		for (int h = 0; h < 8; ++h) {
+			t.hi[h] = static_cast<uint8_t>(1 << h);
+			for (int l = 0; l < 16; ++l) {
+				if (classTable[h << 4 | l] & cls) t.lo[l] |= static_cast<uint8_t>(1 << h);
+			}
+		}
+		return t;
+	}
+
+	template<uint8_t Cls>
+	inline constexpr NibbleTables nibbles = makeNibbleTables(Cls);
+
+	template<uint8_t Cls>
+	__attribute__((target("avx2"))) inline size_t scan(const char* p, size_t i, size_t n) {
+		const __m128i lo128 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(nibbles<Cls>.lo.data()));
+		const __m128i hi128 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(nibbles<Cls>.hi.data()));
+		const __m256i lo = _mm256_broadcastsi128_si256(lo128);
+		const __m256i hi = _mm256_broadcastsi128_si256(hi128);
+		const __m256i nibbleMask = _mm256_set1_epi8(0x0F);
+		while (i + 32 <= n) {
+			__m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+			__m256i l = _mm256_shuffle_epi8(lo, _mm256_and_si256(x, nibbleMask));
+			__m256i h = _mm256_shuffle_epi8(hi, _mm256_and_si256(_mm256_srli_epi16(x, 4), nibbleMask));
+			__m256i none = _mm256_cmpeq_epi8(_mm256_and_si256(l, h), _mm256_setzero_si256());
+			unsigned outside = static_cast<unsigned>(_mm256_movemask_epi8(none));
+			if (outside) return i + firstSetBit(outside);
+			i += 32;
+		}
+		return i;
+	}
+}
+#endif
+
+// Index of the first byte at or after i that is not in Cls
+template<uint8_t Cls>
+inline size_t scanWhile(std::string_view s, size_t i) {
+	const char* p = s.data();
+	const size_t n = s.size();
+	// Tokens are short; only pay for vector setup when the run is still going after a few bytes
+	for (size_t stop = i + 4 < n ? i + 4 : n; i < stop; ++i) {
+		if (!(classOf(p[i]) & Cls)) return i;
+	}
+	switch (activeLevel) {
+#if defined(LEXER_SCAN_AVX2)
+		case ScanLevel::AVX2: i = avx2::scan<Cls>(p, i, n); break;
+#endif
+#if defined(LEXER_SCAN_SSE2)
+		case ScanLevel::SSE2: i = sse2::scan<Cls>(p, i, n); break;
+#endif
+		default: break;
+	}
+	while (i < n && (classOf(p[i]) & Cls)) ++i;
+	return i;
+}
+
+inline size_t skipSpaces(std::string_view s, size_t i) { return scanWhile<Space>(s, i); }
+inline size_t scanIdentifier(std::string_view s, size_t i) { return scanWhile<IdentTail>(s, i); }
+inline size_t scanNumber(std::string_view s, size_t i) { return scanWhile<NumberTail>(s, i); }
+
+}
@@ -1,102 +1,150 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <optional>
 #include <vector>
 #include <iostream>
 #include "Lexer_config.hpp"
 
+// Resumable lexer over one contiguous buffer: each next() call produces one token, so
+// tokens can be pulled on demand instead of materializing the whole file up front.
+class TokenScanner {
+public:
+	// Throws std::runtime_error for buffers of 4 GiB or more (see checkCompactSourceSize)
+	TokenScanner(std::string_view source, StringInterner& interner = globalInterner())
+		: source(source), interner(interner) {
+		checkCompactSourceSize(source.size());
+	}
+
+	// Lexes the next token into out; false once the buffer is exhausted
+	bool next(CompactToken& out) {
+		const size_t size = source.size();
+
+		while (i < size) {
+			const uint8_t cls = charscan::classOf(source[i]);
+
+			if (cls & charscan::Newline) {
+				++lineNum;
+				lineStart = ++i;
+				continue;
+			}
+
+			// Skip whitespace
+			if (cls & charscan::Space) {
+				i = charscan::skipSpaces(source, i + 1);
+				continue;
+			}
+
+			size_t start = i;
+			TokenType type;
+			Symbol symbol;
+			OpKind op = OpKind::None;
+
+			if (cls & charscan::Alpha) {	// identifiers or keywords
+				i = charscan::scanIdentifier(source, i + 1);
+				std::string_view word = source.substr(start, i - start);
+				type = classifyWord(word);
+				if (type == TokenType::identifier) symbol = interner.intern(word);
+			} else if (cls & charscan::Digit) {	// integer literals
+				i = charscan::scanNumber(source, i + 1);
+				type = TokenType::int_lit;
+			} else if (cls & charscan::Operator) {	// one operator, longest match
+				uint32_t length;
+				op = matchOperator(source.substr(i), length);
+				i += length;
+				type = TokenType::_operator;
+			} else {	// punctuation (single-character tokens)
+				type = punctuationType(source[i]);
+				++i;
+			}
+
+			out = {type, op, static_cast<uint32_t>(start), static_cast<uint32_t>(i - start),
+				   lineNum, static_cast<uint32_t>(start - lineStart + 1), symbol};
+			return true;
+		}
+		return false;
+	}
+
+	// Lexes up to max tokens into out and returns how many were written
+	size_t fill(CompactToken* out, size_t max) {
+		size_t n = 0;
+		while (n < max && next(out[n])) ++n;
+		return n;
+	}
+
+	// Byte offset of the next character to lex
+	size_t offset() const { return i; }
+
+private:
+	static TokenType punctuationType(char c) {
+		switch(c) {
+			case '(': return TokenType::o_paren;
+			case ')': return TokenType::c_paren;
+			case '{': return TokenType::o_brace;
+			case '}': return TokenType::c_brace;
+			case '[': return TokenType::o_bracket;
+			case ']': return TokenType::c_bracket;
+			case ';': return TokenType::semicolon;
+			case ',': return TokenType::comma;
+			case ':': return TokenType::colon;
+			default: return TokenType::_unknown;
+		}
+	}
+
+	std::string_view source;
+	StringInterner& interner;
+	size_t i = 0;
+	size_t lineStart = 0;
+	uint32_t lineNum = 1;
+};
+
 class Lexer{
 public:
 	std::vector<Token> tokens;
+	StringInterner& interner = globalInterner();	// identifiers are interned as they are lexed
 
 void clear_tokens(){
 	tokens.clear();
 }
 
+// Line based API kept for the Parser: lexes the joined lines and materializes owned Tokens.
 std::vector<Token> tokenize(const std::vector<std::string>& file) {
-    std::vector<Token> tokens;
-    int lineNum = 1;
-
-    for (const std::string& line : file) {
-        size_t i = 0;
-        while (i < line.size()) {
-            char c = line[i];
-
-            // Skip whitespace
-            if (std::isspace(c)) {
-                ++i;
-                continue;
-            }
-
-            // Handle words (identifiers or keywords)
-            if (std::isalpha(c)) {
-                size_t start = i;
-                while (i < line.size() && (std::isalnum(line[i]) || line[i] == '_')) {
-                    ++i;
-                }
-                std::string word = line.substr(start, i - start);
-                tokens.push_back(mapStringToToken(word, lineNum));
-                continue;
-            }
-
-            // Handle integer literals
-            if (std::isdigit(c)) {
-                size_t start = i;
-                while (i < line.size() && (std::isdigit(line[i]) || line[i] == '.')) {
-                    ++i;
-                }
-                std::string number = line.substr(start, i - start);
-                Token token;
-                token.line = lineNum;
-                token.value = number;
-                token.type = TokenType::int_lit;
-                tokens.push_back(token);
-                continue;
-            }
-
-            // Handle operators
-            if (isOperatorChar(c)) {
-                size_t start = i;
-                while (i < line.size() && isOperatorChar(line[i])) {
-                    ++i;
-                }
-                std::string op = line.substr(start, i - start);
-                Token token;
-                token.line = lineNum;
-                token.value = op;
-				token.type = TokenType::_operator;
-                tokens.push_back(token);
-                continue;
-            }
-
-            // Handle punctuation and operators (single-character tokens for now)
-            {
-                Token token;
-                token.line = lineNum;
-                token.value = std::string(1, c);
-
-                switch(c) {
-                    case '(': token.type = TokenType::o_paren; break;
-                    case ')': token.type = TokenType::c_paren; break;
-                    case '{': token.type = TokenType::o_brace; break;
-                    case '}': token.type = TokenType::c_brace; break;
-                    case '[': token.type = TokenType::o_bracket; break;
-                    case ']': token.type = TokenType::c_bracket; break;
-                    case ';': token.type = TokenType::semicolon; break;
-                    case ',': token.type = TokenType::comma; break;
-                    case ':': token.type = TokenType::colon; break;
-                    default:
-                        token.type = TokenType::_unknown;
-                        break;
-                }
-                tokens.push_back(token);
-                ++i; // Move past the current character
-            }
-        }
-        ++lineNum;
-    }
-	return tokens;
+	std::string source;
+	size_t size = 0;
+	for (const std::string& line : file) size += line.size() + 1;
+	source.reserve(size);
+	for (const std::string& line : file) {
+		source += line;
+		source += '\n';
+	}
+	return toTokens(source, tokenizeBuffer(source));
+}
+
+// Lexes one contiguous buffer. Tokens only reference the buffer, so it must outlive them.
+std::vector<CompactToken> tokenizeBuffer(std::string_view source) const {
+	TokenScanner scanner(source, interner);	// rejects buffers too large for CompactToken
+	std::vector<CompactToken> out;
+	out.reserve(source.size() / 4);
+	CompactToken token;
+	while (scanner.next(token)) out.push_back(token);
+	return out;
+}
+
+// Builds owned Tokens from compact ones
+static std::vector<Token> toTokens(std::string_view source, const std::vector<CompactToken>& compact) {
+	std::vector<Token> result;
+	result.reserve(compact.size());
+	for (const CompactToken& ct : compact) {
+		Token token;
+		token.type = ct.type;
+		token.line = static_cast<int>(ct.line);
+		token.value = std::string(ct.text(source));
+		token.symbol = ct.symbol;
+		token.op = ct.op;
+		result.push_back(std::move(token));
+	}
+	return result;
 }
 };
 
@@ -105,4 +153,4 @@ void print_tokens(std::vector<Token>& tokens){
 		std::cout << "Line " << token.line << ": " << token.value
 				<< " (Type: " << static_cast<int>(token.type) << ")\n";
 	}
-}
\ No newline at end of file
+}
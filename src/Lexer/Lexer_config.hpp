@@ -1,8 +1,15 @@
 #pragma once
 #include <string>
-#include <unordered_map>
+#include <string_view>
+#include <cstdint>
+#include <array>
+#include <iterator>
+#include <stdexcept>
+#include "CharScan.hpp"
+#include "StringInterner.hpp"
+#include "Operators.hpp"
 
-enum class TokenType {
+enum class TokenType : uint8_t {
     // Keywords
     _function, _if, _else, _for, _while, _return,
     _true, _false, _break, _continue, _let,
@@ -29,6 +36,8 @@ struct Token {
 	int line;
 	std::string value;
 	std::string scoped_value;
+	Symbol symbol;	// interned value, set for identifiers
+	OpKind op = OpKind::None;	// set for operators
 
 	bool is(TokenType expectedType) const {
         return type == expectedType;
@@ -46,9 +55,43 @@ struct Token {
 	}
 };
 
+// Token produced by the buffer lexer: no owned text, only a range into the source buffer.
+struct CompactToken {
+	TokenType type;
+	OpKind op;			// set for operators
+	uint32_t offset;	// byte offset into the source buffer
+	uint32_t length;
+	uint32_t line;		// 1-based
+	uint32_t column;	// 1-based
+	Symbol symbol;		// interned text, set for identifiers
+
+	std::string_view text(std::string_view source) const {
+		return source.substr(offset, length);
+	}
 
-// language keywords:
-const std::unordered_map<std::string, TokenType> string_to_type = {
+	bool is(TokenType expectedType) const {
+		return type == expectedType;
+	}
+};
+
+// Offsets and lengths are 32-bit, so a buffer lexed into CompactTokens must be smaller
+// than 4 GiB; larger input is rejected rather than given wrapped spans.
+inline constexpr size_t maxCompactSourceBytes = UINT32_MAX;
+
+inline void checkCompactSourceSize(size_t bytes) {
+	if (bytes > maxCompactSourceBytes) {
+		throw std::runtime_error("Source of " + std::to_string(bytes) + " bytes is too large to lex; it must be under 4 GiB.");
+	}
+}
+
+
+struct Keyword {
+	std::string_view text;
+	TokenType type;
+};
+
+// language keywords (the only list; the lookup table below is generated from it):
+inline constexpr Keyword keywords[] = {
         {"def", TokenType::_function},
         {"if", TokenType::_if},
         {"else", TokenType::_else},
@@ -62,24 +105,81 @@ const std::unordered_map<std::string, TokenType> string_to_type = {
         {"let", TokenType::_let},
 };
 
+// Compile-time perfect hash over `keywords`: length, first and last byte pick a slot,
+// then one string_view compare confirms the match.
+namespace keyword_hash {
+	inline constexpr size_t keywordCount = std::size(keywords);
+
+	constexpr size_t tableSizeFor(size_t count) {
+		size_t size = 1;
+		while (size < count * 2) size <<= 1;
+		return size;
+	}
+	inline constexpr size_t tableSize = tableSizeFor(keywordCount);
+
+	constexpr size_t maxLength() {
+		size_t longest = 0;
+		for (const Keyword& k : keywords) longest = k.text.size() > longest ? k.text.size() : longest;
+		return longest;
+	}
+	inline constexpr size_t maxKeywordLength = maxLength();
+
+	constexpr uint32_t hash(std::string_view word, uint32_t seed) {
+		uint32_t first = static_cast<unsigned char>(word.front());
+		uint32_t last = static_cast<unsigned char>(word.back());
+		return (first * seed + last * 31 + static_cast<uint32_t>(word.size()) * 7) & (tableSize - 1);
+	}
+
+	constexpr bool collisionFree(uint32_t seed) {
+		bool used[tableSize] = {};
+		for (const Keyword& k : keywords) {
+			uint32_t slot = hash(k.text, seed);
+			if (used[slot]) return false;
+			used[slot] = true;
+		}
+		return true;
+	}
+
+	constexpr uint32_t findSeed() {
+		for (uint32_t seed = 1; seed < 1u << 16; ++seed) {
+			if (collisionFree(seed)) return seed;
+		}
+		return 0;
+	}
+	inline constexpr uint32_t seed = findSeed();
+	static_assert(seed != 0, "no perfect hash seed for the keyword set; widen hash() or tableSizeFor()");
+
+	// slot -> index into keywords, or -1
+	constexpr std::array<int8_t, tableSize> makeTable() {
+		std::array<int8_t, tableSize> table{};
+		for (auto& slot : table) slot = -1;
+		for (size_t i = 0; i < keywordCount; ++i) table[hash(keywords[i].text, seed)] = static_cast<int8_t>(i);
+		return table;
+	}
+	inline constexpr std::array<int8_t, tableSize> table = makeTable();
+}
+
+// Keyword type of a word, or identifier if it is not a keyword
+constexpr TokenType classifyWord(std::string_view word) {
+	if (word.empty() || word.size() > keyword_hash::maxKeywordLength) return TokenType::identifier;
+	int8_t index = keyword_hash::table[keyword_hash::hash(word, keyword_hash::seed)];
+	if (index >= 0 && keywords[index].text == word) return keywords[index].type;
+	return TokenType::identifier;
+}
+
+static_assert(classifyWord("while") == TokenType::_while && classifyWord("whilst") == TokenType::identifier);
+
 // Function that maps a word to a token (for keywords/identifiers)
 Token mapStringToToken(const std::string &input, int line) {
     Token token;
     token.line = line;
     token.value = input;
-
-    // Look up in keyword map
-    auto it = string_to_type.find(input);
-    if (it != string_to_type.end()) {
-        token.type = it->second;
-    } else {
-        token.type = TokenType::identifier;
-    }
+    token.type = classifyWord(input);
+    if (token.type == TokenType::identifier) token.symbol = intern(input);
     return token;
 }
 
-bool isOperatorChar(char c) {
-    // Add any characters that might appear in your operators.
-    static const std::string operatorChars = "+-*/%^<>=!.";
-    return operatorChars.find(c) != std::string::npos;
+// Operator characters are listed in charscan::makeClassTable
+inline bool isOperatorChar(char c) {
+    return charscan::classOf(c) & charscan::Operator;
 }
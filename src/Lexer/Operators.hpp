@@ -0,0 +1,108 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+
+// Every operator the lexer knows, resolved at lex time.
+enum class OpKind : uint8_t {
+	None,
+	Assign,											// =
+	Equal, NotEqual, Less, LessEqual, Greater, GreaterEqual,
+	Add, Sub, Mul, Div, Mod, Pow,					// + - * / % ^
+	Increment, Decrement,							// ++ --
+	Not, Dot,										// ! .
+};
+
+struct OperatorSpelling {
+	std::string_view text;
+	OpKind kind;
+};
+
+// operator spellings (the only list; matching tables below are generated from it):
+inline constexpr OperatorSpelling operatorSpellings[] = {
+	{"=", OpKind::Assign},
+	{"==", OpKind::Equal},
+	{"!=", OpKind::NotEqual},
+	{"<", OpKind::Less},
+	{"<=", OpKind::LessEqual},
+	{">", OpKind::Greater},
+	{">=", OpKind::GreaterEqual},
+	{"+", OpKind::Add},
+	{"-", OpKind::Sub},
+	{"*", OpKind::Mul},
+	{"/", OpKind::Div},
+	{"%", OpKind::Mod},
+	{"^", OpKind::Pow},
+	{"++", OpKind::Increment},
+	{"--", OpKind::Decrement},
+	{"!", OpKind::Not},
+	{".", OpKind::Dot},
+};
+
+namespace operator_table {
+	inline constexpr size_t count = std::size(operatorSpellings);
+
+	// Spellings grouped by first byte, longest first inside a group (maximal munch order)
+	constexpr std::array<OperatorSpelling, count> makeSorted() {
+		std::array<OperatorSpelling, count> sorted{};
+		for (size_t i = 0; i < count; ++i) sorted[i] = operatorSpellings[i];
+		for (size_t i = 1; i < count; ++i) {
+			for (size_t j = i; j > 0; --j) {
+				const OperatorSpelling& a = sorted[j - 1];
+				const OperatorSpelling& b = sorted[j];
+				bool before = b.text[0] < a.text[0] || (b.text[0] == a.text[0] && b.text.size() > a.text.size());
+				if (!before) break;
+				OperatorSpelling tmp = sorted[j - 1];
+				sorted[j - 1] = sorted[j];
+				sorted[j] = tmp;
+			}
+		}
+		return sorted;
+	}
+	inline constexpr std::array<OperatorSpelling, count> sorted = makeSorted();
+
+	struct Group { uint8_t first = 0, size = 0; };
+
+	constexpr std::array<Group, 256> makeGroups() {
+		std::array<Group, 256> groups{};
+		for (size_t i = count; i-- > 0;) {
+			Group& g = groups[static_cast<unsigned char>(sorted[i].text[0])];
+			g.first = static_cast<uint8_t>(i);
+			++g.size;
+		}
+		return groups;
+	}
+	inline constexpr std::array<Group, 256> groups = makeGroups();
+
+	constexpr std::array<std::string_view, 256> makeSpellings() {
+		std::array<std::string_view, 256> text{};
+		for (const OperatorSpelling& op : operatorSpellings) text[static_cast<uint8_t>(op.kind)] = op.text;
+		return text;
+	}
+	inline constexpr std::array<std::string_view, 256> spellings = makeSpellings();
+}
+
+// Longest operator at the start of text; sets length (0 and OpKind::None if there is none)
+constexpr OpKind matchOperator(std::string_view text, uint32_t& length) {
+	length = 0;
+	if (text.empty()) return OpKind::None;
+	const operator_table::Group g = operator_table::groups[static_cast<unsigned char>(text[0])];
+	for (uint8_t i = g.first; i < g.first + g.size; ++i) {
+		const OperatorSpelling& op = operator_table::sorted[i];
+		if (text.substr(0, op.text.size()) == op.text) {
+			length = static_cast<uint32_t>(op.text.size());
+			return op.kind;
+		}
+	}
+	return OpKind::None;
+}
+
+constexpr std::string_view opSpelling(OpKind op) {
+	return operator_table::spellings[static_cast<uint8_t>(op)];
+}
+
+inline std::ostream& operator<<(std::ostream& out, OpKind op) {
+	return out << opSpelling(op);
+}
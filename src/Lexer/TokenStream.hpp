@@ -0,0 +1,66 @@
+#pragma once
+
+#include "Lexer.hpp"
+#include "SpscQueue.hpp"
+
+#include <thread>
+
+// Pull-based token production for the parser. A TokenSource hands out tokens in
+// batches; TokenCursor keeps a small window of them, so token memory stays bounded
+// no matter how long the input is.
+class TokenSource {
+public:
+	virtual ~TokenSource() = default;
+
+	// Writes up to max tokens to out and returns how many; 0 means the input is exhausted
+	virtual size_t fill(CompactToken* out, size_t max) = 0;
+};
+
+// Lexes on demand, on the thread that asks for tokens
+class ScanningTokenSource : public TokenSource {
+public:
+	explicit ScanningTokenSource(std::string_view source, StringInterner& interner = globalInterner())
+		: scanner(source, interner) {}
+
+	size_t fill(CompactToken* out, size_t max) override { return scanner.fill(out, max); }
+
+private:
+	TokenScanner scanner;
+};
+
+// Lexes on a producer thread that runs ahead of the parser by at most `capacity`
+// tokens, handing them over through a lock-free single-producer/single-consumer queue.
+// The source buffer and the interner must outlive this object.
+class ThreadedTokenSource : public TokenSource {
+public:
+	static constexpr size_t defaultCapacity = 16 * 1024;
+	static constexpr size_t batchSize = 256;
+
+	explicit ThreadedTokenSource(std::string_view source, size_t capacity = defaultCapacity,
+								 StringInterner& interner = globalInterner())
+		: queue((checkCompactSourceSize(source.size()), capacity)),	// throw here, not on the producer
+		  producer([this, source, &interner] { produce(source, interner); }) {}
+
+	~ThreadedTokenSource() override {
+		queue.cancel();	// unblocks the producer if the parser stopped early (e.g. on an error)
+		producer.join();
+	}
+
+	ThreadedTokenSource(const ThreadedTokenSource&) = delete;
+	ThreadedTokenSource& operator=(const ThreadedTokenSource&) = delete;
+
+	size_t fill(CompactToken* out, size_t max) override { return queue.pop(out, max); }
+
+private:
+	SpscQueue<CompactToken> queue;
+	std::thread producer;	// declared last: starts once the queue exists
+
+	void produce(std::string_view source, StringInterner& interner) {
+		TokenScanner scanner(source, interner);
+		CompactToken batch[batchSize];
+		while (size_t n = scanner.fill(batch, batchSize)) {
+			if (!queue.push(batch, n)) break;
+		}
+		queue.close();
+	}
+};
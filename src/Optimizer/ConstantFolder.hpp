@@ -0,0 +1,262 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include "SyntaxTree.hpp"
+
+// Folds constant subexpressions and applies algebraic identities, rewriting the tree in
+// place. Run it after the TypeChecker: the identities assume their operand is a float.
+//
+//   literal op literal    -> literal, when the result is an integer a LiteralExpr can hold
+//   x + 0, 0 + x, x - 0   -> x
+//   x * 1, 1 * x, x / 1   -> x
+//   x * 0, 0 * x          -> 0, when x has no side effects
+//   x ^ 1 -> x, x ^ 0 -> 1 (x without side effects)
+//   x ^ 2..4              -> x * x ..., when x is a variable
+//   -(-x)                 -> x
+//
+// These follow real arithmetic, not IEEE: x * 0 is 0 even when x is inf or NaN, and
+// x ^ 3 rounds twice. Generated code relies on them being applied.
+//
+// Nodes are never freed (they live in the Program's arena); a folded literal reuses one
+// of its operands' nodes, so folding allocates nothing.
+class ConstantFolder {
+private:
+	Arena* arena = nullptr;
+	size_t removed = 0;
+	size_t added = 0;
+	size_t rewritten = 0;
+
+public:
+	static constexpr int maxPowerToMultiply = 4;
+
+	// Simplifies every function body; returns the number of nodes eliminated
+	size_t fold(Program& program) {
+		arena = &program.arena;
+		removed = added = rewritten = 0;
+		for (ASTNode* decl : program.Code) {
+			if (auto* function = dynamic_cast<FunctionDecl*>(decl)) statement(function->body);
+		}
+		return eliminated();
+	}
+
+	// Net node count reduction of the last fold(); strength reduction adds nodes back
+	size_t eliminated() const { return removed > added ? removed - added : 0; }
+	// Rewrites applied by the last fold()
+	size_t rewrites() const { return rewritten; }
+
+private:
+	static size_t nodeCount(const ASTNode* node) {
+		if (auto* n = dynamic_cast<const BinaryExpr*>(node)) return 1 + nodeCount(n->left) + nodeCount(n->right);
+		if (auto* n = dynamic_cast<const PrefixExpr*>(node)) return 1 + nodeCount(n->operand);
+		if (auto* n = dynamic_cast<const UnaryExpr*>(node)) return 1 + nodeCount(n->expr);
+		if (auto* n = dynamic_cast<const PostfixExpr*>(node)) return 1 + nodeCount(n->operand);
+		if (auto* n = dynamic_cast<const IndexExpr*>(node)) return 1 + nodeCount(n->target) + nodeCount(n->index);
+		if (auto* n = dynamic_cast<const FunctionCallExpr*>(node)) {
+			size_t count = 1 + nodeCount(n->callee);
+			for (const ASTNode* arg : n->arguments) count += nodeCount(arg);
+			return count;
+		}
+		return node ? 1 : 0;
+	}
+
+	// Evaluating node has no effect besides its value: no calls, stores or indexing
+	// (an index may be out of range)
+	static bool pure(const ASTNode* node) {
+		if (dynamic_cast<const LiteralExpr*>(node) || dynamic_cast<const VariableExpr*>(node)) return true;
+		if (auto* n = dynamic_cast<const BinaryExpr*>(node)) return n->op != OpKind::Assign && pure(n->left) && pure(n->right);
+		if (auto* n = dynamic_cast<const PrefixExpr*>(node)) return (n->op == OpKind::Sub || n->op == OpKind::Not) && pure(n->operand);
+		if (auto* n = dynamic_cast<const UnaryExpr*>(node)) return (n->op == OpKind::Sub || n->op == OpKind::Not) && pure(n->expr);
+		return false;
+	}
+
+	static bool isLiteral(const ASTNode* node, int value) {
+		auto* literal = dynamic_cast<const LiteralExpr*>(node);
+		return literal && literal->value == value;
+	}
+
+	// The literal node for value, when value is an integer a LiteralExpr can hold
+	static bool representable(double value) {
+		return value >= INT32_MIN && value <= INT32_MAX && value == std::trunc(value) && !(value == 0 && std::signbit(value));
+	}
+
+	static bool evaluate(OpKind op, double left, double right, double& result) {
+		switch (op) {
+			case OpKind::Add: result = left + right; break;
+			case OpKind::Sub: result = left - right; break;
+			case OpKind::Mul: result = left * right; break;
+			case OpKind::Div: if (right == 0) return false; result = left / right; break;
+			case OpKind::Mod: if (right == 0) return false; result = std::fmod(left, right); break;
+			case OpKind::Pow: result = std::pow(left, right); break;
+			case OpKind::Equal: result = left == right; break;
+			case OpKind::NotEqual: result = left != right; break;
+			case OpKind::Less: result = left < right; break;
+			case OpKind::LessEqual: result = left <= right; break;
+			case OpKind::Greater: result = left > right; break;
+			case OpKind::GreaterEqual: result = left >= right; break;
+			default: return false;
+		}
+		return representable(result);
+	}
+
+	// Replaces node with replacement, counting the nodes that drop out of the tree
+	void replace(ASTNode*& node, ASTNode* replacement) {
+		removed += nodeCount(node) - nodeCount(replacement);
+		node = replacement;
+		++rewritten;
+	}
+
+	LiteralExpr* literalFrom(ASTNode* node, int value) {
+		auto* literal = dynamic_cast<LiteralExpr*>(node);
+		if (!literal) return arena->make<LiteralExpr>(value);
+		literal->value = value;
+		return literal;
+	}
+
+	ASTNode* copyVariable(const VariableExpr* variable) {
+		auto* copy = arena->make<VariableExpr>(variable->name);
+		copy->slot = variable->slot;
+		return copy;
+	}
+
+	// Rewrites x ^ n as x * x * ... for a variable x
+	void multiplyOut(ASTNode*& node, BinaryExpr* power, int exponent) {
+		auto* variable = static_cast<VariableExpr*>(power->left);
+		ASTNode* product = variable;
+		for (int i = 1; i < exponent; ++i) product = arena->make<BinaryExpr>(OpKind::Mul, product, copyVariable(variable));
+		size_t before = nodeCount(node);
+		node = product;
+		size_t after = nodeCount(node);
+		if (after > before) added += after - before;
+		else removed += before - after;
+		++rewritten;
+	}
+
+	void binary(ASTNode*& node, BinaryExpr* n) {
+		if (n->op == OpKind::Assign) {
+			if (!dynamic_cast<VariableExpr*>(n->left)) lvalue(n->left);
+			expression(n->right);
+			return;
+		}
+		expression(n->left);
+		expression(n->right);
+
+		auto* left = dynamic_cast<LiteralExpr*>(n->left);
+		auto* right = dynamic_cast<LiteralExpr*>(n->right);
+		double result;
+		if (left && right && evaluate(n->op, left->value, right->value, result)) {
+			replace(node, literalFrom(left, static_cast<int>(result)));
+			return;
+		}
+
+		switch (n->op) {
+			case OpKind::Add:
+				if (isLiteral(n->right, 0)) replace(node, n->left);
+				else if (isLiteral(n->left, 0)) replace(node, n->right);
+				break;
+			case OpKind::Sub:
+				if (isLiteral(n->right, 0)) replace(node, n->left);
+				break;
+			case OpKind::Mul:
+				if (isLiteral(n->right, 1)) replace(node, n->left);
+				else if (isLiteral(n->left, 1)) replace(node, n->right);
+				else if (isLiteral(n->right, 0) && pure(n->left)) replace(node, n->right);
+				else if (isLiteral(n->left, 0) && pure(n->right)) replace(node, n->left);
+				break;
+			case OpKind::Div:
+				if (isLiteral(n->right, 1)) replace(node, n->left);
+				break;
+			case OpKind::Pow:
+				if (!right) break;
+				if (right->value == 1) replace(node, n->left);
+				else if (right->value == 0 && pure(n->left)) replace(node, literalFrom(right, 1));
+				else if (right->value >= 2 && right->value <= maxPowerToMultiply && dynamic_cast<VariableExpr*>(n->left)) {
+					multiplyOut(node, n, right->value);
+				}
+				break;
+			default:
+				break;
+		}
+	}
+
+	void negation(ASTNode*& node, OpKind op, ASTNode*& operand) {
+		if (op == OpKind::Increment || op == OpKind::Decrement) {
+			lvalue(operand);
+			return;
+		}
+		expression(operand);
+		if (auto* literal = dynamic_cast<LiteralExpr*>(operand)) {
+			double result = op == OpKind::Sub ? -static_cast<double>(literal->value) : literal->value == 0;
+			if (representable(result)) replace(node, literalFrom(literal, static_cast<int>(result)));
+			return;
+		}
+		if (op != OpKind::Sub) return;
+		if (auto* inner = dynamic_cast<PrefixExpr*>(operand); inner && inner->op == OpKind::Sub) replace(node, inner->operand);
+		else if (auto* inner = dynamic_cast<UnaryExpr*>(operand); inner && inner->op == OpKind::Sub) replace(node, inner->expr);
+	}
+
+	// An assignment or ++/-- target: only its subexpressions may change
+	void lvalue(ASTNode* node) {
+		if (auto* n = dynamic_cast<IndexExpr*>(node)) {
+			expression(n->target);
+			expression(n->index);
+		} else if (auto* n = dynamic_cast<ClassFieldAccessExpr*>(node)) {
+			expression(n->structInstance);
+		}
+	}
+
+	void expression(ASTNode*& node) {
+		if (!node) return;
+		if (auto* n = dynamic_cast<BinaryExpr*>(node)) {
+			binary(node, n);
+		} else if (auto* n = dynamic_cast<PrefixExpr*>(node)) {
+			negation(node, n->op, n->operand);
+		} else if (auto* n = dynamic_cast<UnaryExpr*>(node)) {
+			negation(node, n->op, n->expr);
+		} else if (auto* n = dynamic_cast<PostfixExpr*>(node)) {
+			lvalue(n->operand);
+		} else if (auto* n = dynamic_cast<IndexExpr*>(node)) {
+			expression(n->target);
+			expression(n->index);
+		} else if (auto* n = dynamic_cast<FunctionCallExpr*>(node)) {
+			for (ASTNode*& arg : n->arguments) expression(arg);
+		} else if (auto* n = dynamic_cast<ClassFieldAccessExpr*>(node)) {
+			expression(n->structInstance);
+		} else if (auto* n = dynamic_cast<ClassInstanceExpr*>(node)) {
+			for (auto& field : n->fieldValues) expression(field.second);
+		}
+	}
+
+	void statement(ASTNode*& node) {
+		if (!node) return;
+		if (auto* n = dynamic_cast<CompoundStmt*>(node)) {
+			for (ASTNode*& stmt : n->statements) statement(stmt);
+		} else if (auto* n = dynamic_cast<BlockStmt*>(node)) {
+			for (ASTNode*& stmt : n->statements) statement(stmt);
+		} else if (auto* n = dynamic_cast<ExprStmt*>(node)) {
+			expression(n->expr);
+		} else if (auto* n = dynamic_cast<DefinitionStmt*>(node)) {
+			if (auto* assign = dynamic_cast<BinaryExpr*>(n->expression); assign && assign->op == OpKind::Assign) {
+				expression(assign->right);
+			}
+		} else if (auto* n = dynamic_cast<IfStmt*>(node)) {
+			expression(n->condition);
+			statement(n->thenBranch);
+			statement(n->elseBranch);
+		} else if (auto* n = dynamic_cast<WhileStmt*>(node)) {
+			expression(n->condition);
+			statement(n->body);
+		} else if (auto* n = dynamic_cast<ForStmt*>(node)) {
+			statement(n->initializer);
+			expression(n->condition);
+			statement(n->incrementor);
+			statement(n->body);
+		} else if (auto* n = dynamic_cast<ReturnStmt*>(node)) {
+			expression(n->expression);
+		} else {
+			expression(node);
+		}
+	}
+};
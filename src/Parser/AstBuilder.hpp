@@ -0,0 +1,291 @@
+#pragma once
+
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "SyntaxTree.hpp"
+#include "FlatAst.hpp"
+
+// Node factories the parser is written against. TreeBuilder produces the class tree
+// (Program + ASTNode subclasses), FlatBuilder produces a FlatAst. Both take the same
+// calls, so one parser drives either representation.
+
+using ParamList = std::vector<std::pair<Symbol, Symbol>>;	// (name, type)
+using ParamSpan = std::span<const std::pair<Symbol, Symbol>>;
+
+class TreeBuilder {
+private:
+	std::unique_ptr<Program> program;
+	Arena* arena = nullptr;
+	size_t firstChunkSize = 64 * 1024;
+
+	template<class T, class... Args>
+	T* make(Args&&... args) { return arena->make<T>(std::forward<Args>(args)...); }
+
+public:
+	using Node = ASTNode*;
+	using Result = Program*;
+	static constexpr Node null = nullptr;
+
+	// For parses known to be small, so their Program does not hold a mostly empty chunk
+	void setFirstChunkSize(size_t bytes) { firstChunkSize = bytes; }
+
+	void begin() {
+		program.reset(new Program(firstChunkSize));
+		arena = &program->arena;
+	}
+	Result finish() { return program.release(); }
+	void addTopLevel(Node node) { program->Code.push_back(node); }
+
+	Node literal(SourceSpan, int value) { return make<LiteralExpr>(value); }
+	Node variable(SourceSpan, Symbol name) { return make<VariableExpr>(name); }
+	Node binary(SourceSpan, OpKind op, Node left, Node right) { return make<BinaryExpr>(op, left, right); }
+	Node prefix(SourceSpan, OpKind op, Node operand) { return make<PrefixExpr>(op, operand); }
+	Node postfix(SourceSpan, OpKind op, Node operand) { return make<PostfixExpr>(op, operand); }
+	Node index(SourceSpan, Node target, Node index) { return make<IndexExpr>(target, index); }
+	Node fieldAccess(SourceSpan, Node object, Symbol field) { return make<ClassFieldAccessExpr>(object, field); }
+	Node call(SourceSpan, Node callee, std::span<const Node> args) {
+		return make<FunctionCallExpr>(callee, arena->copyList(args));
+	}
+	Node compound(SourceSpan, std::span<const Node> statements) {
+		return make<CompoundStmt>(arena->copyList(statements));
+	}
+	Node ifStmt(SourceSpan, Node condition, Node thenStmt, Node elseStmt) {
+		return make<IfStmt>(condition, thenStmt, elseStmt);
+	}
+	Node whileStmt(SourceSpan, Node condition, Node body) { return make<WhileStmt>(condition, body); }
+	Node forStmt(SourceSpan, Node init, Node condition, Node increment, Node body) {
+		return make<ForStmt>(init, condition, increment, body);
+	}
+	Node returnStmt(SourceSpan, Node expression) { return make<ReturnStmt>(expression); }
+	Node definition(SourceSpan, Node expression, Symbol type) { return make<DefinitionStmt>(expression, type); }
+	Node breakStmt(SourceSpan) { return make<BreakStmt>(); }
+	Node continueStmt(SourceSpan) { return make<ContinueStmt>(); }
+	Node function(SourceSpan, Symbol name, ParamSpan params, Symbol returnType, Node body) {
+		return make<FunctionDecl>(name, arena->copyList(params), returnType, body);
+	}
+	Node classDecl(SourceSpan, Symbol name, ParamSpan fields) {
+		return make<ClassDecl>(name, arena->copyList(fields));
+	}
+};
+
+class FlatBuilder {
+private:
+	FlatAst ast;
+
+	static uint32_t opWord(OpKind op) { return static_cast<uint32_t>(op); }
+
+public:
+	using Node = NodeId;
+	using Result = FlatAst;
+	static constexpr Node null = NoNode;
+
+	void begin() { ast = FlatAst(); }
+	Result finish() { return std::move(ast); }
+	void addTopLevel(Node node) { ast.roots.push_back(node); }
+
+	Node literal(SourceSpan s, int value) { return ast.add(NodeKind::Literal, s, {static_cast<uint32_t>(value)}); }
+	Node variable(SourceSpan s, Symbol name) { return ast.add(NodeKind::Variable, s, {name.id}); }
+	Node binary(SourceSpan s, OpKind op, Node left, Node right) {
+		return ast.add(NodeKind::Binary, s, {left, right, opWord(op)});
+	}
+	Node prefix(SourceSpan s, OpKind op, Node operand) {
+		return ast.add(NodeKind::Prefix, s, {operand, 0, opWord(op)});
+	}
+	Node postfix(SourceSpan s, OpKind op, Node operand) {
+		return ast.add(NodeKind::Postfix, s, {operand, 0, opWord(op)});
+	}
+	Node index(SourceSpan s, Node target, Node index) { return ast.add(NodeKind::Index, s, {target, index}); }
+	Node fieldAccess(SourceSpan s, Node object, Symbol field) {
+		return ast.add(NodeKind::FieldAccess, s, {object, field.id});
+	}
+	Node call(SourceSpan s, Node callee, std::span<const Node> args) {
+		return ast.add(NodeKind::Call, s, {callee, ast.addExtra(args), static_cast<uint32_t>(args.size())});
+	}
+	Node compound(SourceSpan s, std::span<const Node> statements) {
+		return ast.add(NodeKind::Compound, s, {ast.addExtra(statements), static_cast<uint32_t>(statements.size())});
+	}
+	Node ifStmt(SourceSpan s, Node condition, Node thenStmt, Node elseStmt) {
+		return ast.add(NodeKind::If, s, {condition, thenStmt, elseStmt});
+	}
+	Node whileStmt(SourceSpan s, Node condition, Node body) { return ast.add(NodeKind::While, s, {condition, body}); }
+	Node forStmt(SourceSpan s, Node init, Node condition, Node increment, Node body) {
+		const uint32_t parts[] = {init, condition, increment, body};
+		return ast.add(NodeKind::For, s, {ast.addExtra(parts)});
+	}
+	Node returnStmt(SourceSpan s, Node expression) { return ast.add(NodeKind::Return, s, {expression}); }
+	Node definition(SourceSpan s, Node expression, Symbol type) {
+		return ast.add(NodeKind::Definition, s, {expression, type.id});
+	}
+	Node breakStmt(SourceSpan s) { return ast.add(NodeKind::Break, s, {}); }
+	Node continueStmt(SourceSpan s) { return ast.add(NodeKind::Continue, s, {}); }
+	Node function(SourceSpan s, Symbol name, ParamSpan params, Symbol returnType, Node body) {
+		uint32_t start = static_cast<uint32_t>(ast.extra.size());
+		ast.extra.push_back(body);
+		ast.extra.push_back(static_cast<uint32_t>(params.size()));
+		for (auto& [paramName, paramType] : params) {
+			ast.extra.push_back(paramName.id);
+			ast.extra.push_back(paramType.id);
+		}
+		return ast.add(NodeKind::Function, s, {name.id, returnType.id, start});
+	}
+	Node classDecl(SourceSpan s, Symbol name, ParamSpan fields) {
+		uint32_t start = static_cast<uint32_t>(ast.extra.size());
+		for (auto& [fieldName, fieldType] : fields) {
+			ast.extra.push_back(fieldName.id);
+			ast.extra.push_back(fieldType.id);
+		}
+		return ast.add(NodeKind::Class, s, {name.id, start, static_cast<uint32_t>(fields.size())});
+	}
+};
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------------------
+// Conversions between the two representations: replay one into any builder. Flat input is
+// anything with FlatAst's accessors (FlatAst itself, AstImage); symbol words go through
+// its symbol().
+
+template<class Builder, class Flat>
+typename Builder::Node replayFlatNode(const Flat& ast, NodeId id, Builder& b) {
+	if (id == NoNode) return Builder::null;
+	auto sub = [&](uint32_t child) { return replayFlatNode(ast, child, b); };
+	auto opKind = [](uint32_t op) { return static_cast<OpKind>(op); };
+	const NodeData& d = ast[id];
+	const SourceSpan s = ast.span(id);
+
+	switch (ast.kind(id)) {
+		case NodeKind::Literal: return b.literal(s, static_cast<int>(d.a));
+		case NodeKind::Variable: return b.variable(s, ast.symbol(d.a));
+		case NodeKind::Binary: {
+			auto left = sub(d.a);
+			return b.binary(s, opKind(d.c), left, sub(d.b));
+		}
+		case NodeKind::Prefix: return b.prefix(s, opKind(d.c), sub(d.a));
+		case NodeKind::Postfix: return b.postfix(s, opKind(d.c), sub(d.a));
+		case NodeKind::Index: {
+			auto target = sub(d.a);
+			return b.index(s, target, sub(d.b));
+		}
+		case NodeKind::FieldAccess: return b.fieldAccess(s, sub(d.a), ast.symbol(d.b));
+		case NodeKind::Call: {
+			auto callee = sub(d.a);
+			std::vector<typename Builder::Node> args;
+			for (uint32_t arg : ast.list(d.b, d.c)) args.push_back(sub(arg));
+			return b.call(s, callee, args);
+		}
+		case NodeKind::Compound: {
+			std::vector<typename Builder::Node> statements;
+			for (uint32_t stmt : ast.list(d.a, d.b)) statements.push_back(sub(stmt));
+			return b.compound(s, statements);
+		}
+		case NodeKind::If: {
+			auto condition = sub(d.a);
+			auto thenStmt = sub(d.b);
+			return b.ifStmt(s, condition, thenStmt, sub(d.c));
+		}
+		case NodeKind::While: {
+			auto condition = sub(d.a);
+			return b.whileStmt(s, condition, sub(d.b));
+		}
+		case NodeKind::For: {
+			auto parts = ast.list(d.a, 4);
+			auto init = sub(parts[0]);
+			auto condition = sub(parts[1]);
+			auto increment = sub(parts[2]);
+			return b.forStmt(s, init, condition, increment, sub(parts[3]));
+		}
+		case NodeKind::Return: return b.returnStmt(s, sub(d.a));
+		case NodeKind::Definition: return b.definition(s, sub(d.a), ast.symbol(d.b));
+		case NodeKind::Break: return b.breakStmt(s);
+		case NodeKind::Continue: return b.continueStmt(s);
+		case NodeKind::Function: {
+			auto header = ast.list(d.c, 2);	// body, parameter count
+			auto words = ast.list(d.c + 2, header[1] * 2);
+			ParamList params;
+			for (uint32_t i = 0; i < header[1]; ++i) params.push_back({ast.symbol(words[2 * i]), ast.symbol(words[2 * i + 1])});
+			return b.function(s, ast.symbol(d.a), params, ast.symbol(d.b), sub(header[0]));
+		}
+		case NodeKind::Class: {
+			auto words = ast.list(d.b, d.c * 2);
+			ParamList fields;
+			for (uint32_t i = 0; i < d.c; ++i) fields.push_back({ast.symbol(words[2 * i]), ast.symbol(words[2 * i + 1])});
+			return b.classDecl(s, ast.symbol(d.a), fields);
+		}
+	}
+	throw std::runtime_error("Corrupt flat AST node.");
+}
+
+template<class Builder>
+typename Builder::Node replayTreeNode(const ASTNode* node, Builder& b) {
+	if (!node) return Builder::null;
+	auto sub = [&](const ASTNode* child) { return replayTreeNode(child, b); };
+	const SourceSpan s;
+
+	if (auto* n = dynamic_cast<const LiteralExpr*>(node)) return b.literal(s, n->value);
+	if (auto* n = dynamic_cast<const VariableExpr*>(node)) return b.variable(s, n->name);
+	if (auto* n = dynamic_cast<const BinaryExpr*>(node)) {
+		auto left = sub(n->left);
+		return b.binary(s, n->op, left, sub(n->right));
+	}
+	if (auto* n = dynamic_cast<const PrefixExpr*>(node)) return b.prefix(s, n->op, sub(n->operand));
+	if (auto* n = dynamic_cast<const PostfixExpr*>(node)) return b.postfix(s, n->op, sub(n->operand));
+	if (auto* n = dynamic_cast<const IndexExpr*>(node)) {
+		auto target = sub(n->target);
+		return b.index(s, target, sub(n->index));
+	}
+	if (auto* n = dynamic_cast<const ClassFieldAccessExpr*>(node)) return b.fieldAccess(s, sub(n->structInstance), n->fieldName);
+	if (auto* n = dynamic_cast<const FunctionCallExpr*>(node)) {
+		auto callee = sub(n->callee);
+		std::vector<typename Builder::Node> args;
+		for (ASTNode* arg : n->arguments) args.push_back(sub(arg));
+		return b.call(s, callee, args);
+	}
+	if (auto* n = dynamic_cast<const CompoundStmt*>(node)) {
+		std::vector<typename Builder::Node> statements;
+		for (ASTNode* stmt : n->statements) statements.push_back(sub(stmt));
+		return b.compound(s, statements);
+	}
+	if (auto* n = dynamic_cast<const IfStmt*>(node)) {
+		auto condition = sub(n->condition);
+		auto thenStmt = sub(n->thenBranch);
+		return b.ifStmt(s, condition, thenStmt, sub(n->elseBranch));
+	}
+	if (auto* n = dynamic_cast<const WhileStmt*>(node)) {
+		auto condition = sub(n->condition);
+		return b.whileStmt(s, condition, sub(n->body));
+	}
+	if (auto* n = dynamic_cast<const ForStmt*>(node)) {
+		auto init = sub(n->initializer);
+		auto condition = sub(n->condition);
+		auto increment = sub(n->incrementor);
+		return b.forStmt(s, init, condition, increment, sub(n->body));
+	}
+	if (auto* n = dynamic_cast<const ReturnStmt*>(node)) return b.returnStmt(s, sub(n->expression));
+	if (auto* n = dynamic_cast<const DefinitionStmt*>(node)) return b.definition(s, sub(n->expression), n->dataType);
+	if (dynamic_cast<const BreakStmt*>(node)) return b.breakStmt(s);
+	if (dynamic_cast<const ContinueStmt*>(node)) return b.continueStmt(s);
+	if (auto* n = dynamic_cast<const FunctionDecl*>(node)) {
+		ParamList params(n->params.begin(), n->params.end());
+		return b.function(s, n->name, params, n->returnType, sub(n->body));
+	}
+	if (auto* n = dynamic_cast<const ClassDecl*>(node)) {
+		return b.classDecl(s, n->name, n->fields);
+	}
+	throw std::runtime_error("AST node has no flat representation.");
+}
+
+inline FlatAst toFlatAst(const Program& program) {
+	FlatBuilder builder;
+	builder.begin();
+	for (const ASTNode* decl : program.Code) builder.addTopLevel(replayTreeNode(decl, builder));
+	return builder.finish();
+}
+
+inline Program* toTree(const FlatAst& ast) {
+	TreeBuilder builder;
+	builder.begin();
+	for (NodeId root : ast.roots) builder.addTopLevel(replayFlatNode(ast, root, builder));
+	return builder.finish();
+}
@@ -0,0 +1,326 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "AstBuilder.hpp"
+#include "FManager.hpp"
+#include "XXHash.hpp"
+
+// FlatAst on disk, laid out so a mapped file is used in place. After a fixed header come
+// the FlatAst columns exactly as they sit in memory (kinds, spans, data, extra, roots),
+// then a string table. Every section starts on an 8-byte boundary.
+//
+// Symbols are process-local ids, so the writer replaces each symbol word with an index
+// into the image's string table (0 stays "no symbol"); symbol() turns it back into a
+// Symbol of the global interner, interning each distinct string once on first use.
+// Everything else is a view of the file: loading checks the header and that the sections
+// fit, which takes the same time for any size. verify() is the full O(n) check of the
+// checksum, of every child reference (children precede their parent, so there are no cycles)
+// and of operators, for files that did not come from this process.
+//
+// The version changes whenever NodeKind, OpKind or the layout does; images of another
+// version or byte order are rejected rather than converted.
+class AstImage {
+public:
+	static constexpr char magic[4] = {'C', 'A', 'S', 'T'};
+	static constexpr uint16_t formatVersion = 1;
+	static constexpr uint16_t byteOrderMark = 0x0102;	// reads as 0x0201 on the other endianness
+
+	struct Header {
+		char magic[4];
+		uint16_t version;
+		uint16_t byteOrder;
+		uint32_t nodeCount;
+		uint32_t extraCount;
+		uint32_t rootCount;
+		uint32_t stringCount;		// not counting the empty string at index 0
+		uint64_t stringBytes;
+		uint64_t kinds, spans, data, extra, roots, stringOffsets, strings;	// section offsets
+		uint64_t fileSize;
+		uint64_t checksum;			// XXH64 of everything after the header
+	};
+
+private:
+	MappedFile file;				// owner when loaded from disk
+	std::unique_ptr<uint64_t[]> copy;	// owner when the caller's bytes were misaligned
+	std::string_view bytes;
+	Header header{};
+
+	const NodeKind* kinds = nullptr;
+	const SourceSpan* spans = nullptr;
+	const NodeData* data = nullptr;
+	const uint32_t* extraWords = nullptr;
+	const NodeId* rootIds = nullptr;
+	const uint32_t* stringOffsets = nullptr;
+	const char* strings = nullptr;
+	mutable std::vector<Symbol> symbols;	// string index -> Symbol, 0 = not interned yet
+
+	static size_t align(size_t n) { return (n + 7) & ~size_t(7); }
+
+	template<class T>
+	const T* section(uint64_t offset) const { return reinterpret_cast<const T*>(bytes.data() + offset); }
+
+	void open(std::string_view image) {
+		bytes = image;
+		if (reinterpret_cast<uintptr_t>(image.data()) % 8 != 0) {
+			copy = std::make_unique<uint64_t[]>(image.size() / 8 + 1);
+			std::memcpy(copy.get(), image.data(), image.size());
+			bytes = std::string_view(reinterpret_cast<const char*>(copy.get()), image.size());
+		}
+		if (bytes.size() < sizeof(Header)) throw std::runtime_error("AST image is truncated.");
+		std::memcpy(&header, bytes.data(), sizeof header);
+		if (std::memcmp(header.magic, magic, sizeof magic) != 0) throw std::runtime_error("Not an AST image.");
+		if (header.byteOrder != byteOrderMark) throw std::runtime_error("AST image has the wrong byte order.");
+		if (header.version != formatVersion) throw std::runtime_error("AST image has an unsupported version.");
+		if (header.fileSize != bytes.size()) throw std::runtime_error("AST image is truncated.");
+
+		auto fits = [&](uint64_t offset, uint64_t length) {
+			return offset % 8 == 0 && offset >= sizeof(Header) && offset <= bytes.size() && length <= bytes.size() - offset;
+		};
+		const uint64_t nodes = header.nodeCount;
+		if (!fits(header.kinds, nodes * sizeof(NodeKind)) || !fits(header.spans, nodes * sizeof(SourceSpan))
+			|| !fits(header.data, nodes * sizeof(NodeData)) || !fits(header.extra, uint64_t(header.extraCount) * 4)
+			|| !fits(header.roots, uint64_t(header.rootCount) * 4)
+			|| !fits(header.stringOffsets, (uint64_t(header.stringCount) + 2) * 4)
+			|| !fits(header.strings, header.stringBytes)) {
+			throw std::runtime_error("AST image section out of bounds.");
+		}
+
+		kinds = section<NodeKind>(header.kinds);
+		spans = section<SourceSpan>(header.spans);
+		data = section<NodeData>(header.data);
+		extraWords = section<uint32_t>(header.extra);
+		rootIds = section<NodeId>(header.roots);
+		stringOffsets = section<uint32_t>(header.stringOffsets);
+		strings = section<char>(header.strings);
+		symbols.assign(header.stringCount + 1, Symbol{});
+	}
+
+	// Words of a node that hold symbols, through f(word&); the same list for the writer's
+	// rewrite and verify()'s range check
+	template<class Words, class F>
+	static void forEachSymbolWord(NodeKind kind, NodeData& d, Words& extra, F&& f) {
+		switch (kind) {
+			case NodeKind::Variable: f(d.a); break;
+			case NodeKind::FieldAccess:
+			case NodeKind::Definition: f(d.b); break;
+			case NodeKind::Function:
+				f(d.a);
+				f(d.b);
+				for (uint32_t i = 0; i < 2 * extra[d.c + 1]; ++i) f(extra[d.c + 2 + i]);
+				break;
+			case NodeKind::Class:
+				f(d.a);
+				for (uint32_t i = 0; i < 2 * d.c; ++i) f(extra[d.b + i]);
+				break;
+			default: break;
+		}
+	}
+
+public:
+	// Views bytes that outlive the image (copied only if they are not 8-byte aligned)
+	explicit AstImage(std::string_view image) { open(image); }
+
+	// Takes ownership of a mapped file; mappings are page aligned, so this never copies
+	explicit AstImage(MappedFile mapped) : file(std::move(mapped)) {
+		if (!file.isOpen()) throw std::runtime_error("AST image file could not be opened.");
+		open(file.view());
+	}
+
+	static AstImage load(const FManager& files, const std::string& filename) { return AstImage(files.mapFile(filename)); }
+
+	AstImage(AstImage&&) noexcept = default;
+	AstImage& operator=(AstImage&&) noexcept = default;
+
+	static std::string write(const FlatAst& ast) {
+		// Symbol ids -> string table indices, in order of first appearance
+		std::unordered_map<uint32_t, uint32_t> index;
+		std::vector<std::string_view> texts;
+		std::vector<NodeData> nodes = ast.data;
+		std::vector<uint32_t> extra = ast.extra;
+		for (size_t i = 0; i < ast.size(); ++i) {
+			forEachSymbolWord(ast.kinds[i], nodes[i], extra, [&](uint32_t& word) {
+				if (word == 0) return;
+				auto [it, added] = index.try_emplace(word, static_cast<uint32_t>(texts.size() + 1));
+				if (added) texts.push_back(globalInterner().text(Symbol{word}));
+				word = it->second;
+			});
+		}
+
+		Header h{};
+		std::memcpy(h.magic, magic, sizeof magic);
+		h.version = formatVersion;
+		h.byteOrder = byteOrderMark;
+		h.nodeCount = static_cast<uint32_t>(ast.size());
+		h.extraCount = static_cast<uint32_t>(extra.size());
+		h.rootCount = static_cast<uint32_t>(ast.roots.size());
+		h.stringCount = static_cast<uint32_t>(texts.size());
+		for (std::string_view text : texts) h.stringBytes += text.size();
+		if (h.stringBytes > UINT32_MAX) throw std::runtime_error("AST image string table too large.");
+
+		size_t offset = sizeof(Header);
+		auto place = [&](uint64_t& field, size_t length) {
+			field = offset;
+			offset = align(offset + length);
+		};
+		place(h.kinds, ast.size() * sizeof(NodeKind));
+		place(h.spans, ast.size() * sizeof(SourceSpan));
+		place(h.data, ast.size() * sizeof(NodeData));
+		place(h.extra, extra.size() * sizeof(uint32_t));
+		place(h.roots, ast.roots.size() * sizeof(NodeId));
+		place(h.stringOffsets, (texts.size() + 2) * sizeof(uint32_t));
+		place(h.strings, h.stringBytes);
+		h.fileSize = offset;
+
+		std::string out(offset, '\0');
+		auto put = [&](uint64_t at, const void* source, size_t length) {
+			if (length) std::memcpy(out.data() + at, source, length);
+		};
+		put(h.kinds, ast.kinds.data(), ast.size() * sizeof(NodeKind));
+		put(h.spans, ast.spans.data(), ast.size() * sizeof(SourceSpan));
+		put(h.data, nodes.data(), nodes.size() * sizeof(NodeData));
+		put(h.extra, extra.data(), extra.size() * sizeof(uint32_t));
+		put(h.roots, ast.roots.data(), ast.roots.size() * sizeof(NodeId));
+		// offsets[i]..offsets[i + 1] is string i; index 0 is the empty string
+		std::vector<uint32_t> offsets(texts.size() + 2, 0);
+		for (size_t i = 0; i < texts.size(); ++i) offsets[i + 2] = static_cast<uint32_t>(offsets[i + 1] + texts[i].size());
+		put(h.stringOffsets, offsets.data(), offsets.size() * sizeof(uint32_t));
+		size_t at = h.strings;
+		for (std::string_view text : texts) {
+			put(at, text.data(), text.size());
+			at += text.size();
+		}
+
+		h.checksum = xxh64(std::string_view(out).substr(sizeof(Header)));
+		std::memcpy(out.data(), &h, sizeof h);
+		return out;
+	}
+
+	static bool save(const FlatAst& ast, const FManager& files, const std::string& filename) {
+		return files.writeFile(filename, write(ast));
+	}
+
+	// Same accessors as FlatAst, so replayFlatNode reads either
+	NodeKind kind(NodeId id) const { return kinds[id]; }
+	const SourceSpan& span(NodeId id) const { return spans[id]; }
+	const NodeData& operator[](NodeId id) const { return data[id]; }
+	std::span<const uint32_t> list(uint32_t start, uint32_t count) const { return {extraWords + start, count}; }
+	std::span<const NodeId> roots() const { return {rootIds, header.rootCount}; }
+	size_t size() const { return header.nodeCount; }
+	size_t extraSize() const { return header.extraCount; }
+	size_t fileBytes() const { return bytes.size(); }
+	size_t stringCount() const { return header.stringCount; }
+
+	std::string_view text(uint32_t word) const {
+		return {strings + stringOffsets[word], stringOffsets[word + 1] - stringOffsets[word]};
+	}
+
+	// Not thread-safe on first use of a string: symbol() fills a cache
+	Symbol symbol(uint32_t word) const {
+		Symbol& cached = symbols[word];
+		if (word != 0 && !cached) cached = intern(text(word));
+		return cached;
+	}
+
+	// Full check: checksum, node kinds, string table, and that every child, extra range and
+	// symbol word is in bounds. Throws on the first problem.
+	void verify() const {
+		auto fail = [](const char* what) { throw std::runtime_error(std::string("Corrupt AST image: ") + what + "."); };
+		if (xxh64(bytes.substr(sizeof(Header))) != header.checksum) fail("checksum mismatch");
+
+		const uint32_t count = header.stringCount;
+		for (uint32_t i = 0; i <= count; ++i) {
+			if (stringOffsets[i] > stringOffsets[i + 1]) fail("string table out of order");
+		}
+		if (stringOffsets[0] != 0 || stringOffsets[1] != 0 || stringOffsets[count + 1] != header.stringBytes) {
+			fail("string table out of bounds");
+		}
+
+		// FlatBuilder adds children before their parent, so a child id below the parent's
+		// rules out cycles, which would otherwise send replayFlatNode into endless recursion
+		const uint32_t nodes = header.nodeCount;
+		const uint64_t extraCount = header.extraCount;
+		uint32_t id = 0;
+		auto node = [&](uint32_t child, bool optional) {
+			if (optional && child == NoNode) return;
+			if (child >= id) fail(child < nodes ? "child does not precede its parent" : "child out of range");
+		};
+		auto op = [&](uint32_t word) {
+			if (word == static_cast<uint32_t>(OpKind::None) || word > static_cast<uint32_t>(OpKind::Dot)) fail("unknown operator");
+		};
+		auto range = [&](uint64_t start, uint64_t count) {
+			if (start + count > extraCount) fail("extra range out of bounds");
+		};
+		for (NodeId root : roots()) {
+			if (root >= nodes) fail("root out of range");
+		}
+		for (; id < nodes; ++id) {
+			const NodeData& d = data[id];
+			switch (kinds[id]) {
+				case NodeKind::Literal: case NodeKind::Break: case NodeKind::Continue: break;
+				case NodeKind::Variable: break;
+				case NodeKind::Binary: node(d.a, false); node(d.b, false); op(d.c); break;
+				case NodeKind::Index: case NodeKind::While: node(d.a, false); node(d.b, false); break;
+				case NodeKind::Prefix: case NodeKind::Postfix: node(d.a, false); op(d.c); break;
+				case NodeKind::FieldAccess: case NodeKind::Definition: node(d.a, false); break;
+				case NodeKind::Call:
+					node(d.a, false);
+					range(d.b, d.c);
+					for (uint32_t arg : list(d.b, d.c)) node(arg, false);
+					break;
+				case NodeKind::Compound:
+					range(d.a, d.b);
+					for (uint32_t stmt : list(d.a, d.b)) node(stmt, false);
+					break;
+				case NodeKind::If: node(d.a, false); node(d.b, false); node(d.c, true); break;
+				case NodeKind::For:
+					range(d.a, 4);
+					for (uint32_t part : list(d.a, 4)) node(part, true);
+					break;
+				case NodeKind::Return: node(d.a, true); break;
+				case NodeKind::Function:
+					range(d.c, 2);
+					range(d.c + 2, uint64_t(extraWords[d.c + 1]) * 2);
+					node(extraWords[d.c], true);
+					break;
+				case NodeKind::Class: range(d.b, uint64_t(d.c) * 2); break;
+				default: fail("unknown node kind");
+			}
+			NodeData words = d;
+			std::span<const uint32_t> extra(extraWords, header.extraCount);
+			forEachSymbolWord(kinds[id], words, extra, [&](uint32_t word) {
+				if (word > count) fail("symbol out of range");
+			});
+		}
+	}
+
+	// Copies the image into an in-memory FlatAst with this process's symbol ids; node ids
+	// and spans are unchanged
+	FlatAst toFlatAst() const {
+		FlatAst ast;
+		ast.kinds.assign(kinds, kinds + size());
+		ast.spans.assign(spans, spans + size());
+		ast.data.assign(data, data + size());
+		ast.extra.assign(extraWords, extraWords + extraSize());
+		ast.roots.assign(rootIds, rootIds + header.rootCount);
+		for (size_t i = 0; i < ast.size(); ++i) {
+			forEachSymbolWord(ast.kinds[i], ast.data[i], ast.extra, [&](uint32_t& word) { word = symbol(word).id; });
+		}
+		return ast;
+	}
+};
+
+inline Program* toTree(const AstImage& image) {
+	TreeBuilder builder;
+	builder.begin();
+	for (NodeId root : image.roots()) builder.addTopLevel(replayFlatNode(image, root, builder));
+	return builder.finish();
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "StringInterner.hpp"
+
+// Compact AST: nodes are rows in parallel arrays addressed by a 32-bit NodeId.
+// Every node has a kind, a token span and three 32-bit data words; variable-length
+// children (statement lists, call arguments, parameters, fields) live in `extra`.
+//
+//   kind        a                 b                 c
+//   Literal     int value (bits)
+//   Variable    name symbol
+//   Binary      lhs               rhs               operator
+//   Prefix      operand                             operator
+//   Postfix     operand                             operator
+//   Index       target            index
+//   FieldAccess object            field symbol
+//   Call        callee            extra start       argument count
+//   Compound    extra start       statement count
+//   If          condition         then              else (or NoNode)
+//   While       condition         body
+//   For         extra start -> [initializer, condition, incrementor, body]
+//   Return      expression (or NoNode)
+//   Definition  expression        type symbol
+//   Break / Continue
+//   Function    name symbol       return type       extra start -> [body, paramCount, (name, type)...]
+//   Class       name symbol       extra start       field count -> [(name, type)...]
+//
+// Operators are stored as their OpKind.
+
+using NodeId = uint32_t;
+inline constexpr NodeId NoNode = UINT32_MAX;
+
+enum class NodeKind : uint8_t {
+	Literal, Variable, Binary, Prefix, Postfix, Index, FieldAccess, Call,
+	Compound, If, While, For, Return, Definition, Break, Continue,
+	Function, Class
+};
+
+// Half-open range of token indices the node was parsed from
+struct SourceSpan {
+	uint32_t firstToken = 0;
+	uint32_t endToken = 0;
+};
+
+struct NodeData {
+	uint32_t a = 0, b = 0, c = 0;
+};
+
+class FlatAst {
+public:
+	std::vector<NodeKind> kinds;
+	std::vector<SourceSpan> spans;
+	std::vector<NodeData> data;
+	std::vector<uint32_t> extra;
+	std::vector<NodeId> roots;	// top-level declarations in source order
+
+	NodeId add(NodeKind kind, SourceSpan span, NodeData fields) {
+		kinds.push_back(kind);
+		spans.push_back(span);
+		data.push_back(fields);
+		return static_cast<NodeId>(kinds.size() - 1);
+	}
+
+	// Appends a run of words to `extra` and returns where it starts
+	uint32_t addExtra(std::span<const uint32_t> words) {
+		uint32_t start = static_cast<uint32_t>(extra.size());
+		extra.insert(extra.end(), words.begin(), words.end());
+		return start;
+	}
+
+	NodeKind kind(NodeId id) const { return kinds[id]; }
+	const SourceSpan& span(NodeId id) const { return spans[id]; }
+	const NodeData& operator[](NodeId id) const { return data[id]; }
+	std::span<const uint32_t> list(uint32_t start, uint32_t count) const { return {extra.data() + start, count}; }
+	Symbol symbol(uint32_t word) const { return Symbol{word}; }
+
+	size_t size() const { return kinds.size(); }
+
+	size_t memoryBytes() const {
+		return kinds.capacity() * sizeof(NodeKind) + spans.capacity() * sizeof(SourceSpan)
+			+ data.capacity() * sizeof(NodeData) + extra.capacity() * sizeof(uint32_t)
+			+ roots.capacity() * sizeof(NodeId);
+	}
+
+	// Calls f(childId) for every child node, in source order
+	template<class F>
+	void forEachChild(NodeId id, F&& f) const {
+		const NodeData& d = data[id];
+		switch (kinds[id]) {
+			case NodeKind::Binary: f(d.a); f(d.b); break;
+			case NodeKind::Prefix:
+			case NodeKind::Postfix:
+			case NodeKind::FieldAccess: f(d.a); break;
+			case NodeKind::Index: f(d.a); f(d.b); break;
+			case NodeKind::Call:
+				f(d.a);
+				for (uint32_t arg : list(d.b, d.c)) f(arg);
+				break;
+			case NodeKind::Compound:
+				for (uint32_t stmt : list(d.a, d.b)) f(stmt);
+				break;
+			case NodeKind::If:
+				f(d.a); f(d.b);
+				if (d.c != NoNode) f(d.c);
+				break;
+			case NodeKind::While: f(d.a); f(d.b); break;
+			case NodeKind::For:
+				for (uint32_t part : list(d.a, 4)) f(part);
+				break;
+			case NodeKind::Return:
+				if (d.a != NoNode) f(d.a);
+				break;
+			case NodeKind::Definition: f(d.a); break;
+			case NodeKind::Function: f(extra[d.c]); break;
+			default: break;
+		}
+	}
+};
@@ -0,0 +1,413 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "ParallelParse.hpp"
+
+// A source file kept lexed and parsed across edits. The file is held as a run of regions,
+// one per top-level declaration, each with its own text, tokens and subtree; offsets and
+// lines inside a region are relative to its start, so an edit only moves the start of the
+// regions after it.
+//
+// An edit re-lexes the whole lines it touches (no token spans a newline, so nothing else
+// can change) and re-parses the declarations those lines belong to, after scanTopLevel
+// has found where they now begin and end. If the edit unbalances a brace the window grows
+// over the following declarations until it closes again. Every other region keeps its
+// tokens and subtree. When the edit adds, removes or renames a class, later declarations
+// that mention the name are parsed again too, because the parser reads `Name x;` as a
+// definition only if Name is a class declared earlier.
+//
+// Anything the split cannot handle, including a syntax error, falls back to parsing the
+// whole file with the sequential Parser; errors are then exactly the ones it reports.
+// After a failed parse program() is empty and error() says why.
+class IncrementalParser {
+public:
+	struct EditStats {
+		size_t relexedBytes = 0;		// bytes of the lines lexed again
+		size_t relexedTokens = 0;
+		size_t reusedTokens = 0;		// tokens kept from before the edit
+		size_t reparsedDeclarations = 0;
+		size_t reusedDeclarations = 0;	// declarations whose subtree was kept
+		bool fullRebuild = false;		// fell back to parsing the whole file
+	};
+
+	explicit IncrementalParser(std::string_view source) {
+		Window whole;
+		whole.text = source;
+		whole.tokens = Lexer().tokenizeBuffer(source);
+		bytes = source.size();
+		EditStats stats;
+		rebuild(whole, 0, 0, stats);
+	}
+
+	IncrementalParser(const IncrementalParser&) = delete;
+	IncrementalParser& operator=(const IncrementalParser&) = delete;
+
+	// Replaces `length` bytes at `offset` with `replacement`. Throws std::runtime_error if
+	// the range is outside the file; syntax errors are reported through ok() and error().
+	EditStats edit(size_t offset, size_t length, std::string_view replacement) {
+		if (offset > bytes || length > bytes - offset) throw std::runtime_error("Edit range is outside the file.");
+		checkCompactSourceSize(bytes - length + replacement.size());	// tokens() gives whole-file offsets
+		EditStats stats;
+
+		// Whole lines around the edit, and the regions they fall in
+		size_t first = regionAt(offset);
+		size_t last = regionAt(offset + length);
+		const size_t lineBegin = lineStart(first, offset);
+		const size_t lineEnd = lineFinish(last, offset + length);
+
+		Window window;
+		window.first = window.last = first;
+		window.offset = regions[first].offset;
+		window.line = regions[first].line;
+		while (window.last <= last) append(window, 0);
+
+		const size_t at = offset - window.offset;
+		const int64_t byteShift = static_cast<int64_t>(replacement.size()) - static_cast<int64_t>(length);
+		const int64_t lineShift = std::count(replacement.begin(), replacement.end(), '\n')
+			- std::count(window.text.begin() + at, window.text.begin() + at + length, '\n');
+		window.text.replace(at, length, replacement);
+		bytes += byteShift;
+
+		// Tokens before the edited lines stay; tokens after them only move
+		const size_t lexBegin = lineBegin - window.offset;
+		const size_t oldLexEnd = lineEnd - window.offset;
+		const size_t lexEnd = oldLexEnd + byteShift;
+		std::vector<CompactToken> tokens;
+		tokens.reserve(window.tokens.size() + 16);
+		size_t before = 0;
+		while (before < window.tokens.size() && window.tokens[before].offset < lexBegin) tokens.push_back(window.tokens[before++]);
+
+		uint32_t line = before ? tokens.back().line : window.line;
+		size_t from = before ? tokens.back().offset + tokens.back().length : 0;
+		line += static_cast<uint32_t>(std::count(window.text.begin() + from, window.text.begin() + lexBegin, '\n'));
+		TokenScanner scanner(std::string_view(window.text).substr(lexBegin, lexEnd - lexBegin));
+		for (CompactToken token; scanner.next(token);) {
+			token.offset += static_cast<uint32_t>(lexBegin);
+			token.line += line - 1;
+			tokens.push_back(token);
+			++stats.relexedTokens;
+		}
+		stats.relexedBytes = lexEnd - lexBegin;
+
+		for (size_t i = before; i < window.tokens.size(); ++i) {
+			CompactToken token = window.tokens[i];
+			if (token.offset < oldLexEnd) continue;
+			token.offset = static_cast<uint32_t>(token.offset + byteShift);
+			token.line = static_cast<uint32_t>(token.line + lineShift);
+			tokens.push_back(token);
+		}
+		window.tokens = std::move(tokens);
+
+		reparse(window, byteShift, lineShift, stats);
+		stats.reusedTokens = tokenCount() - stats.relexedTokens;
+		stats.reusedDeclarations = declarationCount() - std::min(declarationCount(), stats.reparsedDeclarations);
+		return stats;
+	}
+
+	bool ok() const { return failure.empty(); }
+	const std::string& error() const { return failure; }
+
+	// Every top-level declaration in order. Nodes are owned by the parser and stay valid
+	// until an edit re-parses their declaration.
+	Program& program() { return merged; }
+	const Program& program() const { return merged; }
+
+	size_t size() const { return bytes; }
+	size_t declarationCount() const { return merged.Code.size(); }
+
+	size_t tokenCount() const {
+		size_t count = 0;
+		for (const Region& region : regions) count += region.tokens.size();
+		return count;
+	}
+
+	std::string text() const {
+		std::string out;
+		out.reserve(bytes);
+		for (const Region& region : regions) out += region.text;
+		return out;
+	}
+
+	// Tokens of the whole file with file offsets and lines, as Lexer::tokenizeBuffer(text())
+	std::vector<CompactToken> tokens() const {
+		std::vector<CompactToken> out;
+		out.reserve(tokenCount());
+		for (const Region& region : regions) {
+			for (CompactToken token : region.tokens) {
+				token.offset += static_cast<uint32_t>(region.offset);
+				token.line += region.line;
+				out.push_back(token);
+			}
+		}
+		return out;
+	}
+
+private:
+	struct Region {
+		size_t offset = 0;						// of text in the file
+		uint32_t line = 1;						// line text starts on
+		std::string text;
+		std::vector<CompactToken> tokens;		// offsets into text, lines relative to `line`
+		std::vector<ASTNode*> roots;			// one declaration, or any number after a fallback
+		std::vector<Symbol> classes;			// names of the classes among roots
+		std::shared_ptr<Program> owner;		// arena of roots, shared by regions parsed together
+	};
+
+	// Consecutive regions [first, last) being re-lexed or re-parsed, as one buffer
+	struct Window {
+		size_t first = 0, last = 0;
+		size_t offset = 0;
+		uint32_t line = 1;
+		std::string text;
+		std::vector<CompactToken> tokens;	// offsets into text, file lines
+	};
+
+	std::vector<Region> regions;
+	Program merged;	// roots of all regions; owns no nodes
+	size_t bytes = 0;
+	std::string failure;
+
+	// Every re-parse keeps its own Program for as long as one of its declarations lives, so
+	// its arena starts at about the size the tokens need (20-ish bytes each) instead of the
+	// default 64 KiB; a larger parse still grows it chunk by chunk
+	static size_t arenaChunkFor(size_t tokens) { return std::clamp<size_t>(tokens * 32, 256, 64 * 1024); }
+
+	size_t regionAt(size_t offset) const {
+		auto after = std::upper_bound(regions.begin(), regions.end(), offset,
+									  [](size_t value, const Region& region) { return value < region.offset; });
+		return after == regions.begin() ? 0 : static_cast<size_t>(after - regions.begin()) - 1;
+	}
+
+	// Start of the line holding `offset`, moving `region` back to the region it is in
+	size_t lineStart(size_t& region, size_t offset) const {
+		for (;;) {
+			const Region& r = regions[region];
+			size_t local = offset - r.offset;
+			size_t newline = local ? r.text.rfind('\n', local - 1) : std::string::npos;
+			if (newline != std::string::npos) return r.offset + newline + 1;
+			if (region == 0) return 0;
+			--region;
+			offset = regions[region].offset + regions[region].text.size();
+		}
+	}
+
+	// The newline ending the line that holds `offset` (or the end of the file), moving
+	// `region` forward to the region it is in
+	size_t lineFinish(size_t& region, size_t offset) const {
+		for (;;) {
+			const Region& r = regions[region];
+			size_t newline = r.text.find('\n', offset - r.offset);
+			if (newline != std::string::npos) return r.offset + newline;
+			if (region + 1 == regions.size()) return bytes;
+			++region;
+			offset = regions[region].offset;
+		}
+	}
+
+	// Adds the region after the window; lineShift is what the edit did to its lines
+	void append(Window& window, int64_t lineShift) {
+		const Region& region = regions[window.last++];
+		const uint32_t base = static_cast<uint32_t>(region.line + lineShift);
+		for (CompactToken token : region.tokens) {
+			token.offset += static_cast<uint32_t>(window.text.size());
+			token.line += base;
+			window.tokens.push_back(token);
+		}
+		window.text += region.text;
+	}
+
+	// Adds the region before the window, which the edit did not move
+	void prepend(Window& window) {
+		const Region& region = regions[--window.first];
+		std::vector<CompactToken> tokens;
+		tokens.reserve(region.tokens.size() + window.tokens.size());
+		for (CompactToken token : region.tokens) {
+			token.line += region.line;
+			tokens.push_back(token);
+		}
+		for (CompactToken token : window.tokens) {
+			token.offset += static_cast<uint32_t>(region.text.size());
+			tokens.push_back(token);
+		}
+		window.tokens = std::move(tokens);
+		window.text.insert(0, region.text);
+		window.offset = region.offset;
+		window.line = region.line;
+	}
+
+	// Re-splits and parses the window, growing it until it covers whole declarations
+	void reparse(Window& window, int64_t byteShift, int64_t lineShift, EditStats& stats) {
+		for (size_t grow = 1;; grow *= 2) {
+			TopLevelScan scan = scanTopLevel(window.tokens);
+			if (scan.ok && scan.declarationCount() > 0) {
+				std::unordered_map<Symbol, uint32_t> earlier;	// classes before the window
+				for (size_t r = 0; r < window.first; ++r) {
+					for (Symbol name : regions[r].classes) earlier.emplace(name, 0);
+				}
+				std::shared_ptr<Program> program;
+				try {
+					Parser parser(window.text, window.tokens);
+					parser.declareClasses(earlier, 1);
+					parser.builder().setFirstChunkSize(arenaChunkFor(window.tokens.size()));
+					program.reset(parser.Parse());
+				} catch (const std::exception&) {
+					program.reset();
+				}
+				if (!program || program->Code.size() != scan.declarationCount()) return rebuild(window, byteShift, lineShift, stats);
+
+				failure.clear();	// a file that failed to parse is a single region, so this was all of it
+				std::unordered_set<Symbol> changed;	// class names added or removed by the edit
+				for (size_t r = window.first; r < window.last; ++r) changed.insert(regions[r].classes.begin(), regions[r].classes.end());
+				const size_t end = install(window, &scan, program, byteShift, lineShift);
+				stats.reparsedDeclarations += program->Code.size();
+				for (size_t r = window.first; r < end; ++r) {
+					for (Symbol name : regions[r].classes) {
+						if (!changed.erase(name)) changed.insert(name);
+					}
+				}
+				if (!changed.empty()) reparseUsers(end, changed, stats);
+				return;
+			}
+			if (window.last < regions.size()) {
+				for (size_t n = 0; n < grow && window.last < regions.size(); ++n) append(window, lineShift);
+			} else if (scan.ok && window.first > 0) {
+				prepend(window);	// the edit left no declaration here; join the one before
+			} else {
+				return rebuild(window, byteShift, lineShift, stats);
+			}
+		}
+	}
+
+	// Parses the regions after `from` that mention a class in `changed` again, with the
+	// classes of the whole file as the parser would have seen them
+	void reparseUsers(size_t from, const std::unordered_set<Symbol>& changed, EditStats& stats) {
+		std::unordered_map<Symbol, uint32_t> classes;
+		uint32_t ordinal = 0;
+		std::vector<uint32_t> firstOrdinal(regions.size());
+		for (size_t r = 0; r < regions.size(); ++r) {
+			firstOrdinal[r] = ordinal;
+			for (ASTNode* root : regions[r].roots) {
+				if (auto* decl = dynamic_cast<ClassDecl*>(root)) classes.emplace(decl->name, ordinal);
+				++ordinal;
+			}
+		}
+
+		size_t root = 0;
+		for (size_t r = 0; r < from; ++r) root += regions[r].roots.size();
+		for (size_t r = from; r < regions.size(); root += regions[r].roots.size(), ++r) {
+			Region& region = regions[r];
+			bool mentions = std::any_of(region.tokens.begin(), region.tokens.end(), [&](const CompactToken& token) {
+				return token.symbol && changed.count(token.symbol);
+			});
+			if (!mentions) continue;
+
+			std::vector<CompactToken> tokens = region.tokens;
+			for (CompactToken& token : tokens) token.line += region.line;
+			std::shared_ptr<Program> program;
+			try {
+				Parser parser(region.text, tokens);
+				parser.declareClasses(classes, firstOrdinal[r]);
+				parser.builder().setFirstChunkSize(arenaChunkFor(tokens.size()));
+				program.reset(parser.Parse());
+			} catch (const std::exception&) {
+				program.reset();
+			}
+			if (!program || program->Code.size() != region.roots.size()) {
+				Window whole;
+				whole.first = whole.last = r;
+				whole.offset = region.offset;
+				whole.line = region.line;
+				append(whole, 0);
+				return rebuild(whole, 0, 0, stats);
+			}
+			region.roots = program->Code;
+			region.owner = std::move(program);
+			std::copy(region.roots.begin(), region.roots.end(), merged.Code.begin() + root);
+			stats.reparsedDeclarations += region.roots.size();
+		}
+	}
+
+	// Parses the whole file. The window is grown to cover it.
+	void rebuild(Window& window, int64_t byteShift, int64_t lineShift, EditStats& stats) {
+		while (window.last < regions.size()) append(window, lineShift);
+		while (window.first > 0) prepend(window);
+		stats.fullRebuild = true;
+		failure.clear();
+
+		TopLevelScan scan = scanTopLevel(window.tokens);
+		std::shared_ptr<Program> program;
+		try {
+			Parser parser(window.text, window.tokens);
+			parser.builder().setFirstChunkSize(arenaChunkFor(window.tokens.size()));
+			program.reset(parser.Parse());
+		} catch (const std::exception& e) {
+			failure = e.what();
+			program = std::make_shared<Program>();
+		}
+		bool split = failure.empty() && scan.ok && program->Code.size() == scan.declarationCount() && !program->Code.empty();
+		install(window, split ? &scan : nullptr, program, byteShift, lineShift);
+		stats.reparsedDeclarations = program->Code.size();
+	}
+
+	// Overwrites in place what it can: most edits swap one region for one region, and
+	// shifting every later region would cost more than the parse
+	template<class T>
+	static void replaceRange(std::vector<T>& items, size_t at, size_t removed, std::vector<T>& added) {
+		const size_t common = std::min(removed, added.size());
+		std::move(added.begin(), added.begin() + common, items.begin() + at);
+		if (removed > common) items.erase(items.begin() + at + common, items.begin() + at + removed);
+		else items.insert(items.begin() + at + common, std::make_move_iterator(added.begin() + common), std::make_move_iterator(added.end()));
+	}
+
+	// Replaces the window's regions with one region per declaration of `scan` (or a single
+	// region holding all of program when there is no scan) and moves the regions after it.
+	// Returns the index one past the new regions.
+	size_t install(const Window& window, const TopLevelScan* scan, const std::shared_ptr<Program>& program,
+				   int64_t byteShift, int64_t lineShift) {
+		std::vector<Region> replacement;
+		const size_t count = scan ? scan->declarationCount() : 1;
+		for (size_t d = 0; d < count; ++d) {
+			Region region;
+			const size_t firstToken = scan ? scan->starts[d] : 0;
+			const size_t endToken = scan ? scan->starts[d + 1] : window.tokens.size();
+			const size_t begin = d == 0 ? 0 : window.tokens[firstToken].offset;
+			const size_t end = d + 1 == count ? window.text.size() : window.tokens[endToken].offset;
+			region.offset = window.offset + begin;
+			region.line = d == 0 ? window.line : window.tokens[firstToken].line;
+			region.text = window.text.substr(begin, end - begin);
+			region.tokens.assign(window.tokens.begin() + firstToken, window.tokens.begin() + endToken);
+			for (CompactToken& token : region.tokens) {
+				token.offset -= static_cast<uint32_t>(begin);
+				token.line -= region.line;
+			}
+			if (scan) region.roots = {program->Code[d]};
+			else region.roots = program->Code;
+			for (ASTNode* root : region.roots) {
+				if (auto* decl = dynamic_cast<ClassDecl*>(root)) region.classes.push_back(decl->name);
+			}
+			region.owner = program;
+			replacement.push_back(std::move(region));
+		}
+
+		size_t root = 0, removed = 0;
+		for (size_t r = 0; r < window.first; ++r) root += regions[r].roots.size();
+		for (size_t r = window.first; r < window.last; ++r) removed += regions[r].roots.size();
+		replaceRange(merged.Code, root, removed, program->Code);
+		replaceRange(regions, window.first, window.last - window.first, replacement);
+		const size_t end = window.first + count;
+		for (size_t r = end; r < regions.size(); ++r) {
+			regions[r].offset = static_cast<size_t>(regions[r].offset + byteShift);
+			regions[r].line = static_cast<uint32_t>(regions[r].line + lineShift);
+		}
+		return end;
+	}
+};
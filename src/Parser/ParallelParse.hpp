@@ -0,0 +1,131 @@
+#pragma once
+
+#include "Parser.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+// Parses the top-level declarations of one file concurrently. A cheap pre-scan finds
+// declaration boundaries by brace matching and records every class name with the
+// ordinal of the declaration that introduces it; that is all the cross-declaration
+// state the parser has (the type table). Slices of declarations are then parsed on a
+// thread pool, each into its own Program arena, and stitched together in order. The
+// result is the same Program a sequential Parser produces.
+
+// Top-level layout of a token stream. `ok` is false if the file does not have the
+// `class Name { ... }` / `Type name(...) { ... }` shape the split relies on.
+struct TopLevelScan {
+	std::vector<uint32_t> starts;	// first token of each declaration; back() is the token count
+	std::unordered_map<Symbol, uint32_t> classes;	// class name -> declaring ordinal
+	bool ok = true;
+
+	size_t declarationCount() const { return starts.empty() ? 0 : starts.size() - 1; }
+};
+
+inline TopLevelScan scanTopLevel(std::span<const CompactToken> tokens) {
+	TopLevelScan scan;
+	const Symbol classKeyword = intern("class");
+	const size_t n = tokens.size();
+
+	// Index one past the bracket matching tokens[i] (an opening bracket), or `unbalanced`
+	const size_t unbalanced = SIZE_MAX;
+	auto skipGroup = [&](size_t i) {
+		int depth = 0;
+		for (; i < n; ++i) {
+			switch (tokens[i].type) {
+				case TokenType::o_paren: case TokenType::o_brace: case TokenType::o_bracket: ++depth; break;
+				case TokenType::c_paren: case TokenType::c_brace: case TokenType::c_bracket:
+					if (--depth == 0) return i + 1;
+					break;
+				default: break;
+			}
+		}
+		return unbalanced;
+	};
+	auto fail = [&] {
+		scan.ok = false;
+		return scan;
+	};
+
+	size_t i = 0;
+	while (i < n) {
+		scan.starts.push_back(static_cast<uint32_t>(i));
+		if (tokens[i].symbol == classKeyword) {	// class Name { fields }
+			if (i + 2 >= n || tokens[i + 1].type != TokenType::identifier || tokens[i + 2].type != TokenType::o_brace) return fail();
+			scan.classes.emplace(tokens[i + 1].symbol, static_cast<uint32_t>(scan.starts.size() - 1));
+			i = skipGroup(i + 2);
+		} else {								// Type name ( params ) { body }, where Type may be T[]
+			size_t name = i + 1;
+			if (name + 1 < n && tokens[name].type == TokenType::o_bracket && tokens[name + 1].type == TokenType::c_bracket) name += 2;
+			if (name + 1 >= n || tokens[name + 1].type != TokenType::o_paren) return fail();
+			i = skipGroup(name + 1);
+			if (i >= n || tokens[i].type != TokenType::o_brace) return fail();
+			i = skipGroup(i);
+		}
+		if (i == unbalanced) return fail();
+	}
+	scan.starts.push_back(static_cast<uint32_t>(n));
+	return scan;
+}
+
+// Parses tokens with `pool`, or sequentially when the file is small or does not split
+// cleanly. Any parse error is reported by re-running the sequential parser, so messages
+// and line numbers are exactly the sequential ones. Must not be called from a pool task.
+inline Program* parseParallel(std::string_view source, std::span<const CompactToken> tokens,
+							  ThreadPool& pool, size_t minTokensPerTask = 16 * 1024) {
+	auto sequential = [&] { return Parser(source, tokens).Parse(); };
+
+	TopLevelScan scan = scanTopLevel(tokens);
+	if (!scan.ok || pool.size() < 2 || tokens.size() < 2 * minTokensPerTask) return sequential();
+
+	// Contiguous slices of whole declarations, about tokens / (4 * threads) tokens each
+	size_t target = std::max(minTokensPerTask, tokens.size() / (pool.size() * 4));
+	std::vector<uint32_t> sliceDecls = {0};	// first declaration of each slice; back() = count
+	for (uint32_t d = 1; d < scan.declarationCount(); ++d) {
+		if (scan.starts[d] - scan.starts[sliceDecls.back()] >= target) sliceDecls.push_back(d);
+	}
+	sliceDecls.push_back(static_cast<uint32_t>(scan.declarationCount()));
+	const size_t sliceCount = sliceDecls.size() - 1;
+	if (sliceCount < 2) return sequential();
+
+	struct Slice {
+		std::unique_ptr<Program> program;
+		bool failed = false;
+	};
+	std::vector<Slice> slices(sliceCount);
+
+	for (size_t s = 0; s < sliceCount; ++s) {
+		pool.submit([&, s] {
+			const uint32_t firstDecl = sliceDecls[s];
+			const uint32_t first = scan.starts[firstDecl];
+			const uint32_t end = scan.starts[sliceDecls[s + 1]];
+			try {
+				Parser parser(source, tokens.subspan(first, end - first), first);
+				parser.declareClasses(scan.classes, firstDecl);
+				slices[s].program.reset(parser.Parse());
+				// The parser must see the same declarations the scan did
+				slices[s].failed = slices[s].program->Code.size() != sliceDecls[s + 1] - firstDecl;
+			} catch (const std::exception&) {
+				slices[s].failed = true;
+			}
+		});
+	}
+	pool.wait();
+
+	for (const Slice& slice : slices) {
+		if (slice.failed) return sequential();	// throws the sequential error, or parses what the scan misjudged
+	}
+
+	auto program = std::make_unique<Program>();
+	program->Code.reserve(scan.declarationCount());
+	for (Slice& slice : slices) {
+		program->Code.insert(program->Code.end(), slice.program->Code.begin(), slice.program->Code.end());
+		program->arena.absorb(std::move(slice.program->arena));
+	}
+	return program.release();
+}
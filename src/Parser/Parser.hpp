@@ -1,41 +1,127 @@
 #pragma once
 
-#include "SyntaxTree.hpp"
+#include "AstBuilder.hpp"
+#include "Precedence.hpp"
+#include "TokenCursor.hpp"
 #include "Lexer.hpp"
 
+#include <charconv>
+#include <span>
 #include <vector>
 #include <stdexcept>
+#include <unordered_map>
 #include <unordered_set>
+#include <memory>
+
+// Recursive descent parser. Nodes are created through Builder (see AstBuilder.hpp), so the
+// same parser produces the class tree (Parser) or the flat AST (FlatParser).
+template<class Builder>
+class BasicParser {
+	using Node = typename Builder::Node;
 
-// Assuming Token and ASTNode classes are already defined
-class Parser {
 private:
-    std::vector<Token> tokens;
-	std::unordered_set<std::string> typeTable;
+	// Backing storage when constructed from owned Tokens; empty when the parser borrows
+	std::string ownedSource;
+	std::vector<CompactToken> ownedTokens;
+	TokenCursor cursor;	// current position in the token list
+	std::unordered_set<Symbol> typeTable;
+	// Classes declared outside this parser's tokens (see declareClasses), by declaration ordinal
+	const std::unordered_map<Symbol, uint32_t>* outerClasses = nullptr;
+	uint32_t declaration = 0;	// ordinal of the top-level declaration being parsed
 	std::unordered_set<std::string> primitiveTypeTable = {"float", "void"};
-    size_t current = 0; // Tracks current position in the token list
+	Symbol classKeyword = intern("class");
+	Builder b;
+
+	// Child lists under construction. Nested lists push above their parent's entries and
+	// pop when done, so the buffers are reused for the whole parse instead of allocated per list.
+	std::vector<Node> nodeStack;
+	ParamList paramStack;
 
 public:
-    explicit Parser(std::vector<Token>& tokens) : tokens(tokens) {
-		for(auto type : primitiveTypeTable){
-			typeTable.emplace(type);
+	// Borrows lexer output (Lexer::tokenizeBuffer); source and tokens must outlive the parser.
+	// firstIndex is the index of tokens[0] in the whole file, so spans of a parser over a
+	// slice of the file match those of a parser over all of it.
+	BasicParser(std::string_view source, std::span<const CompactToken> tokens, size_t firstIndex = 0)
+		: cursor(source, tokens, firstIndex) {
+		registerPrimitiveTypes();
+	}
+
+	// Pulls tokens from stream as parsing advances, holding at most `window` of them at a time.
+	// Pass a ThreadedTokenSource to lex on a separate thread while parsing.
+	BasicParser(std::string_view source, TokenSource& stream, size_t window = TokenCursor::defaultWindow)
+		: cursor(source, stream, window) {
+		registerPrimitiveTypes();
+	}
+
+	// Line based Lexer::tokenize output, consumed: the token texts are packed once into a
+	// single buffer and the Tokens are freed, so parsing runs on compact tokens like the
+	// borrowing constructor and the text is not held twice.
+	explicit BasicParser(std::vector<Token>&& tokens) {
+		size_t size = 0;
+		for (const Token& token : tokens) size += token.value.size() + 1;
+		checkCompactSourceSize(size);
+		ownedSource.reserve(size);
+		ownedTokens.reserve(tokens.size());
+		for (const Token& token : tokens) {
+			CompactToken ct;
+			ct.type = token.type;
+			ct.op = token.op;
+			ct.offset = static_cast<uint32_t>(ownedSource.size());
+			ct.length = static_cast<uint32_t>(token.value.size());
+			ct.line = static_cast<uint32_t>(token.line);
+			ct.column = 0;	// not tracked by Token
+			ct.symbol = token.symbol;
+			ownedTokens.push_back(ct);
+			ownedSource += token.value;
+			ownedSource += ' ';
 		}
+		std::vector<Token>().swap(tokens);
+		cursor = TokenCursor(ownedSource, ownedTokens);
+		registerPrimitiveTypes();
 	}
 
-    Program* Parse() {// Entry point for parsing either a function or a class definition
-		Program* root = new Program;
+	// The cursor may point into this object's own storage
+	BasicParser(const BasicParser&) = delete;
+	BasicParser& operator=(const BasicParser&) = delete;
+
+	// For parsing a slice of a file: its first declaration has ordinal firstDeclaration, and a
+	// class in `classes` counts as a type once parsing is past the declaration that declares it,
+	// exactly as if this parser had parsed everything before the slice.
+	void declareClasses(const std::unordered_map<Symbol, uint32_t>& classes, uint32_t firstDeclaration) {
+		outerClasses = &classes;
+		declaration = firstDeclaration;
+	}
+
+	Builder& builder() { return b; }
+
+    typename Builder::Result Parse() {// Entry point for parsing either a function or a class definition
+		b.begin();
 		while(!isAtEnd()){
-			if(peek().value == "class"){
-				root->Code.emplace_back(parseClass());
+			if(peek().symbol == classKeyword){
+				b.addTopLevel(parseClass());
 			}else{
-				root->Code.emplace_back(parseFunction()); 
+				b.addTopLevel(parseFunction()); 
 			}
+			++declaration;
 		}
-		return root;
+		return b.finish();
     }
 
 private:
-    ASTNode* parseStatement() {
+	void registerPrimitiveTypes() {
+		for(auto& type : primitiveTypeTable){
+			typeTable.emplace(intern(type));
+		}
+	}
+
+	bool isType(Symbol name) const {
+		if (typeTable.find(name) != typeTable.end()) return true;
+		if (!outerClasses) return false;
+		auto it = outerClasses->find(name);
+		return it != outerClasses->end() && it->second < declaration;
+	}
+
+    Node parseStatement() {
         // Example: Detects an assignment statement like "x = 5 + 3;"
         if(check(TokenType::o_brace)){
 			return parseCompound();
@@ -47,7 +133,7 @@ private:
 			return parseFor();
 		}else if(check(TokenType::_return)){
 			return parseReturn();
-		}else if(typeTable.find(peek().value) != typeTable.end()){	//if it is a data type, that means it is a variable declaration
+		}else if(isType(peek().symbol)){	//if it is a data type, that means it is a variable declaration
 			return parseDefinition();
 		}else if(check(TokenType::_break) || check(TokenType::_continue)){
 			return parseLoopControl();
@@ -59,157 +145,146 @@ private:
 
 	//---------------------------------------------------------------------------------------------------------------------------------------------------------------
 	#pragma region expressionHandler
-	ASTNode* parseExpression() {
-		return parseAssignment();  // Start from the lowest precedence
+	Node parseExpression() {
+		return parseExpression(0);  // Start from the lowest precedence
 	}
-	
-	ASTNode* parseAssignment() {
-		ASTNode* left = parseComparison(); // First parse a comparison expression
-	
-		// Check for assignment operator "=".
-		if (check(TokenType::_operator) && peek().value == "=") {
-			std::string op = advance().value;  // consume "="
-			ASTNode* right = parseAssignment(); // right-associative for assignment
-			return new BinaryExpr(op, left, right);
-		}
-		return left;
+
+	// Pratt loop: parses operators whose left binding power is at least minPower.
+	// Left-associative chains are consumed iteratively; recursion only happens for
+	// right operands, so depth follows the actual nesting of the expression.
+	Node parseExpression(uint8_t minPower) {
+		size_t start = cursor.position();
+		return parseInfix(start, parseOperand(), minPower);
 	}
-	
-	ASTNode* parseComparison() {
-		ASTNode* left = parseAddition(); // Next, parse addition/subtraction
-	
-		// Suppose comparison operators are "==", "!=", "<", "<=", ">", ">="
-		while (check(TokenType::_operator) &&
-			  (peek().value == "==" || peek().value == "!=" ||
-			   peek().value == "<"  || peek().value == "<=" ||
-			   peek().value == ">"  || peek().value == ">=")) {
 
-			std::string op = advance().value;  // consume the operator
-			ASTNode* right = parseAddition();
-			left = new BinaryExpr(op, left, right);
+	// A prefix expression or a primary
+	Node parseOperand() {
+		if (check(TokenType::_operator) && isPrefixOperator(peek().op)) {	// ++x, --x, -x, !x
+			size_t start = cursor.position();
+			OpKind op = advance().op;
+			Node operand = parseExpression(prefixPower);
+			return b.prefix(spanFrom(start), op, operand);
 		}
-		return left;
+		return parsePrimary();
 	}
-	
-	ASTNode* parseAddition() {
-		ASTNode* left = parseMultiplication();  // Higher precedence: multiplication
-	
-		// Check for addition or subtraction operators
-		while (check(TokenType::_operator) &&
-			  (peek().value == "+" || peek().value == "-")) {
-			std::string op = advance().value;  // consume the operator
-			ASTNode* right = parseMultiplication();
-			left = new BinaryExpr(op, left, right);
+
+	// The operators after left, which started at token start. A right operand is parsed
+	// as a plain operand and only extended by a nested loop when the next operator binds
+	// to it, so an operand followed by an equal or weaker operator costs no extra call.
+	Node parseInfix(size_t start, Node left, uint8_t minPower) {
+		while (check(TokenType::_operator)) {
+			BindingPower power = infixPower(peek().op);
+			if (power.left == 0 || power.left < minPower) break;
+			OpKind op = advance().op;  // consume the operator
+			size_t rightStart = cursor.position();
+			Node right = parseOperand();
+			if (check(TokenType::_operator) && infixPower(peek().op).left >= power.right) {
+				right = parseInfix(rightStart, right, power.right);
+			}
+			left = b.binary(spanFrom(start), op, left, right);
 		}
 		return left;
 	}
 	
-	ASTNode* parseMultiplication() {
-		ASTNode* left = parseUnary();  // Start with a primary expression
-	
-		// Check for multiplication, division, modulus, or exponentiation operators
-		while (check(TokenType::_operator) &&
-			  (peek().value == "*" || peek().value == "/" ||
-			   peek().value == "%" || peek().value == "^")) {
-			std::string op = advance().value;  // consume the operator
-			ASTNode* right = parseUnary();
-			left = new BinaryExpr(op, left, right);
+	Node parsePrimary() {
+		size_t start = cursor.position();
+		if (check(TokenType::int_lit)) {
+			int value = intValue(advance());
+			return b.literal(spanFrom(start), value);
 		}
-		return left;
+		if (check(TokenType::identifier)) {
+			Symbol name = advance().symbol;
+			Node node = b.variable(spanFrom(start), name);
+			return hasSuffix() ? parseSuffixes(start, node) : node;
+		}
+		if (match(TokenType::o_paren)) {  // Handle parenthesized expressions
+			Node expr = parseExpression();
+			consume(TokenType::c_paren, "Expected ')' after expression.");
+			return expr;
+		}
+		throw std::runtime_error("Expected a number, variable, or '('.");
+	}
+
+	// An index, member access, ++/-- or call follows the variable just parsed
+	bool hasSuffix() {
+		const CompactToken& next = peek();
+		if (next.type == TokenType::_operator) return next.op == OpKind::Dot || next.op == OpKind::Increment || next.op == OpKind::Decrement;
+		return next.type == TokenType::o_bracket || next.type == TokenType::o_paren;
 	}
 
-	ASTNode* parseUnary() {
-		if (check(TokenType::_operator) && (peek().value == "++" || peek().value == "--")) {
-			std::string op = advance().value;
-			ASTNode* operand = parseUnary();  // Recursively parse the next expression
-			return new PrefixExpr(op, operand);
+	// Kept out of parsePrimary so the plain variable and literal paths stay small
+	[[gnu::noinline]] Node parseSuffixes(size_t start, Node node) {
+		// Handle indexing (arr[expr])
+		while (check(TokenType::o_bracket)) { // '[' detected
+			advance();
+			Node index = parseExpression(); // Parse the index expression
+			consume(TokenType::c_bracket, "Expected ']' after index.");
+			node = b.index(spanFrom(start), node, index); // Wrap in IndexExpr
 		}
-		return parsePrimary();  // If no prefix operator, parse normally
-	}	
-	
-	ASTNode* parsePrimary() {
-		if (match(TokenType::int_lit)) {
-			return new LiteralExpr(std::stoi(previous().value));
+
+		// Handle member access (obj.field)
+		while (checkOp(OpKind::Dot)) { // '.' detected
+			advance();
+			Symbol field = advance().symbol;
+			node = b.fieldAccess(spanFrom(start), node, field); // Wrap in MemberAccessExpr
 		}
-		if (match(TokenType::identifier)) {
-			ASTNode* node = new VariableExpr(previous().value);
-	
-			// Handle indexing (arr[expr])
-			while (check(TokenType::o_bracket)) { // '[' detected
-				advance();
-				ASTNode* index = parseExpression(); // Parse the index expression
-				consume(TokenType::c_bracket, "Expected ']' after index.");
-				node = new IndexExpr(node, index); // Wrap in IndexExpr
-			}
-	
-			// Handle member access (obj.field)
-			while (check(TokenType::_operator) && peek().value == ".") { // '.' detected
-				advance();
-				std::string field = advance().value;
-				node = new ClassFieldAccessExpr(node, field); // Wrap in MemberAccessExpr
-			}
 
-			// Handle postfix expressions (var++/var--)
-			while (check(TokenType::_operator) && (peek().value == "++" || peek().value == "--")) {
-				advance();
-				std::string op = previous().value;
-				node = new PostfixExpr(op, node);  // Wrap in PostfixExpr
-			}
+		// Handle postfix expressions (var++/var--)
+		while (checkOp({OpKind::Increment, OpKind::Decrement})) {
+			OpKind op = advance().op;
+			node = b.postfix(spanFrom(start), op, node);  // Wrap in PostfixExpr
+		}
 
-			while (check(TokenType::o_paren)) { // '(' detected
-				advance();
-				std::vector<ASTNode*> arguments;
-				if (!check(TokenType::c_paren)) {
-					do {
-						arguments.push_back(parseExpression());
-					} while (match(TokenType::comma));
-				}
-				consume(TokenType::c_paren, "Expected ')' after function call arguments.");
-				
-				node = new FunctionCallExpr(node, arguments);
+		while (check(TokenType::o_paren)) { // '(' detected
+			advance();
+			size_t base = nodeStack.size();
+			if (!check(TokenType::c_paren)) {
+				do {
+					Node argument = parseExpression();
+					nodeStack.push_back(argument);
+				} while (match(TokenType::comma));
 			}
-	
-			return node;
+			consume(TokenType::c_paren, "Expected ')' after function call arguments.");
+			
+			node = b.call(spanFrom(start), node, nodesSince(base));
+			nodeStack.resize(base);
 		}
-		if (match(TokenType::o_paren)) {  // Handle parenthesized expressions
-			ASTNode* expr = parseExpression();
-			consume(TokenType::c_paren, "Expected ')' after expression.");
-			return expr;
-		}
-		throw std::runtime_error("Expected a number, variable, or '('.");
+
+		return node;
 	}
 	#pragma endregion
 	//---------------------------------------------------------------------------------------------------------------------------------------------------------------
-	ASTNode* parseFunction() {
-		if(typeTable.find(peek().value) == typeTable.end()){
+	Node parseFunction() {
+		size_t start = cursor.position();
+		if(!isType(peek().symbol)){
 			throw std::runtime_error("Expected return datatype for function.");
 		}
 
-		std::string returnType = advance().value;	
+		Symbol returnType = typeName();
 
 		if (check(TokenType::identifier)) {
-			std::string functionName = advance().value;
+			Symbol functionName = advance().symbol;
 	
 			if (!match(TokenType::o_paren)) {
 				throw std::runtime_error("Expected '(' after function name.");
 			}
 	
-			std::vector<std::pair<std::string, std::string>> params; // (name, type)
+			size_t base = paramStack.size(); // (name, type) pairs from here on
 	
 			// Parse optional parameters
 			if (!check(TokenType::c_paren)) { // If not immediately closed, parse params
 				do {
-					if (typeTable.find(peek().value) == typeTable.end()) {
+					if (!isType(peek().symbol)) {
 						throw std::runtime_error("Expected a type.");
 					}
-					std::string paramType = advance().value;
+					Symbol paramType = typeName();
 
 					if (!check(TokenType::identifier)) {
 						throw std::runtime_error("Expected a type.");
 					}
-					std::string paramName = advance().value;
+					Symbol paramName = advance().symbol;
 	
-					params.push_back({paramName, paramType}); // No explicit type in this syntax
+					paramStack.push_back({paramName, paramType}); // No explicit type in this syntax
 	
 				} while (match(TokenType::comma));
 			}
@@ -219,28 +294,35 @@ private:
 			}
 	
 			// Parse function body (assumed to be a statement)
-			ASTNode* body = parseStatement();
+			Node body = parseStatement();
 	
-			return new FunctionDecl(functionName, params, returnType, body);
+			Node function = b.function(spanFrom(start), functionName, paramsSince(base), returnType, body);
+			paramStack.resize(base);
+			return function;
 		}
 	
 		throw std::runtime_error("Unexpected token at start of Function declaration.");
 	}
 	
-	ASTNode* parseCompound() {
+	Node parseCompound() {
+		size_t start = cursor.position();
 		consume(TokenType::o_brace, "Expected '{' at the start of a compound statement.");
 	
-		std::vector<ASTNode*> statements;
+		size_t base = nodeStack.size();
 	
 		while (!check(TokenType::c_brace) && !isAtEnd()) {
-			statements.push_back(parseStatement());
+			Node statement = parseStatement();
+			nodeStack.push_back(statement);
 		}
 
 		consume(TokenType::c_brace, "Expected '}' at the end of a compound statement.");
-		return new CompoundStmt(statements);
+		Node compound = b.compound(spanFrom(start), nodesSince(base));
+		nodeStack.resize(base);
+		return compound;
 	}
 
-	ASTNode* parseIf() {
+	Node parseIf() {
+		size_t start = cursor.position();
 		if (!match(TokenType::_if)) {
 			throw std::runtime_error("Expected 'if' keyword.");
 		}
@@ -249,23 +331,24 @@ private:
 			throw std::runtime_error("Expected '(' after 'if'.");
 		}
 	
-		ASTNode* condition = parseStatement(); // Parse the condition
+		Node condition = parseExpression(); // Parse the condition
 	
 		if (!match(TokenType::c_paren)) {
 			throw std::runtime_error("Expected ')' after condition.");
 		}
 	
-		ASTNode* thenStmt = parseStatement(); // Parse the statement/block after `if`
+		Node thenStmt = parseStatement(); // Parse the statement/block after `if`
 	
-		ASTNode* elseStmt = nullptr;
+		Node elseStmt = Builder::null;
 		if (match(TokenType::_else)) {
 			elseStmt = parseStatement(); // Parse the statement/block after `else`
 		}
 	
-		return new IfStmt(condition, thenStmt, elseStmt);
+		return b.ifStmt(spanFrom(start), condition, thenStmt, elseStmt);
 	}
 	
-	ASTNode* parseWhile() {
+	Node parseWhile() {
+		size_t start = cursor.position();
 		if (!match(TokenType::_while)) {
 			throw std::runtime_error("Expected 'while' keyword.");
 		}
@@ -274,18 +357,19 @@ private:
 			throw std::runtime_error("Expected '(' after 'while'.");
 		}
 	
-		ASTNode* condition = parseExpression(); // Parse the condition
+		Node condition = parseExpression(); // Parse the condition
 	
 		if (!match(TokenType::c_paren)) {
 			throw std::runtime_error("Expected ')' after condition.");
 		}
 	
-		ASTNode* body = parseStatement(); // Parse the statement/block after `if`
+		Node body = parseStatement(); // Parse the statement/block after `if`
 	
-		return new WhileStmt(condition, body);
+		return b.whileStmt(spanFrom(start), condition, body);
 	}
 
-	ASTNode* parseFor() {
+	Node parseFor() {
+		size_t start = cursor.position();
 		if (!match(TokenType::_for)) {
 			throw std::runtime_error("Expected 'for' keyword.");
 		}
@@ -294,86 +378,133 @@ private:
 			throw std::runtime_error("Expected '(' after 'for'.");
 		}
 		
-		ASTNode* initializer = parseExpression();
+		Node initializer = parseExpression();
 		consume(TokenType::semicolon, "Expected ; in 'for' loop.");
-		ASTNode* condition = parseExpression(); // Parse the condition
+		Node condition = parseExpression(); // Parse the condition
 		consume(TokenType::semicolon, "Expected ; in 'for' loop.");
-		ASTNode* incrementor = parseExpression();
+		Node incrementor = parseExpression();
 
 		if (!match(TokenType::c_paren)) {
 			throw std::runtime_error("Expected ')' after condition.");
 		}
 	
-		ASTNode* body = parseStatement();
+		Node body = parseStatement();
 	
-		return new ForStmt(initializer, condition, incrementor, body);
+		return b.forStmt(spanFrom(start), initializer, condition, incrementor, body);
 	}
     
-	ASTNode* parseExpressionStmt() {
+	Node parseExpressionStmt() {
 		auto ret = parseExpression();
 		consume(TokenType::semicolon, "Expected a ;");
 		return ret;
 	}
 	
-	ASTNode* parseReturn() {
+	Node parseReturn() {
+		size_t start = cursor.position();
 		consume(TokenType::_return, "Expected a 'return' statement.");
-		auto expression = parseExpressionStmt();
+		Node expression = Builder::null;
+		if (!check(TokenType::semicolon)) expression = parseExpression();
 		consume(TokenType::semicolon, "Expected ;");
-		return new ReturnStmt(expression);
+		return b.returnStmt(spanFrom(start), expression);
 	}
 
-	ASTNode* parseDefinition() {
-		std::string datatype = consume(TokenType::identifier, "Expected a datatype").value;
+	Node parseDefinition() {
+		size_t start = cursor.position();
+		if (!check(TokenType::identifier)) throw std::runtime_error("Expected a datatype");
+		Symbol datatype = typeName();
 		auto expression = parseExpression();
 		consume(TokenType::semicolon, "Expected ;");
-		return new DefinitionStmt(expression, datatype);
+		return b.definition(spanFrom(start), expression, datatype);
 	}
 
-	ASTNode* parseClass() {
+	Node parseClass() {
+		size_t start = cursor.position();
 		if (!check(TokenType::identifier)) {
 			throw std::runtime_error("Expected a class identifier (name).");
 		}
 		advance();
-		std::string className = advance().value;
+		Symbol className = advance().symbol;
 		typeTable.emplace(className);
 		
 		consume(TokenType::o_brace, "Expected '{' to begin class body.");
 		
-		StructType* structType = new StructType(className);
+		size_t base = paramStack.size(); // (name, type) pairs from here on
 		
 		while (!check(TokenType::c_brace) && !isAtEnd()) {
-			std::string fieldType = consume(TokenType::identifier, "Expected a type").value;
-			std::string fieldName = consume(TokenType::identifier, "Expected field name.").value;
+			if (!check(TokenType::identifier)) throw std::runtime_error("Expected a type");
+			Symbol fieldType = typeName();
+			Symbol fieldName = consume(TokenType::identifier, "Expected field name.").symbol;
 			consume(TokenType::semicolon, "Expected ';' after field declaration.");
 
-			if(typeTable.find(fieldType) == typeTable.end()){
+			if(!isType(fieldType)){
 
 			}
-			PrimitiveType* Type = new PrimitiveType(fieldType);
 
-			structType->addField(fieldName, Type);
+			paramStack.push_back({fieldName, fieldType});
 		}
 		
 		// Consume the '}' that ends the class body
 		consume(TokenType::c_brace, "Expected '}' after class body.");
 		
 		// Return a new ClassDecl node with the parsed class name and its struct type definition
-		return new ClassDecl(className, structType);
+		Node classDecl = b.classDecl(spanFrom(start), className, paramsSince(base));
+		paramStack.resize(base);
+		return classDecl;
 	}
 
-	ASTNode* parseLoopControl() {
+	Node parseLoopControl() {
+		size_t start = cursor.position();
 		if (match(TokenType::_break)) {
 			consume(TokenType::semicolon, "Expected ';' after 'break'.");
-			return new BreakStmt();
+			return b.breakStmt(spanFrom(start));
 		}
 		if (match(TokenType::_continue)) {
 			consume(TokenType::semicolon, "Expected ';' after 'continue'.");
-			return new ContinueStmt();
+			return b.continueStmt(spanFrom(start));
 		}
 		throw std::runtime_error("Expected a loop control statement ('break' or 'continue').");
 	}
 
 
+	// A type name. `T[]` is the array type of T; it interns as the Symbol "T[]".
+	Symbol typeName() {
+		Symbol name = advance().symbol;
+		if (check(TokenType::o_bracket)) {
+			advance();
+			consume(TokenType::c_bracket, "Expected ']' in array type.");
+			name = intern(std::string(globalInterner().text(name)) + "[]");
+		}
+		return name;
+	}
+
+	// Tokens consumed since start
+	SourceSpan spanFrom(size_t start) const {
+		return {static_cast<uint32_t>(start), static_cast<uint32_t>(cursor.position())};
+	}
+
+	// Entries pushed since base; the builder copies them, then the caller truncates the stack
+	std::span<const Node> nodesSince(size_t base) const {
+		return {nodeStack.data() + base, nodeStack.size() - base};
+	}
+
+	ParamSpan paramsSince(size_t base) const {
+		return {paramStack.data() + base, paramStack.size() - base};
+	}
+
+	// Value of an int literal, read straight from the source buffer (leading digits, like stoi)
+	int intValue(const CompactToken& token) const {
+		std::string_view text = cursor.text(token);
+		int value = 0;
+		auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+		if (ec != std::errc()) literalOutOfRange(token);
+		return value;
+	}
+
+	// Out of line, so the message building stays out of the operand path
+	[[noreturn, gnu::noinline]] void literalOutOfRange(const CompactToken& token) const {
+		throw std::runtime_error("Parse Error: Integer literal out of range. [Line: " + std::to_string(token.line) + "]");
+	}
+
 	// Helper functions for token navigation
     bool match(TokenType type) {
         if (!isAtEnd() && peek().type == type) {
@@ -383,21 +514,35 @@ private:
         return false;
     }
 
+	// Current token is one of the given operators
+	bool checkOp(std::initializer_list<OpKind> ops) {
+		if (isAtEnd() || peek().type != TokenType::_operator) return false;
+		for (OpKind op : ops) {
+			if (peek().op == op) return true;
+		}
+		return false;
+	}
+
+	bool checkOp(OpKind op) {
+		return !isAtEnd() && peek().type == TokenType::_operator && peek().op == op;
+	}
+
+	// Past the end peek() is an _unknown token, so no separate isAtEnd() test is needed
 	bool check(TokenType type){
-		if (!isAtEnd() && peek().type == type) {
-            return true;
-        }
-        return false;
+		return peek().type == type;
 	}
 
-    Token consume(TokenType expected, const std::string& errorMessage) {
+    const CompactToken& consume(TokenType expected, const char* errorMessage) {
         if (match(expected)) return previous();
-		std::string msg = "Parse Error: " + errorMessage + " [Line: " + std::to_string(tokens[current].line) + "]";
+		std::string msg = "Parse Error: " + std::string(errorMessage) + " [Line: " + std::to_string(cursor.line()) + "]";
         throw std::runtime_error(msg);
     }
 
-    Token peek() { return tokens[current]; }
-    Token previous() { return tokens[current - 1]; }
-    Token advance() { return tokens[current++]; }
-    bool isAtEnd() { return current >= tokens.size(); }
+    const CompactToken& peek() const { return cursor.peek(); }
+    const CompactToken& previous() const { return cursor.previous(); }
+    const CompactToken& advance() { return cursor.advance(); }
+    bool isAtEnd() const { return cursor.isAtEnd(); }
 };
+
+using Parser = BasicParser<TreeBuilder>;
+using FlatParser = BasicParser<FlatBuilder>;
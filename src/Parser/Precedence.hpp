@@ -0,0 +1,56 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include "Operators.hpp"
+
+// Binding powers for the expression parser. An infix operator binds its left operand
+// with `left` and parses its right operand with minimum power `right`:
+// left < right makes it left-associative, left > right right-associative.
+// 0 means "not an infix operator". Prefix operators parse their operand at prefixPower.
+struct BindingPower {
+	uint8_t left = 0;
+	uint8_t right = 0;
+};
+
+struct InfixPrecedence {
+	OpKind op;
+	BindingPower power;
+};
+
+// lowest to highest; a new level is one more row here
+inline constexpr InfixPrecedence infixPrecedence[] = {
+	{OpKind::Assign,       {2, 1}},	// right-associative
+
+	{OpKind::Equal,        {3, 4}},
+	{OpKind::NotEqual,     {3, 4}},
+	{OpKind::Less,         {3, 4}},
+	{OpKind::LessEqual,    {3, 4}},
+	{OpKind::Greater,      {3, 4}},
+	{OpKind::GreaterEqual, {3, 4}},
+
+	{OpKind::Add,          {5, 6}},
+	{OpKind::Sub,          {5, 6}},
+
+	{OpKind::Mul,          {7, 8}},
+	{OpKind::Div,          {7, 8}},
+	{OpKind::Mod,          {7, 8}},
+	{OpKind::Pow,          {7, 8}},
+};
+
+// ++x --x -x !x bind tighter than any infix operator
+inline constexpr uint8_t prefixPower = 9;
+
+constexpr std::array<BindingPower, 256> makeInfixTable() {
+	std::array<BindingPower, 256> table{};
+	for (const InfixPrecedence& entry : infixPrecedence) table[static_cast<uint8_t>(entry.op)] = entry.power;
+	return table;
+}
+
+inline constexpr std::array<BindingPower, 256> infixTable = makeInfixTable();
+
+constexpr BindingPower infixPower(OpKind op) { return infixTable[static_cast<uint8_t>(op)]; }
+
+constexpr bool isPrefixOperator(OpKind op) {
+	return op == OpKind::Increment || op == OpKind::Decrement || op == OpKind::Sub || op == OpKind::Not;
+}
@@ -3,15 +3,18 @@
 #include <iostream>
 #include <vector>
 #include <string>
-#include <unordered_map>
+#include <span>
 #include "Type.hpp"
+#include "Arena.hpp"
+#include "Operators.hpp"
 
 inline void printIndent(int indent) {
     for (int i = 0; i < indent; ++i)
         std::cout << "  ";  // Four spaces per indent level
 }
 
-// Base class for all AST nodes
+// Base class for all AST nodes. Nodes live in their Program's arena and are never
+// deleted one by one, so members must not own memory outside the arena.
 class ASTNode {
 public:
     virtual ~ASTNode() = default;
@@ -21,6 +24,21 @@ public:
     void print() const { print(0); }
 };
 
+// Storage a name resolves to, filled in by the Resolver: a frame slot of the enclosing
+// function (parameters first, then locals), a global slot (functions, in declaration
+// order) or a builtin function (see Builtins.hpp). Later stages index by slot instead of
+// looking names up.
+struct Slot {
+	enum Kind : uint8_t { Unresolved, Local, Global, Builtin };
+
+	Kind kind = Unresolved;
+	uint32_t index = 0;
+
+	bool isLocal() const { return kind == Local; }
+	bool isGlobal() const { return kind == Global; }
+	bool isBuiltin() const { return kind == Builtin; }
+};
+
 //level 1
 class LiteralExpr : public ASTNode {
 	public:
@@ -36,9 +54,10 @@ class LiteralExpr : public ASTNode {
 	
 	class VariableExpr : public ASTNode {
 	public:
-		std::string name;
+		Symbol name;
+		Slot slot;
 	
-		VariableExpr(const std::string& name) : name(name) {}
+		VariableExpr(Symbol name) : name(name) {}
 	
 		void print(int indent = 0) const override {
 			printIndent(indent);
@@ -48,18 +67,13 @@ class LiteralExpr : public ASTNode {
 	
 	class BinaryExpr : public ASTNode {
 	public:
-		std::string op;
+		OpKind op;
 		ASTNode* left;
 		ASTNode* right;
 	
-		BinaryExpr(const std::string& op, ASTNode* left, ASTNode* right)
+		BinaryExpr(OpKind op, ASTNode* left, ASTNode* right)
 			: op(op), left(left), right(right) {}
 	
-		~BinaryExpr() {
-			delete left;
-			delete right;
-		}
-	
 		void print(int indent = 0) const override {
 			printIndent(indent);
 			std::cout << "BinaryExpr(" << op << ")" << std::endl;
@@ -70,16 +84,12 @@ class LiteralExpr : public ASTNode {
 	
 	class UnaryExpr : public ASTNode {
 	public:
-		std::string op;
+		OpKind op;
 		ASTNode* expr;
 		
-		UnaryExpr(const std::string& operatorSymbol, ASTNode* expression)
+		UnaryExpr(OpKind operatorSymbol, ASTNode* expression)
 			: op(operatorSymbol), expr(expression) {}
 		
-		~UnaryExpr() {
-			delete expr;
-		}
-		
 		void print(int indent = 0) const override {
 			printIndent(indent);
 			std::cout << "UnaryExpr(" << op << ")" << std::endl;
@@ -89,12 +99,10 @@ class LiteralExpr : public ASTNode {
 	
 	class PostfixExpr : public ASTNode {
 	public:
-		std::string op;
+		OpKind op;
 		ASTNode* operand;
 		
-		PostfixExpr(const std::string& op, ASTNode* operand) : op(op), operand(operand) {}
-		
-		~PostfixExpr() { delete operand; }
+		PostfixExpr(OpKind op, ASTNode* operand) : op(op), operand(operand) {}
 		
 		void print(int indent = 0) const override {
 			printIndent(indent);
@@ -105,12 +113,10 @@ class LiteralExpr : public ASTNode {
 	
 	class PrefixExpr : public ASTNode {
 	public:
-		std::string op;
+		OpKind op;
 		ASTNode* operand;
 		
-		PrefixExpr(const std::string& op, ASTNode* operand) : op(op), operand(operand) {}
-		
-		~PrefixExpr() { delete operand; }
+		PrefixExpr(OpKind op, ASTNode* operand) : op(op), operand(operand) {}
 		
 		void print(int indent = 0) const override {
 			printIndent(indent);
@@ -127,11 +133,6 @@ class LiteralExpr : public ASTNode {
 		IndexExpr(ASTNode* target, ASTNode* index)
 			: target(target), index(index) {}
 		
-		~IndexExpr() {
-			delete target;
-			delete index;
-		}
-		
 		void print(int indent = 0) const override {
 			printIndent(indent);
 			std::cout << "IndexExpr" << std::endl;
@@ -147,16 +148,11 @@ class LiteralExpr : public ASTNode {
 	class FunctionCallExpr : public ASTNode {
 	public:
 		ASTNode* callee;  // The function being called
-		std::vector<ASTNode*> arguments;
+		std::span<ASTNode*> arguments;
+		Slot target;      // Global or builtin slot of the callee when it names a function directly
 		
-		FunctionCallExpr(ASTNode* callee, std::vector<ASTNode*> args)
-			: callee(callee), arguments(std::move(args)) {}
-		
-		~FunctionCallExpr() {
-			delete callee;
-			for (ASTNode* arg : arguments)
-				delete arg;
-		}
+		FunctionCallExpr(ASTNode* callee, std::span<ASTNode*> args)
+			: callee(callee), arguments(args) {}
 		
 		void print(int indent = 0) const override {
 			printIndent(indent);
@@ -179,16 +175,10 @@ class LiteralExpr : public ASTNode {
 	class ClassInstanceExpr : public ASTNode {
 	public:
 		StructType* structType;  // Type of the struct
-		std::unordered_map<std::string, ASTNode*> fieldValues;  // Field initializations
-		
-		ClassInstanceExpr(StructType* structType, std::unordered_map<std::string, ASTNode*> fieldValues)
-			: structType(structType), fieldValues(std::move(fieldValues)) {}
+		std::span<std::pair<Symbol, ASTNode*>> fieldValues;  // Field initializations
 		
-		~ClassInstanceExpr() {
-			for (auto& field : fieldValues) {
-				delete field.second;
-			}
-		}
+		ClassInstanceExpr(StructType* structType, std::span<std::pair<Symbol, ASTNode*>> fieldValues)
+			: structType(structType), fieldValues(fieldValues) {}
 		
 		void print(int indent = 0) const override {
 			printIndent(indent);
@@ -204,15 +194,11 @@ class LiteralExpr : public ASTNode {
 	class ClassFieldAccessExpr : public ASTNode {
 	public:
 		ASTNode* structInstance;  // The struct variable being accessed
-		std::string fieldName;    // The field name
+		Symbol fieldName;    // The field name
 		
-		ClassFieldAccessExpr(ASTNode* structInstance, const std::string& fieldName)
+		ClassFieldAccessExpr(ASTNode* structInstance, Symbol fieldName)
 			: structInstance(structInstance), fieldName(fieldName) {}
 		
-		~ClassFieldAccessExpr() {
-			delete structInstance;
-		}
-		
 		void print(int indent = 0) const override {
 			printIndent(indent);
 			std::cout << "ClassFieldAccessExpr" << std::endl;
@@ -228,17 +214,9 @@ class LiteralExpr : public ASTNode {
 //level 2
 class BlockStmt : public ASTNode {
 	public:
-		std::vector<ASTNode*> statements;
+		std::span<ASTNode*> statements;
 	
-		~BlockStmt() {
-			for (ASTNode* stmt : statements) {
-				delete stmt;
-			}
-		}
-	
-		void addStatement(ASTNode* stmt) {
-			statements.push_back(stmt);
-		}
+		BlockStmt(std::span<ASTNode*> stmts) : statements(stmts) {}
 	
 		void print(int indent = 0) const override {
 			printIndent(indent);
@@ -253,15 +231,10 @@ class BlockStmt : public ASTNode {
 	
 	class CompoundStmt : public ASTNode {
 	public:
-		std::vector<ASTNode*> statements;
-		
-		CompoundStmt(std::vector<ASTNode*> stmts)
-			: statements(std::move(stmts)) {}
+		std::span<ASTNode*> statements;
 		
-		~CompoundStmt() {
-			for (ASTNode* stmt : statements)
-				delete stmt;
-		}
+		CompoundStmt(std::span<ASTNode*> stmts)
+			: statements(stmts) {}
 		
 		void print(int indent = 0) const override {
 			printIndent(indent);
@@ -278,10 +251,6 @@ class BlockStmt : public ASTNode {
 		
 		ExprStmt(ASTNode* expr) : expr(expr) {}
 		
-		~ExprStmt() {
-			delete expr;
-		}
-		
 		void print(int indent = 0) const override {
 			printIndent(indent);
 			std::cout << "ExprStmt" << std::endl;
@@ -299,12 +268,6 @@ class BlockStmt : public ASTNode {
 		IfStmt(ASTNode* cond, ASTNode* thenB, ASTNode* elseB = nullptr)
 			: condition(cond), thenBranch(thenB), elseBranch(elseB) {}
 		
-		~IfStmt() {
-			delete condition;
-			delete thenBranch;
-			if (elseBranch) delete elseBranch;
-		}
-		
 		void print(int indent = 0) const override {
 			printIndent(indent);
 			std::cout << "IfStmt" << std::endl;
@@ -331,11 +294,6 @@ class BlockStmt : public ASTNode {
 		WhileStmt(ASTNode* cond, ASTNode* body)
 			: condition(cond), body(body) {}
 		
-		~WhileStmt() {
-			delete condition;
-			delete body;
-		}
-		
 		void print(int indent = 0) const override {
 			printIndent(indent);
 			std::cout << "WhileStmt" << std::endl;
@@ -359,13 +317,6 @@ class BlockStmt : public ASTNode {
 		ForStmt(ASTNode* init, ASTNode* cond, ASTNode* inc, ASTNode* body)
 			: initializer(init), condition(cond), incrementor(inc), body(body) {}
 	
-		~ForStmt() {
-			delete initializer;
-			delete condition;
-			delete incrementor;
-			delete body;
-		}
-	
 		void print(int indent = 0) const override {
 			printIndent(indent);
 			std::cout << "ForStmt" << std::endl;
@@ -392,10 +343,6 @@ class BlockStmt : public ASTNode {
 		ReturnStmt(ASTNode* expr = nullptr)
 			: expression(expr) {}
 		
-		~ReturnStmt() {
-			if(expression) delete expression;
-		}
-		
 		void print(int indent = 0) const override {
 			printIndent(indent);
 			std::cout << "ReturnStmt" << std::endl;
@@ -413,16 +360,13 @@ class BlockStmt : public ASTNode {
 	
 	class DefinitionStmt : public ASTNode {
 	public:
-		std::string dataType;
+		Symbol dataType;
 		ASTNode* expression;
+		Slot slot;	// frame slot of the defined variable
 		
-		DefinitionStmt(ASTNode* exp, std::string type)
+		DefinitionStmt(ASTNode* exp, Symbol type)
 			: expression(exp), dataType(type){}
 		
-		~DefinitionStmt() {
-			delete expression;
-		}
-		
 		void print(int indent = 0) const override {
 			printIndent(indent);
 			std::cout << "DefinitionStmt" << std::endl;
@@ -456,6 +400,10 @@ class BlockStmt : public ASTNode {
 class Program : public ASTNode {
 	public:
 		std::vector<ASTNode*> Code;
+		Arena arena;	// owns every node reachable from Code
+
+		Program() = default;
+		explicit Program(size_t firstChunkSize) : arena(firstChunkSize) {}
 	
 		void print(int indent = 0) const override {
 			for(auto& node : Code){
@@ -466,19 +414,18 @@ class Program : public ASTNode {
 	
 	class FunctionDecl : public ASTNode {
 	public:
-		std::string name;
-		std::vector<std::pair<std::string, std::string>> params;
-		std::string returnType;
+		Symbol name;
+		std::span<std::pair<Symbol, Symbol>> params;	// (name, type)
+		Symbol returnType;
 		ASTNode* body;
+		uint32_t frameSize = 0;	// parameters + locals, set by the Resolver
+		FunctionType* signature = nullptr;	// set by the TypeChecker
+		std::span<Type*> frameTypes;	// type of each frame slot, set by the TypeChecker
 		
-		FunctionDecl(const std::string& name, const std::vector<std::pair<std::string, std::string>>& params,
-					 const std::string& returnType, ASTNode* body)
+		FunctionDecl(Symbol name, std::span<std::pair<Symbol, Symbol>> params,
+					 Symbol returnType, ASTNode* body)
 			: name(name), params(params), returnType(returnType), body(body) {}
 		
-		~FunctionDecl() {
-			delete body;
-		}
-		
 		void print(int indent = 0) const override {
 			printIndent(indent);
 			std::cout << "FunctionDecl(" << name << ")" << std::endl;
@@ -499,21 +446,20 @@ class Program : public ASTNode {
 	
 	class ClassDecl : public ASTNode {
 	public:
-		std::string name;
-		StructType* structType;
-		
-		ClassDecl(const std::string& name, StructType* structType)
-			: name(name), structType(structType) {}
+		Symbol name;
+		std::span<std::pair<Symbol, Symbol>> fields;	// (name, type), in declaration order
+		StructType* structType = nullptr;	// set by the TypeChecker
 		
-		~ClassDecl() {
-			delete structType;
-		}
+		ClassDecl(Symbol name, std::span<std::pair<Symbol, Symbol>> fields)
+			: name(name), fields(fields) {}
 		
 		void print(int indent = 0) const override {
 			printIndent(indent);
 			std::cout << "Class(" << name << ")" << std::endl;
-			structType->print();  // Assuming StructType::print() handles its own formatting.
+			for (auto& field : fields) {
+				printIndent(indent + 1);
+				std::cout << field.first << ": " << field.second << std::endl;
+			}
 			std::cout << std::endl;
 		}
 	};
-	
\ No newline at end of file
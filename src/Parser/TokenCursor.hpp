@@ -0,0 +1,88 @@
+#pragma once
+
+#include "Lexer_config.hpp"
+#include "TokenStream.hpp"
+
+#include <memory>
+#include <span>
+#include <string_view>
+
+// Read position over lexed tokens. The cursor borrows the source buffer the tokens point
+// into; navigation hands out references, never copies.
+//
+// Tokens come either from a borrowed array or, streaming, from a TokenSource that is
+// pulled one window at a time. A streaming cursor keeps only the current window plus the
+// token before it, so a reference from peek()/advance() is valid until the next advance();
+// previous() always works. The window is refilled as soon as it is used up, which keeps
+// peek() and isAtEnd() a single compare.
+class TokenCursor {
+public:
+	static constexpr size_t defaultWindow = 256;
+
+	TokenCursor() = default;
+	// firstIndex: input index of tokens[0], when the array is a slice of a larger input
+	TokenCursor(std::string_view source, std::span<const CompactToken> tokens, size_t firstIndex = 0)
+		: src(source), block(tokens.data()), cur(tokens.data()), end(tokens.data() + tokens.size()),
+		  base(firstIndex) {}
+
+	TokenCursor(std::string_view source, TokenSource& stream, size_t window = defaultWindow)
+		: src(source), stream(&stream), windowSize(window ? window : 1),
+		  buffer(std::make_unique<CompactToken[]>(windowSize + 1)),
+		  block(buffer.get() + 1), cur(block), end(block) {
+		refill();
+	}
+
+	// Past the last token peek() and advance() return an _unknown token, so a parser reading
+	// beyond the input fails with a parse error instead of reading garbage
+	const CompactToken& peek() const { return cur != end ? *cur : endOfInput; }
+	const CompactToken& previous() const { return cur[-1]; }
+	const CompactToken& advance() {
+		if (cur == end) return endOfInput;
+		const CompactToken* token = cur++;
+		if (cur == end) [[unlikely]] {	// window used up: pull the next one (token moves to the carry slot)
+			refill();
+			return previous();
+		}
+		return *token;
+	}
+	bool isAtEnd() const { return cur == end; }
+
+	// Index of the current token from the start of the input
+	size_t position() const { return base + static_cast<size_t>(cur - block); }
+
+	// Spelling of a token, viewed in the source buffer
+	std::string_view text(const CompactToken& token) const { return token.text(src); }
+	std::string_view source() const { return src; }
+
+	// Line of the current token, or of the last one once the input is exhausted
+	uint32_t line() const {
+		if (!isAtEnd()) return peek().line;
+		bool hasPrevious = cur != block || (stream && position() > 0);	// streaming keeps it in the carry slot
+		return hasPrevious ? previous().line : 0;
+	}
+
+private:
+	static constexpr CompactToken endOfInput{TokenType::_unknown, OpKind::None, 0, 0, 0, 0, Symbol{}};
+
+	std::string_view src;
+	TokenSource* stream = nullptr;
+	size_t windowSize = 0;
+	std::unique_ptr<CompactToken[]> buffer;	// [previous token, window...] when streaming
+
+	const CompactToken* block = nullptr;	// first token of the current window
+	const CompactToken* cur = nullptr;
+	const CompactToken* end = nullptr;
+	size_t base = 0;						// input index of *block
+
+	// Replaces the consumed window with the next one; false once the input is exhausted
+	bool refill() {
+		if (!stream) return false;
+		const size_t pos = position();
+		if (cur != block) buffer[0] = cur[-1];	// keep previous() valid across the switch
+		size_t n = stream->fill(buffer.get() + 1, windowSize);
+		base = pos;
+		block = cur = buffer.get() + 1;
+		end = block + n;
+		return n > 0;
+	}
+};
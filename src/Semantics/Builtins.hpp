@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+// Functions every program can call without declaring them. A use of one resolves to
+// Slot{Slot::Builtin, index in builtinFunctions}; the TypeChecker knows their
+// signatures and each backend implements them.
+enum class Builtin : uint8_t { Array, Length };
+
+struct BuiltinFunction {
+	std::string_view name;
+	Builtin id;
+};
+
+inline constexpr BuiltinFunction builtinFunctions[] = {
+	{"array", Builtin::Array},		// float[] array(float n): n zeros
+	{"length", Builtin::Length},	// float length(float[] a)
+};
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Builtins.hpp"
+#include "SymbolTable.hpp"
+#include "SyntaxTree.hpp"
+
+// Binds every name use in a Program to a Slot (see SyntaxTree.hpp), so later stages
+// never look a name up again. Functions are global slots numbered in declaration order
+// and are visible in the whole program, so a call may come before its callee; the
+// builtins are visible everywhere too, and their names cannot be redefined. A
+// function's parameters and locals get frame slots; a frame slot is never reused within
+// the function, so (function, slot) identifies one declaration.
+//
+// Blocks open a scope, as do the bodies of if/while/for. An inner declaration shadows an
+// outer one; declaring a name twice in one scope is an error. A definition's initializer
+// is resolved before the name is declared, so `float x = x;` reads an outer x.
+// Throws std::runtime_error on the first undefined or redefined name.
+class Resolver {
+private:
+	SymbolTable<Slot> symbols;
+	std::vector<FunctionDecl*> globals;	// indexed by global slot
+	uint32_t frameSize = 0;				// frame slots handed out in the current function
+
+public:
+	void resolve(Program& program) {
+		symbols.clear();
+		globals.clear();
+
+		for (uint32_t i = 0; i < std::size(builtinFunctions); ++i) {
+			symbols.declare(intern(builtinFunctions[i].name), Slot{Slot::Builtin, i});
+		}
+		for (ASTNode* decl : program.Code) {
+			if (auto* function = dynamic_cast<FunctionDecl*>(decl)) {
+				Slot slot{Slot::Global, static_cast<uint32_t>(globals.size())};
+				if (!symbols.declare(function->name, slot)) {
+					throw std::runtime_error("Redefinition of function '" + nameOf(function->name) + "'.");
+				}
+				globals.push_back(function);
+			}
+		}
+		for (FunctionDecl* function : globals) resolveFunction(*function);
+	}
+
+	// FunctionDecl of each global slot
+	const std::vector<FunctionDecl*>& functions() const { return globals; }
+
+private:
+	static std::string nameOf(Symbol name) { return std::string(globalInterner().text(name)); }
+
+	Slot declareLocal(Symbol name) {
+		Slot slot{Slot::Local, frameSize};
+		if (!symbols.declare(name, slot)) throw std::runtime_error("Redefinition of '" + nameOf(name) + "'.");
+		++frameSize;
+		return slot;
+	}
+
+	void resolveFunction(FunctionDecl& function) {
+		frameSize = 0;
+		symbols.pushScope();
+		for (auto& [paramName, paramType] : function.params) {
+			if (!symbols.declare(paramName, Slot{Slot::Local, frameSize++})) {
+				throw std::runtime_error("Duplicate parameter '" + nameOf(paramName) + "' in function '" +
+										 nameOf(function.name) + "'.");
+			}
+		}
+		resolve(function.body);
+		symbols.popScope();
+		function.frameSize = frameSize;
+	}
+
+	// A statement that gets a scope of its own even when it is not a block
+	void resolveScoped(ASTNode* node) {
+		symbols.pushScope();
+		resolve(node);
+		symbols.popScope();
+	}
+
+	void resolveDefinition(DefinitionStmt& definition) {
+		VariableExpr* variable = dynamic_cast<VariableExpr*>(definition.expression);
+		if (auto* assign = dynamic_cast<BinaryExpr*>(definition.expression); assign && assign->op == OpKind::Assign) {
+			variable = dynamic_cast<VariableExpr*>(assign->left);
+			resolve(assign->right);
+		}
+		if (!variable) throw std::runtime_error("Expected a variable name in definition.");
+		variable->slot = definition.slot = declareLocal(variable->name);
+	}
+
+	void resolve(ASTNode* node) {
+		if (!node) return;
+		if (auto* n = dynamic_cast<VariableExpr*>(node)) {
+			const auto* entry = symbols.lookup(n->name);
+			if (!entry) throw std::runtime_error("Undefined name '" + nameOf(n->name) + "'.");
+			n->slot = entry->value;
+		} else if (dynamic_cast<LiteralExpr*>(node)) {
+		} else if (auto* n = dynamic_cast<BinaryExpr*>(node)) {
+			resolve(n->left);
+			resolve(n->right);
+		} else if (auto* n = dynamic_cast<PrefixExpr*>(node)) {
+			resolve(n->operand);
+		} else if (auto* n = dynamic_cast<PostfixExpr*>(node)) {
+			resolve(n->operand);
+		} else if (auto* n = dynamic_cast<UnaryExpr*>(node)) {
+			resolve(n->expr);
+		} else if (auto* n = dynamic_cast<IndexExpr*>(node)) {
+			resolve(n->target);
+			resolve(n->index);
+		} else if (auto* n = dynamic_cast<ClassFieldAccessExpr*>(node)) {
+			resolve(n->structInstance);
+		} else if (auto* n = dynamic_cast<ClassInstanceExpr*>(node)) {
+			for (auto& field : n->fieldValues) resolve(field.second);
+		} else if (auto* n = dynamic_cast<FunctionCallExpr*>(node)) {
+			resolve(n->callee);
+			if (auto* callee = dynamic_cast<VariableExpr*>(n->callee); callee && !callee->slot.isLocal()) {
+				n->target = callee->slot;
+			}
+			for (ASTNode* arg : n->arguments) resolve(arg);
+		} else if (auto* n = dynamic_cast<CompoundStmt*>(node)) {
+			symbols.pushScope();
+			for (ASTNode* statement : n->statements) resolve(statement);
+			symbols.popScope();
+		} else if (auto* n = dynamic_cast<BlockStmt*>(node)) {
+			symbols.pushScope();
+			for (ASTNode* statement : n->statements) resolve(statement);
+			symbols.popScope();
+		} else if (auto* n = dynamic_cast<DefinitionStmt*>(node)) {
+			resolveDefinition(*n);
+		} else if (auto* n = dynamic_cast<IfStmt*>(node)) {
+			resolve(n->condition);
+			resolveScoped(n->thenBranch);
+			resolveScoped(n->elseBranch);
+		} else if (auto* n = dynamic_cast<WhileStmt*>(node)) {
+			resolve(n->condition);
+			resolveScoped(n->body);
+		} else if (auto* n = dynamic_cast<ForStmt*>(node)) {
+			resolve(n->initializer);
+			resolve(n->condition);
+			resolve(n->incrementor);
+			resolveScoped(n->body);
+		} else if (auto* n = dynamic_cast<ReturnStmt*>(node)) {
+			resolve(n->expression);
+		} else if (dynamic_cast<BreakStmt*>(node) || dynamic_cast<ContinueStmt*>(node)) {
+		} else {
+			throw std::runtime_error("Unexpected declaration inside a function body.");
+		}
+	}
+};
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+#include "StringInterner.hpp"
+
+// Scoped map from interned names to Value. One open-addressing table keyed by Symbol id
+// holds, for every name, the innermost visible declaration; declarations it hides hang
+// off it as a shadow chain. `entries` doubles as the undo log: declarations are appended
+// in order, so popScope() walks back over exactly the entries of the closing scope and
+// puts back whatever each of them shadowed. Nothing is ever erased from the hash table,
+// so there are no tombstones; a name whose last declaration went out of scope keeps its
+// bucket (with no entry) until the next rehash drops it.
+template<class Value>
+class SymbolTable {
+public:
+	static constexpr uint32_t none = UINT32_MAX;
+
+	struct Entry {
+		Symbol name;
+		uint32_t depth;		// scope depth of the declaration; 0 is the outermost scope
+		uint32_t shadowed;	// entry this one hides, or none
+		Value value;
+	};
+
+private:
+	struct Bucket {
+		Symbol name;				// id 0 = empty bucket
+		uint32_t entry = none;		// innermost visible declaration of name
+	};
+
+	std::vector<Bucket> buckets;
+	std::vector<Entry> entries;
+	std::vector<uint32_t> scopeStarts;	// entries.size() when each open scope began
+	size_t usedBuckets = 0;
+	unsigned shift = 64;
+
+public:
+	explicit SymbolTable(size_t expectedNames = 64) { rehash(expectedNames); }
+
+	uint32_t depth() const { return static_cast<uint32_t>(scopeStarts.size()); }
+
+	void pushScope() { scopeStarts.push_back(static_cast<uint32_t>(entries.size())); }
+
+	// O(declarations made in the closing scope)
+	void popScope() {
+		const uint32_t start = scopeStarts.back();
+		scopeStarts.pop_back();
+		while (entries.size() > start) {
+			const Entry& entry = entries.back();
+			bucketFor(entry.name).entry = entry.shadowed;
+			entries.pop_back();
+		}
+	}
+
+	// Declares name in the current scope. Returns false (and changes nothing) if the
+	// current scope already declares it; an outer declaration is shadowed instead.
+	bool declare(Symbol name, Value value) {
+		Bucket& bucket = bucketFor(name);
+		if (bucket.entry != none && entries[bucket.entry].depth == depth()) return false;
+		entries.push_back({name, depth(), bucket.entry, std::move(value)});
+		bucket.entry = static_cast<uint32_t>(entries.size() - 1);
+		return true;
+	}
+
+	// Innermost visible declaration, or nullptr. Valid until the next declare or popScope.
+	const Entry* lookup(Symbol name) const {
+		for (size_t i = home(name);; i = (i + 1) & mask()) {
+			const Bucket& bucket = buckets[i];
+			if (bucket.name == name) return bucket.entry == none ? nullptr : &entries[bucket.entry];
+			if (!bucket.name) return nullptr;
+		}
+	}
+
+	// The declaration `entry` hides, or nullptr: walks the shadow chain outwards
+	const Entry* shadowedBy(const Entry& entry) const {
+		return entry.shadowed == none ? nullptr : &entries[entry.shadowed];
+	}
+
+	// Declarations currently in scope
+	size_t size() const { return entries.size(); }
+
+	void clear() {
+		entries.clear();
+		scopeStarts.clear();
+		std::fill(buckets.begin(), buckets.end(), Bucket{});
+		usedBuckets = 0;
+	}
+
+private:
+	size_t mask() const { return buckets.size() - 1; }
+
+	// Fibonacci hashing: interned ids are dense, so spread them over the whole table
+	size_t home(Symbol name) const {
+		return static_cast<size_t>((name.id * 0x9E3779B97F4A7C15ull) >> shift);
+	}
+
+	// Bucket of name, claimed if the name is new
+	Bucket& bucketFor(Symbol name) {
+		for (size_t i = home(name);; i = (i + 1) & mask()) {
+			Bucket& bucket = buckets[i];
+			if (bucket.name == name) return bucket;
+			if (!bucket.name) {
+				if ((usedBuckets + 1) * 2 > buckets.size()) {	// keep the load under 1/2
+					rehash(0);
+					return bucketFor(name);
+				}
+				++usedBuckets;
+				bucket.name = name;
+				return bucket;
+			}
+		}
+	}
+
+	// Rebuilds the table for at least `names` names (and all live ones), dropping names
+	// that are no longer in scope
+	void rehash(size_t names) {
+		std::vector<Bucket> old = std::move(buckets);
+		size_t live = 0;
+		for (const Bucket& bucket : old) live += bucket.name && bucket.entry != none;
+		size_t size = std::bit_ceil(std::max<size_t>(16, std::max(live, names) * 4));
+		buckets.assign(size, Bucket{});
+		shift = 64 - std::countr_zero(size);
+		usedBuckets = 0;
+		for (const Bucket& bucket : old) {
+			if (!bucket.name || bucket.entry == none) continue;
+			size_t i = home(bucket.name);
+			while (buckets[i].name) i = (i + 1) & mask();
+			buckets[i] = bucket;
+			++usedBuckets;
+		}
+	}
+};
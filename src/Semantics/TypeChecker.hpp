@@ -0,0 +1,392 @@
+#pragma once
+
+#include <algorithm>
+#include <exception>
+#include <iterator>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Builtins.hpp"
+#include "SyntaxTree.hpp"
+#include "ThreadPool.hpp"
+#include "TypeContext.hpp"
+
+// One type error. Checking goes on after a diagnostic; an expression whose type could not
+// be determined has no type (nullptr) and is not reported again by the code around it.
+struct Diagnostic {
+	Symbol function;	// function the error is in; no symbol for class declarations
+	std::string message;
+};
+
+inline std::ostream& operator<<(std::ostream& out, const Diagnostic& diagnostic) {
+	if (diagnostic.function) out << "In function '" << diagnostic.function << "': ";
+	return out << diagnostic.message;
+}
+
+// Checks the body of one function against the signatures and class layouts already in
+// place. Writes the type of every frame slot to FunctionDecl::frameTypes. Only reads the
+// TypeContext, so checkers for different functions can run at the same time.
+class FunctionChecker {
+private:
+	TypeContext& types;
+	const std::vector<FunctionDecl*>& globals;	// by global slot
+	const std::vector<FunctionType*>& builtins;	// by builtin slot
+	std::vector<Diagnostic>& diagnostics;
+	FunctionDecl& function;
+	Type* result;		// declared return type, or nullptr if unknown
+	int loopDepth = 0;
+
+public:
+	FunctionChecker(TypeContext& types, const std::vector<FunctionDecl*>& globals, const std::vector<FunctionType*>& builtins,
+					std::vector<Diagnostic>& diagnostics, FunctionDecl& function)
+		: types(types), globals(globals), builtins(builtins), diagnostics(diagnostics), function(function),
+		  result(types.named(function.returnType)) {}
+
+	void check() { statement(function.body); }
+
+private:
+	void error(std::string message) { diagnostics.push_back({function.name, std::move(message)}); }
+
+	static std::string quoted(Type* type) { return "'" + type->describe() + "'"; }
+	static std::string quoted(Symbol name) { return "'" + std::string(globalInterner().text(name)) + "'"; }
+
+	static bool isLValue(ASTNode* node) {
+		if (auto* variable = dynamic_cast<VariableExpr*>(node)) return variable->slot.isLocal();
+		return dynamic_cast<IndexExpr*>(node) || dynamic_cast<ClassFieldAccessExpr*>(node);
+	}
+
+	// Numeric operand of an operator; nullptr if missing or not float
+	Type* numeric(Type* type, OpKind op) {
+		if (type && type != types.floatType) {
+			error("Operator '" + std::string(opSpelling(op)) + "' needs 'float' operands, got " + quoted(type) + ".");
+			return nullptr;
+		}
+		return type;
+	}
+
+	void expectAssignable(Type* target, Type* value, const std::string& what) {
+		if (target && value && target != value) {
+			error("Cannot use " + quoted(value) + " as " + what + " of type " + quoted(target) + ".");
+		}
+	}
+
+	Type* expression(ASTNode* node) {
+		if (dynamic_cast<LiteralExpr*>(node)) return types.floatType;
+		if (auto* n = dynamic_cast<VariableExpr*>(node)) {
+			if (n->slot.isLocal()) return function.frameTypes[n->slot.index];
+			if (n->slot.isGlobal()) return globals[n->slot.index]->signature;
+			if (n->slot.isBuiltin()) return builtins[n->slot.index];
+			error("Unresolved name " + quoted(n->name) + ".");
+			return nullptr;
+		}
+		if (auto* n = dynamic_cast<BinaryExpr*>(node)) {
+			Type* left = expression(n->left);
+			Type* right = expression(n->right);
+			if (n->op == OpKind::Assign) {
+				if (!isLValue(n->left)) {
+					error("Left side of '=' cannot be assigned to.");
+					return nullptr;
+				}
+				expectAssignable(left, right, "the value");
+				return left;
+			}
+			left = numeric(left, n->op);
+			right = numeric(right, n->op);
+			return left && right ? types.floatType : nullptr;
+		}
+		if (auto* n = dynamic_cast<PrefixExpr*>(node)) return unary(n->op, n->operand);
+		if (auto* n = dynamic_cast<PostfixExpr*>(node)) return unary(n->op, n->operand);
+		if (auto* n = dynamic_cast<UnaryExpr*>(node)) return unary(n->op, n->expr);
+		if (auto* n = dynamic_cast<IndexExpr*>(node)) {
+			Type* target = expression(n->target);
+			Type* index = expression(n->index);
+			if (index && index != types.floatType) error("Array index must be 'float', got " + quoted(index) + ".");
+			if (!target) return nullptr;
+			if (target->kind != Type::Kind::Array) {
+				error("Cannot index a value of type " + quoted(target) + ".");
+				return nullptr;
+			}
+			return static_cast<ArrayType*>(target)->element;
+		}
+		if (auto* n = dynamic_cast<ClassFieldAccessExpr*>(node)) {
+			Type* object = expression(n->structInstance);
+			if (!object) return nullptr;
+			if (object->kind != Type::Kind::Struct) {
+				error("Cannot access field " + quoted(n->fieldName) + " of type " + quoted(object) + ".");
+				return nullptr;
+			}
+			const StructType::Field* field = static_cast<StructType*>(object)->field(n->fieldName);
+			if (!field) {
+				error(quoted(object) + " has no field " + quoted(n->fieldName) + ".");
+				return nullptr;
+			}
+			return field->type;
+		}
+		if (auto* n = dynamic_cast<FunctionCallExpr*>(node)) return call(*n);
+		if (auto* n = dynamic_cast<ClassInstanceExpr*>(node)) {
+			for (auto& [fieldName, value] : n->fieldValues) {
+				Type* valueType = expression(value);
+				const StructType::Field* field = n->structType->field(fieldName);
+				if (!field) error(quoted(n->structType) + " has no field " + quoted(fieldName) + ".");
+				else expectAssignable(field->type, valueType, "field " + quoted(fieldName));
+			}
+			return n->structType;
+		}
+		error("Expected an expression.");
+		return nullptr;
+	}
+
+	Type* unary(OpKind op, ASTNode* operand) {
+		Type* type = expression(operand);
+		if ((op == OpKind::Increment || op == OpKind::Decrement) && !isLValue(operand)) {
+			error("Operand of '" + std::string(opSpelling(op)) + "' cannot be assigned to.");
+			return nullptr;
+		}
+		return numeric(type, op);
+	}
+
+	Type* call(FunctionCallExpr& n) {
+		Type* callee = expression(n.callee);
+		std::vector<Type*> args;
+		args.reserve(n.arguments.size());
+		for (ASTNode* arg : n.arguments) args.push_back(expression(arg));
+		if (!callee) return nullptr;
+		if (callee->kind != Type::Kind::Function) {
+			error("Cannot call a value of type " + quoted(callee) + ".");
+			return nullptr;
+		}
+
+		auto* signature = static_cast<FunctionType*>(callee);
+		std::string name = "function";
+		if (auto* variable = dynamic_cast<VariableExpr*>(n.callee)) name = quoted(variable->name);
+		if (args.size() != signature->params.size()) {
+			error(name + " takes " + std::to_string(signature->params.size()) + " arguments, got " +
+				  std::to_string(args.size()) + ".");
+		} else {
+			for (size_t i = 0; i < args.size(); ++i) {
+				expectAssignable(signature->params[i], args[i], "argument " + std::to_string(i + 1) + " of " + name);
+			}
+		}
+		return signature->result;
+	}
+
+	// if / while / for condition
+	void condition(ASTNode* node) {
+		Type* type = expression(node);
+		if (type && type != types.floatType) error("Condition must be 'float', got " + quoted(type) + ".");
+	}
+
+	void statement(ASTNode* node) {
+		if (!node) return;
+		if (auto* n = dynamic_cast<CompoundStmt*>(node)) {
+			for (ASTNode* stmt : n->statements) statement(stmt);
+		} else if (auto* n = dynamic_cast<BlockStmt*>(node)) {
+			for (ASTNode* stmt : n->statements) statement(stmt);
+		} else if (auto* n = dynamic_cast<DefinitionStmt*>(node)) {
+			Type* declared = types.named(n->dataType);
+			if (!declared) error("Unknown type " + quoted(n->dataType) + ".");
+			else if (declared == types.voidType) error("A variable cannot be 'void'.");
+			if (declared == types.voidType) declared = nullptr;
+			if (n->slot.isLocal()) function.frameTypes[n->slot.index] = declared;
+			if (auto* assign = dynamic_cast<BinaryExpr*>(n->expression); assign && assign->op == OpKind::Assign) {
+				expectAssignable(declared, expression(assign->right), "the initial value");
+			}
+		} else if (auto* n = dynamic_cast<IfStmt*>(node)) {
+			condition(n->condition);
+			statement(n->thenBranch);
+			statement(n->elseBranch);
+		} else if (auto* n = dynamic_cast<WhileStmt*>(node)) {
+			condition(n->condition);
+			loop(n->body);
+		} else if (auto* n = dynamic_cast<ForStmt*>(node)) {
+			expression(n->initializer);
+			condition(n->condition);
+			expression(n->incrementor);
+			loop(n->body);
+		} else if (auto* n = dynamic_cast<ReturnStmt*>(node)) {
+			Type* value = n->expression ? expression(n->expression) : types.voidType;
+			if (result == types.voidType && n->expression) error("A 'void' function cannot return a value.");
+			else expectAssignable(result, value, "the return value");
+		} else if (dynamic_cast<BreakStmt*>(node) || dynamic_cast<ContinueStmt*>(node)) {
+			if (loopDepth == 0) error("'break' or 'continue' outside a loop.");
+		} else {
+			expression(node);
+		}
+	}
+
+	void loop(ASTNode* body) {
+		++loopDepth;
+		statement(body);
+		--loopDepth;
+	}
+};
+
+// Type-checks a Program the Resolver has already run over (names must carry slots).
+// Two phases: a sequential one lays out the classes and interns every function
+// signature, then the bodies are checked, each on its own, sequentially or on a thread
+// pool. Every node is visited once and types compare by pointer, so checking is linear
+// in the size of the program.
+//
+// Fills in ClassDecl::structType, FunctionDecl::signature and FunctionDecl::frameTypes.
+// The TypeContext must outlive the Program.
+class TypeChecker {
+private:
+	TypeContext& types;
+	std::vector<Diagnostic> found;
+	std::vector<FunctionDecl*> globals;		// by global slot: functions in declaration order
+	std::vector<FunctionType*> builtins;	// by builtin slot
+	std::vector<ClassDecl*> classDecls;	// in declaration order
+	std::unordered_map<const StructType*, ClassDecl*> classes;
+	std::vector<const StructType*> layoutStack;	// classes being laid out, to catch cycles
+
+public:
+	explicit TypeChecker(TypeContext& types) : types(types) {}
+
+	// Returns true if the program has no type errors
+	bool check(Program& program) {
+		collectDeclarations(program);
+		for (FunctionDecl* function : globals) FunctionChecker(types, globals, builtins, found, *function).check();
+		return found.empty();
+	}
+
+	// Same result, with the function bodies checked on pool in batches of consecutive
+	// functions. Each batch collects its own diagnostics and the batches are appended in
+	// order, so diagnostics() is identical to the sequential check. Must not be called
+	// from a pool task.
+	bool check(Program& program, ThreadPool& pool, size_t functionsPerTask = 0) {
+		collectDeclarations(program);
+		if (functionsPerTask == 0) functionsPerTask = std::max<size_t>(16, globals.size() / (pool.size() * 8));
+
+		std::vector<std::vector<Diagnostic>> batches((globals.size() + functionsPerTask - 1) / functionsPerTask);
+		for (size_t b = 0; b < batches.size(); ++b) {
+			pool.submit([this, b, functionsPerTask, &batches] {
+				const size_t first = b * functionsPerTask;
+				const size_t end = std::min(first + functionsPerTask, globals.size());
+				for (size_t f = first; f < end; ++f) {
+					try {
+						FunctionChecker(types, globals, builtins, batches[b], *globals[f]).check();
+					} catch (const std::exception& e) {
+						batches[b].push_back({globals[f]->name, std::string("Internal error: ") + e.what()});
+					}
+				}
+			});
+		}
+		pool.wait();
+
+		for (std::vector<Diagnostic>& batch : batches) {
+			found.insert(found.end(), std::make_move_iterator(batch.begin()), std::make_move_iterator(batch.end()));
+		}
+		return found.empty();
+	}
+
+	const std::vector<Diagnostic>& diagnostics() const { return found; }
+
+private:
+	static std::string quoted(Symbol name) { return "'" + std::string(globalInterner().text(name)) + "'"; }
+
+	void error(Symbol function, std::string message) { found.push_back({function, std::move(message)}); }
+
+	// The sequential phase: everything a body check reads besides the body itself
+	void collectDeclarations(Program& program) {
+		found.clear();
+		globals.clear();
+		classDecls.clear();
+		classes.clear();
+		types.forgetClasses();	// classes of an earlier check, of this program or another
+		collectBuiltins();
+		collectClasses(program);
+		collectSignatures(program);
+	}
+
+	void collectBuiltins() {
+		builtins.clear();
+		Type* floatType = types.floatType;
+		Type* floatArray = types.array(floatType);
+		for (const BuiltinFunction& builtin : builtinFunctions) {
+			switch (builtin.id) {
+				case Builtin::Array: builtins.push_back(types.function(floatArray, {&floatType, 1})); break;
+				case Builtin::Length: builtins.push_back(types.function(floatType, {&floatArray, 1})); break;
+			}
+		}
+	}
+
+	void collectClasses(Program& program) {
+		for (ASTNode* decl : program.Code) {
+			if (auto* classDecl = dynamic_cast<ClassDecl*>(decl)) {
+				classDecl->structType = types.declareStruct(classDecl->name);
+				if (!classDecl->structType) {
+					error({}, "Redefinition of type " + quoted(classDecl->name) + ".");
+					continue;
+				}
+				classDecls.push_back(classDecl);
+				classes.emplace(classDecl->structType, classDecl);
+			}
+		}
+		// Field types may name classes declared further down, so lay out in dependency order
+		for (ClassDecl* classDecl : classDecls) layout(*classDecl);
+	}
+
+	void layout(ClassDecl& classDecl) {
+		StructType* structType = classDecl.structType;
+		if (structType->complete) return;
+		if (std::find(layoutStack.begin(), layoutStack.end(), structType) != layoutStack.end()) {
+			error({}, "Class " + quoted(classDecl.name) + " contains itself.");
+			return;
+		}
+		layoutStack.push_back(structType);
+		for (auto& [fieldName, fieldTypeName] : classDecl.fields) {
+			Type* fieldType = types.named(fieldTypeName);
+			if (!fieldType || fieldType == types.voidType) {
+				error({}, "Field " + quoted(fieldName) + " of class " + quoted(classDecl.name) + " has invalid type " +
+						  quoted(fieldTypeName) + ".");
+				continue;
+			}
+			if (fieldType->kind == Type::Kind::Struct) {
+				auto inner = classes.find(static_cast<StructType*>(fieldType));
+				if (inner != classes.end()) layout(*inner->second);
+				if (!static_cast<StructType*>(fieldType)->complete) continue;	// cycle, reported above
+			}
+			if (structType->field(fieldName)) {
+				error({}, "Duplicate field " + quoted(fieldName) + " in class " + quoted(classDecl.name) + ".");
+				continue;
+			}
+			structType->addField(fieldName, fieldType);
+		}
+		structType->finish();
+		layoutStack.pop_back();
+	}
+
+	void collectSignatures(Program& program) {
+		std::vector<Type*> params;
+		for (ASTNode* decl : program.Code) {
+			auto* function = dynamic_cast<FunctionDecl*>(decl);
+			if (!function) continue;
+			globals.push_back(function);
+
+			// Parameters are the first frame slots
+			function->frameTypes = program.arena.copyList(std::vector<Type*>(function->frameSize, nullptr));
+			bool complete = true;
+			params.clear();
+			for (size_t i = 0; i < function->params.size(); ++i) {
+				auto [paramName, paramTypeName] = function->params[i];
+				Type* paramType = types.named(paramTypeName);
+				if (!paramType || paramType == types.voidType) {
+					error(function->name, "Parameter " + quoted(paramName) + " has invalid type " + quoted(paramTypeName) + ".");
+					paramType = nullptr;
+					complete = false;
+				}
+				if (i < function->frameTypes.size()) function->frameTypes[i] = paramType;
+				params.push_back(paramType);
+			}
+
+			Type* result = types.named(function->returnType);
+			if (!result) {
+				error(function->name, "Unknown return type " + quoted(function->returnType) + ".");
+				complete = false;
+			}
+			function->signature = complete ? types.function(result, params) : nullptr;
+		}
+	}
+};
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Bump-pointer allocator. Objects are carved out of large chunks and are never freed
+// individually: destroying (or resetting) the arena releases every chunk at once.
+// make<T>() does not run ~T(), so it is meant for objects that own nothing outside the
+// arena; makeOwned<T>() records a finalizer for the few that do.
+class Arena {
+private:
+	struct Chunk {
+		std::unique_ptr<std::byte[]> data;
+		size_t size;
+	};
+
+	struct Finalizer {
+		void (*destroy)(void*);
+		void* object;
+	};
+
+	static constexpr size_t maxChunkSize = 1 << 20;
+
+	std::vector<Chunk> chunks;
+	std::vector<Finalizer> finalizers;
+	std::byte* cursor = nullptr;
+	std::byte* limit = nullptr;
+	size_t nextChunkSize;
+	size_t used = 0;		// bytes handed out, excluding alignment padding
+
+public:
+	explicit Arena(size_t firstChunkSize = 64 * 1024) : nextChunkSize(firstChunkSize) {}
+
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+
+	~Arena() { reset(); }
+
+	void* allocate(size_t size, size_t align = alignof(std::max_align_t)) {
+		std::byte* p = alignUp(cursor, align);
+		if (p == nullptr || p + size > limit) {
+			addChunk(size + align);
+			p = alignUp(cursor, align);
+		}
+		cursor = p + size;
+		used += size;
+		return p;
+	}
+
+	template<class T, class... Args>
+	T* make(Args&&... args) {
+		return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+	}
+
+	// Like make(), but ~T() runs when the arena is released
+	template<class T, class... Args>
+	T* makeOwned(Args&&... args) {
+		T* object = make<T>(std::forward<Args>(args)...);
+		if constexpr (!std::is_trivially_destructible_v<T>) {
+			finalizers.push_back({[](void* p) { static_cast<T*>(p)->~T(); }, object});
+		}
+		return object;
+	}
+
+	// Copies a list into the arena; the span stays valid as long as the arena does
+	template<class T>
+	std::span<T> copyList(std::span<const T> items) {
+		static_assert(std::is_trivially_destructible_v<T>, "arena lists are never destroyed");
+		if (items.empty()) return {};
+		T* data = static_cast<T*>(allocate(sizeof(T) * items.size(), alignof(T)));
+		std::uninitialized_copy(items.begin(), items.end(), data);
+		return {data, items.size()};
+	}
+
+	template<class T>
+	std::span<T> copyList(const std::vector<T>& items) { return copyList(std::span<const T>(items)); }
+
+	std::string_view copyString(std::string_view text) {
+		if (text.empty()) return {};
+		char* data = static_cast<char*>(allocate(text.size(), 1));
+		std::copy(text.begin(), text.end(), data);
+		return {data, text.size()};
+	}
+
+	// Releases everything in O(chunks + owned objects)
+	void reset() {
+		for (auto it = finalizers.rbegin(); it != finalizers.rend(); ++it) it->destroy(it->object);
+		finalizers.clear();
+		chunks.clear();
+		cursor = limit = nullptr;
+		used = 0;
+	}
+
+	// Takes over everything other allocated (and its finalizers); other ends up empty.
+	// Allocations keep coming from this arena's current chunk.
+	void absorb(Arena&& other) {
+		if (this == &other) return;
+		if (chunks.empty()) {
+			chunks = std::move(other.chunks);
+			cursor = other.cursor;
+			limit = other.limit;
+		} else {
+			chunks.insert(chunks.end() - 1, std::make_move_iterator(other.chunks.begin()),
+						  std::make_move_iterator(other.chunks.end()));
+		}
+		finalizers.insert(finalizers.end(), other.finalizers.begin(), other.finalizers.end());
+		used += other.used;
+
+		other.chunks.clear();
+		other.finalizers.clear();
+		other.cursor = other.limit = nullptr;
+		other.used = 0;
+	}
+
+	// Stats for sizing
+	size_t bytesUsed() const { return used; }
+	size_t chunkCount() const { return chunks.size(); }
+	size_t bytesReserved() const {
+		size_t total = 0;
+		for (const Chunk& chunk : chunks) total += chunk.size;
+		return total;
+	}
+
+private:
+	static std::byte* alignUp(std::byte* p, size_t align) {
+		auto address = reinterpret_cast<uintptr_t>(p);
+		return reinterpret_cast<std::byte*>((address + align - 1) & ~(uintptr_t)(align - 1));
+	}
+
+	void addChunk(size_t minimum) {
+		size_t size = std::max(nextChunkSize, minimum);
+		nextChunkSize = std::min(nextChunkSize * 2, maxChunkSize);
+		chunks.push_back({std::make_unique_for_overwrite<std::byte[]>(size), size});
+		cursor = chunks.back().data.get();
+		limit = cursor + size;
+	}
+};
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <type_traits>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer thread.
+// Items move in batches; each side keeps a cached copy of the other side's index so
+// the shared cache lines are only touched when the cached view runs out.
+template<class T>
+class SpscQueue {
+	static_assert(std::is_trivially_copyable_v<T>, "items are copied as plain data");
+
+	static constexpr size_t lineSize = 64;	// keeps the two sides' indices on separate cache lines
+
+public:
+	// capacity is rounded up to a power of two
+	explicit SpscQueue(size_t capacity) {
+		size_t size = 1;
+		while (size < capacity) size <<= 1;
+		mask = size - 1;
+		items = std::make_unique<T[]>(size);
+	}
+
+	SpscQueue(const SpscQueue&) = delete;
+	SpscQueue& operator=(const SpscQueue&) = delete;
+
+	size_t capacity() const { return mask + 1; }
+
+	// Producer: copies up to n items in and returns how many fit
+	size_t tryPush(const T* in, size_t n) {
+		const size_t tail = producer.tail.load(std::memory_order_relaxed);
+		if (capacity() - (tail - producer.cachedHead) < n) {
+			producer.cachedHead = consumer.head.load(std::memory_order_acquire);
+		}
+		size_t free = capacity() - (tail - producer.cachedHead);
+		if (n > free) n = free;
+		for (size_t k = 0; k < n; ++k) items[(tail + k) & mask] = in[k];
+		producer.tail.store(tail + n, std::memory_order_release);
+		return n;
+	}
+
+	// Producer: copies all n items in, waiting for room; false if the consumer cancelled
+	bool push(const T* in, size_t n) {
+		while (n > 0) {
+			size_t pushed = tryPush(in, n);
+			in += pushed;
+			n -= pushed;
+			if (pushed == 0) {
+				if (cancelled.load(std::memory_order_acquire)) return false;
+				std::this_thread::yield();
+			}
+		}
+		return true;
+	}
+
+	// Producer: no more items will be pushed
+	void close() { closed.store(true, std::memory_order_release); }
+
+	// Consumer: copies up to max items out and returns how many were available
+	size_t tryPop(T* out, size_t max) {
+		const size_t head = consumer.head.load(std::memory_order_relaxed);
+		if (consumer.cachedTail == head) {
+			consumer.cachedTail = producer.tail.load(std::memory_order_acquire);
+		}
+		size_t n = consumer.cachedTail - head;
+		if (n > max) n = max;
+		for (size_t k = 0; k < n; ++k) out[k] = items[(head + k) & mask];
+		consumer.head.store(head + n, std::memory_order_release);
+		return n;
+	}
+
+	// Consumer: waits for at least one item; 0 only once the queue is closed and drained
+	size_t pop(T* out, size_t max) {
+		for (int spins = 0;; ++spins) {
+			// Read `closed` before popping, so items pushed before close() are never missed
+			bool done = closed.load(std::memory_order_acquire);
+			if (size_t n = tryPop(out, max)) return n;
+			if (done) return 0;
+			if (spins >= 64) std::this_thread::yield();
+		}
+	}
+
+	// Consumer: stop accepting items; a producer blocked in push() gives up
+	void cancel() { cancelled.store(true, std::memory_order_release); }
+
+private:
+	std::unique_ptr<T[]> items;
+	size_t mask = 0;
+
+	struct alignas(lineSize) ProducerSide {
+		std::atomic<size_t> tail{0};
+		size_t cachedHead = 0;
+	} producer;
+
+	struct alignas(lineSize) ConsumerSide {
+		std::atomic<size_t> head{0};
+		size_t cachedTail = 0;
+	} consumer;
+
+	alignas(lineSize) std::atomic<bool> closed{false};
+	std::atomic<bool> cancelled{false};
+};
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+// Dense ID of an interned string. Two Symbols are equal iff their text is equal.
+// id 0 is the empty string and doubles as "no symbol".
+struct Symbol {
+	uint32_t id = 0;
+
+	bool operator==(const Symbol& other) const { return id == other.id; }
+	bool operator!=(const Symbol& other) const { return id != other.id; }
+	explicit operator bool() const { return id != 0; }
+};
+
+template<>
+struct std::hash<Symbol> {
+	size_t operator()(Symbol s) const noexcept { return s.id; }
+};
+
+// Maps each distinct string to a Symbol. Text is copied once into an append-only
+// byte arena, so the views returned by text() stay valid for the interner's lifetime.
+//
+// Safe to use from several threads. Looking up a string that is already interned takes
+// no lock: the probe table is published through atomics and entries never move. Inserts
+// serialize on a mutex. text() is lock-free for any Symbol the calling thread received
+// through synchronized means (a return value, a queue, a join).
+class StringInterner {
+private:
+	static constexpr size_t chunkSize = 64 * 1024;
+	static constexpr uint32_t blockBits = 12;	// 4096 entries per block
+	static constexpr uint32_t blockMask = (1u << blockBits) - 1;
+	static constexpr size_t maxBlocks = 4096;	// up to 16M symbols
+
+	struct Entry {
+		std::string_view text;
+		uint32_t hash = 0;
+	};
+
+	// Open addressing table of ids, 0 = empty. Replaced, never resized in place, so a
+	// lock-free reader always probes a complete table.
+	struct Table {
+		std::unique_ptr<std::atomic<uint32_t>[]> slots;
+		size_t mask;
+
+		explicit Table(size_t size) : slots(std::make_unique<std::atomic<uint32_t>[]>(size)), mask(size - 1) {
+			for (size_t i = 0; i < size; ++i) slots[i].store(0, std::memory_order_relaxed);
+		}
+	};
+
+	std::mutex insertLock;
+	std::vector<std::unique_ptr<char[]>> chunks;
+	char* cursor = nullptr;
+	size_t remaining = 0;
+
+	std::array<std::unique_ptr<Entry[]>, maxBlocks> entries;	// id -> text, hash
+	std::atomic<uint32_t> count{0};
+
+	std::atomic<Table*> table{nullptr};
+	std::vector<std::unique_ptr<Table>> tables;	// current one last; older ones kept for readers still probing them
+
+public:
+	StringInterner() {
+		entries[0] = std::make_unique<Entry[]>(size_t(1) << blockBits);
+		count.store(1, std::memory_order_relaxed);	// id 0: the empty string
+		tables.push_back(std::make_unique<Table>(1024));
+		table.store(tables.back().get(), std::memory_order_release);
+	}
+
+	StringInterner(const StringInterner&) = delete;
+	StringInterner& operator=(const StringInterner&) = delete;
+
+	Symbol intern(std::string_view text) {
+		if (text.empty()) return Symbol{};
+		const uint32_t hash = hashOf(text);
+		if (Symbol found = probe(*table.load(std::memory_order_acquire), text, hash)) return found;
+
+		std::lock_guard<std::mutex> guard(insertLock);
+		Table* current = table.load(std::memory_order_relaxed);
+		size_t i = hash & current->mask;
+		for (uint32_t id; (id = current->slots[i].load(std::memory_order_relaxed)) != 0; i = (i + 1) & current->mask) {
+			const Entry& e = entry(id);
+			if (e.hash == hash && e.text == text) return Symbol{id};
+		}
+
+		const uint32_t id = count.load(std::memory_order_relaxed);
+		if ((id + 1) * 4 > (current->mask + 1) * 3) {
+			current = grow(*current);
+			for (i = hash & current->mask; current->slots[i].load(std::memory_order_relaxed) != 0; i = (i + 1) & current->mask) {}
+		}
+
+		if ((id & blockMask) == 0) {
+			if ((id >> blockBits) >= maxBlocks) throw std::length_error("StringInterner: too many symbols");
+			entries[id >> blockBits] = std::make_unique<Entry[]>(size_t(1) << blockBits);
+		}
+		entries[id >> blockBits][id & blockMask] = {store(text), hash};
+		count.store(id + 1, std::memory_order_release);
+		current->slots[i].store(id, std::memory_order_release);	// publishes the entry to lock-free readers
+		return Symbol{id};
+	}
+
+	// Symbol of text if it was interned before, without inserting it
+	Symbol find(std::string_view text) const {
+		if (text.empty()) return Symbol{};
+		return probe(*table.load(std::memory_order_acquire), text, hashOf(text));
+	}
+
+	std::string_view text(Symbol symbol) const { return entry(symbol.id).text; }
+
+	// Number of symbols including the empty one
+	size_t size() const { return count.load(std::memory_order_acquire); }
+
+private:
+	static uint32_t hashOf(std::string_view text) {
+		size_t h = std::hash<std::string_view>{}(text);
+		return static_cast<uint32_t>(h ^ (h >> 32));
+	}
+
+	const Entry& entry(uint32_t id) const { return entries[id >> blockBits][id & blockMask]; }
+
+	Symbol probe(const Table& t, std::string_view text, uint32_t hash) const {
+		for (size_t i = hash & t.mask;; i = (i + 1) & t.mask) {
+			uint32_t id = t.slots[i].load(std::memory_order_acquire);
+			if (id == 0) return Symbol{};
+			const Entry& e = entry(id);
+			if (e.hash == hash && e.text == text) return Symbol{id};
+		}
+	}
+
+	std::string_view store(std::string_view text) {
+		if (text.size() > remaining) {
+			size_t size = text.size() > chunkSize ? text.size() : chunkSize;
+			chunks.push_back(std::make_unique<char[]>(size));
+			cursor = chunks.back().get();
+			remaining = size;
+		}
+		std::copy(text.begin(), text.end(), cursor);
+		std::string_view stored(cursor, text.size());
+		cursor += text.size();
+		remaining -= text.size();
+		return stored;
+	}
+
+	// Builds a table twice the size and publishes it; called with insertLock held
+	Table* grow(const Table& old) {
+		auto bigger = std::make_unique<Table>((old.mask + 1) * 2);
+		for (size_t k = 0; k <= old.mask; ++k) {
+			uint32_t id = old.slots[k].load(std::memory_order_relaxed);
+			if (id == 0) continue;
+			size_t i = entry(id).hash & bigger->mask;
+			while (bigger->slots[i].load(std::memory_order_relaxed) != 0) i = (i + 1) & bigger->mask;
+			bigger->slots[i].store(id, std::memory_order_relaxed);
+		}
+		tables.push_back(std::move(bigger));
+		table.store(tables.back().get(), std::memory_order_release);
+		return tables.back().get();
+	}
+};
+
+// The interner shared by the lexer, the parser and everything after them
+inline StringInterner& globalInterner() {
+	static StringInterner interner;
+	return interner;
+}
+
+inline Symbol intern(std::string_view text) { return globalInterner().intern(text); }
+
+inline std::ostream& operator<<(std::ostream& out, Symbol symbol) {
+	return out << globalInterner().text(symbol);
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads with one task deque each. A worker runs its own tasks
+// newest first and, when it runs dry, steals the oldest task from another worker, so
+// a burst of submissions spreads over the pool without a single shared queue.
+// Tasks submitted from inside a task land on the submitting worker's deque.
+// Tasks must not throw; catch inside the task and record the error instead.
+class ThreadPool {
+public:
+	using Task = std::function<void()>;
+
+	explicit ThreadPool(size_t threads = std::thread::hardware_concurrency()) {
+		if (threads == 0) threads = 1;
+		for (size_t i = 0; i < threads; ++i) queues.push_back(std::make_unique<WorkQueue>());
+		for (size_t i = 0; i < threads; ++i) workers.emplace_back([this, i] { run(i); });
+	}
+
+	~ThreadPool() {
+		wait();
+		{
+			std::lock_guard<std::mutex> guard(sleepLock);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (std::thread& worker : workers) worker.join();
+	}
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	size_t size() const { return workers.size(); }
+
+	void submit(Task task) {
+		size_t target = currentWorker().pool == this
+			? currentWorker().index
+			: nextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+		pending.fetch_add(1, std::memory_order_relaxed);
+		{
+			std::lock_guard<std::mutex> guard(queues[target]->lock);
+			queues[target]->tasks.push_back(std::move(task));
+		}
+		{
+			std::lock_guard<std::mutex> guard(sleepLock);
+			++available;
+		}
+		wake.notify_one();
+	}
+
+	// Blocks until every submitted task (including ones they submit) has finished.
+	// Must not be called from inside a task.
+	void wait() {
+		std::unique_lock<std::mutex> guard(sleepLock);
+		idle.wait(guard, [this] { return pending.load(std::memory_order_acquire) == 0; });
+	}
+
+private:
+	struct WorkQueue {
+		std::mutex lock;
+		std::deque<Task> tasks;
+	};
+
+	struct WorkerId {
+		const ThreadPool* pool = nullptr;
+		size_t index = 0;
+	};
+
+	static WorkerId& currentWorker() {
+		thread_local WorkerId id;
+		return id;
+	}
+
+	std::vector<std::unique_ptr<WorkQueue>> queues;
+	std::vector<std::thread> workers;
+	std::atomic<size_t> nextQueue{0};
+	std::atomic<size_t> pending{0};	// submitted but not finished
+
+	std::mutex sleepLock;
+	std::condition_variable wake;	// tasks became available, or the pool is stopping
+	std::condition_variable idle;	// pending dropped to zero
+	size_t available = 0;			// queued tasks not yet claimed, guarded by sleepLock
+	bool stopping = false;
+
+	void run(size_t self) {
+		currentWorker() = {this, self};
+		for (;;) {
+			{
+				std::unique_lock<std::mutex> guard(sleepLock);
+				wake.wait(guard, [this] { return available > 0 || stopping; });
+				if (available == 0) return;	// stopping with nothing left
+				--available;				// claims one task; it is in some deque
+			}
+			// The claimed task is already in a deque (submit pushes before it counts), but
+			// the scan locks one deque at a time: another worker can take the task it was
+			// heading for while the one left over lands in a deque it already passed. That
+			// race is short, so yield and scan again.
+			Task task;
+			while (!take(self, task)) std::this_thread::yield();
+			task();
+			if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+				std::lock_guard<std::mutex> guard(sleepLock);
+				idle.notify_all();
+			}
+		}
+	}
+
+	// Own deque first (newest task), then steal the oldest task of the others
+	bool take(size_t self, Task& task) {
+		{
+			WorkQueue& own = *queues[self];
+			std::lock_guard<std::mutex> guard(own.lock);
+			if (!own.tasks.empty()) {
+				task = std::move(own.tasks.back());
+				own.tasks.pop_back();
+				return true;
+			}
+		}
+		for (size_t k = 1; k < queues.size(); ++k) {
+			WorkQueue& victim = *queues[(self + k) % queues.size()];
+			std::lock_guard<std::mutex> guard(victim.lock);
+			if (!victim.tasks.empty()) {
+				task = std::move(victim.tasks.front());
+				victim.tasks.pop_front();
+				return true;
+			}
+		}
+		return false;
+	}
+};
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+
+// XXH64, the 64-bit xxHash of Yann Collet: four independent multiply-rotate lanes over
+// 32-byte stripes, merged and avalanched at the end. Output matches the reference
+// implementation for any split of the input into update() calls.
+class XXHash64 {
+private:
+	static constexpr uint64_t prime1 = 0x9E3779B185EBCA87ull;
+	static constexpr uint64_t prime2 = 0xC2B2AE3D27D4EB4Full;
+	static constexpr uint64_t prime3 = 0x165667B19E3779F9ull;
+	static constexpr uint64_t prime4 = 0x85EBCA77C2B2AE63ull;
+	static constexpr uint64_t prime5 = 0x27D4EB2F165667C5ull;
+
+	uint64_t lanes[4];
+	uint64_t seed;
+	uint64_t total = 0;
+	unsigned char stripe[32];	// bytes of a partial stripe
+	size_t buffered = 0;
+
+	static uint64_t read64(const unsigned char* p) {
+		uint64_t v;
+		std::memcpy(&v, p, 8);
+		return v;	// little-endian hosts only, like the rest of the tree
+	}
+
+	static uint32_t read32(const unsigned char* p) {
+		uint32_t v;
+		std::memcpy(&v, p, 4);
+		return v;
+	}
+
+	static uint64_t round(uint64_t acc, uint64_t input) {
+		acc += input * prime2;
+		return std::rotl(acc, 31) * prime1;
+	}
+
+	static uint64_t merge(uint64_t acc, uint64_t lane) {
+		acc ^= round(0, lane);
+		return acc * prime1 + prime4;
+	}
+
+	void consume(const unsigned char* p) {
+		for (int i = 0; i < 4; ++i) lanes[i] = round(lanes[i], read64(p + 8 * i));
+	}
+
+public:
+	explicit XXHash64(uint64_t seed = 0) : seed(seed) {
+		lanes[0] = seed + prime1 + prime2;
+		lanes[1] = seed + prime2;
+		lanes[2] = seed;
+		lanes[3] = seed - prime1;
+	}
+
+	XXHash64& update(const void* data, size_t length) {
+		const unsigned char* p = static_cast<const unsigned char*>(data);
+		total += length;
+		if (buffered + length < 32) {
+			std::memcpy(stripe + buffered, p, length);
+			buffered += length;
+			return *this;
+		}
+		if (buffered) {
+			size_t fill = 32 - buffered;
+			std::memcpy(stripe + buffered, p, fill);
+			consume(stripe);
+			p += fill;
+			length -= fill;
+			buffered = 0;
+		}
+		for (; length >= 32; p += 32, length -= 32) consume(p);
+		std::memcpy(stripe, p, length);
+		buffered = length;
+		return *this;
+	}
+
+	XXHash64& update(std::string_view text) { return update(text.data(), text.size()); }
+
+	// Fixed-size values by their bytes
+	template<class T>
+	XXHash64& add(const T& value) {
+		static_assert(std::is_trivially_copyable_v<T>);
+		return update(&value, sizeof value);
+	}
+
+	uint64_t digest() const {
+		uint64_t h;
+		if (total >= 32) {
+			h = std::rotl(lanes[0], 1) + std::rotl(lanes[1], 7) + std::rotl(lanes[2], 12) + std::rotl(lanes[3], 18);
+			for (uint64_t lane : lanes) h = merge(h, lane);
+		} else {
+			h = seed + prime5;
+		}
+		h += total;
+
+		const unsigned char* p = stripe;
+		size_t left = buffered;
+		for (; left >= 8; p += 8, left -= 8) h = std::rotl(h ^ round(0, read64(p)), 27) * prime1 + prime4;
+		if (left >= 4) {
+			h = std::rotl(h ^ (read32(p) * prime1), 23) * prime2 + prime3;
+			p += 4;
+			left -= 4;
+		}
+		for (; left > 0; ++p, --left) h = std::rotl(h ^ (*p * prime5), 11) * prime1;
+
+		h ^= h >> 33;
+		h *= prime2;
+		h ^= h >> 29;
+		h *= prime3;
+		h ^= h >> 32;
+		return h;
+	}
+};
+
+inline uint64_t xxh64(std::string_view data, uint64_t seed = 0) {
+	return XXHash64(seed).update(data).digest();
+}
@@ -1,41 +1,116 @@
 #pragma once
-#include "string"
-#include "iostream"
-#include "unordered_map"
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "StringInterner.hpp"
 
+// Types are hash-consed by a TypeContext: every distinct type exists exactly once, so two
+// types are equal iff their pointers (or ids) are. Nothing here compares names as text.
 class Type {
 	public:
+		enum class Kind : uint8_t { Primitive, Struct, Array, Function };
+
+		const Kind kind;
+		uint32_t id = 0;		// dense index in its TypeContext
+		uint32_t size = 0;		// bytes a value occupies in memory
+		uint32_t align = 1;
+
+		explicit Type(Kind kind) : kind(kind) {}
 		virtual ~Type() = default;
 		virtual void print() const = 0;
+		virtual std::string describe() const = 0;	// spelling for diagnostics
 };
-	
+
 	class PrimitiveType : public Type {
 	public:
-		std::string name;  // e.g., "int", "float"
-		
-		PrimitiveType(const std::string& name) : name(name) {}
-	
+		Symbol name;  // e.g., "float", "void"
+
+		PrimitiveType(Symbol name, uint32_t size) : Type(Kind::Primitive), name(name) {
+			this->size = size;
+			this->align = size ? size : 1;
+		}
+
 		void print() const override {
 			std::cout << "PrimitiveType(" << name << ")" << std::endl;
 		}
+		std::string describe() const override { return std::string(globalInterner().text(name)); }
 	};
-	
+
+	// Nominal: one StructType per class name. Fields are appended in declaration order and
+	// laid out C-style, each at the next offset aligned for its type.
 	class StructType : public Type {
 	public:
-		std::string name;  // Name of the struct
-		std::unordered_map<std::string, Type*> fields; // Field names + types
-	
-		StructType(const std::string& name) : name(name) {}
-	
-		void addField(const std::string& fieldName, Type* fieldType) {
-			fields[fieldName] = fieldType;
-		}
-	
+		struct Field {
+			Symbol name;
+			Type* type;
+			uint32_t offset;
+		};
+
+		Symbol name;  // Name of the struct
+		std::vector<Field> fields;
+		bool complete = false;	// every field added and the size final
+
+		StructType(Symbol name) : Type(Kind::Struct), name(name) {}
+
+		void addField(Symbol fieldName, Type* fieldType) {
+			uint32_t offset = (size + fieldType->align - 1) / fieldType->align * fieldType->align;
+			fields.push_back({fieldName, fieldType, offset});
+			size = offset + fieldType->size;
+			if (fieldType->align > align) align = fieldType->align;
+		}
+
+		// Rounds the size up to the alignment, so arrays of the struct stay aligned
+		void finish() {
+			size = (size + align - 1) / align * align;
+			complete = true;
+		}
+
+		// Classes have a handful of fields; a scan over one vector beats hashing
+		const Field* field(Symbol fieldName) const {
+			for (const Field& f : fields) {
+				if (f.name == fieldName) return &f;
+			}
+			return nullptr;
+		}
+
 		void print() const override {
 			for (auto& field : fields) {
-				std::cout << "  " << field.first << ": ";
-				field.second->print();
+				std::cout << "  " << field.name << ": ";
+				field.type->print();
 			}
 		}
+		std::string describe() const override { return std::string(globalInterner().text(name)); }
+	};
+
+	// Structural: one ArrayType per element type. A value is a reference to the elements.
+	class ArrayType : public Type {
+	public:
+		Type* element;
+
+		ArrayType(Type* element) : Type(Kind::Array), element(element) {
+			size = align = 8;
+		}
+
+		void print() const override { std::cout << "ArrayType(" << element->describe() << ")" << std::endl; }
+		std::string describe() const override { return element->describe() + "[]"; }
+	};
+
+	// Structural: one FunctionType per (result, parameter types) combination
+	class FunctionType : public Type {
+	public:
+		Type* result;
+		std::vector<Type*> params;
+
+		FunctionType(Type* result, std::vector<Type*> params)
+			: Type(Kind::Function), result(result), params(std::move(params)) {
+			size = align = 8;
+		}
+
+		void print() const override { std::cout << "FunctionType(" << describe() << ")" << std::endl; }
+		std::string describe() const override {
+			std::string text = result->describe() + "(";
+			for (size_t i = 0; i < params.size(); ++i) text += (i ? ", " : "") + params[i]->describe();
+			return text + ")";
+		}
 	};
-	
\ No newline at end of file
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Arena.hpp"
+#include "Type.hpp"
+
+// Owns and hash-conses every Type. Named types (primitives and classes) are found by
+// Symbol; composite types are interned structurally, keyed by the ids of their parts, so
+// asking twice for the same shape returns the same object and type equality is pointer
+// equality. Types live as long as the context, which must outlive every AST annotated
+// with them.
+//
+// Class names are per program: forgetClasses() (called by the TypeChecker before each
+// check) unbinds them, so the same context can check a program again or check another
+// one. The old StructTypes stay alive for the ASTs that point at them; a class declared
+// again gets a new, distinct type.
+//
+// Interning is not synchronized; lookups on a context nobody is adding to are safe from
+// any number of threads.
+class TypeContext {
+private:
+	Arena arena;
+	std::vector<Type*> types;						// by id
+	std::unordered_map<Symbol, Type*> namedTypes;	// primitives, classes and their arrays
+	std::vector<Symbol> classNames;					// entries of namedTypes added by declareStruct
+	std::unordered_map<uint32_t, ArrayType*> arrays;	// element id -> array type
+	std::unordered_multimap<uint64_t, FunctionType*> functions;	// structural hash -> candidates
+
+	template<class T, class... Args>
+	T* add(Args&&... args) {
+		T* type = arena.makeOwned<T>(std::forward<Args>(args)...);
+		type->id = static_cast<uint32_t>(types.size());
+		types.push_back(type);
+		return type;
+	}
+
+public:
+	PrimitiveType* const floatType;
+	PrimitiveType* const voidType;
+
+	TypeContext()
+		: floatType(add<PrimitiveType>(intern("float"), 8)),
+		  voidType(add<PrimitiveType>(intern("void"), 0)) {
+		namedTypes.emplace(floatType->name, floatType);
+		namedTypes.emplace(voidType->name, voidType);
+		namedTypes.emplace(intern("float[]"), array(floatType));
+	}
+
+	TypeContext(const TypeContext&) = delete;
+	TypeContext& operator=(const TypeContext&) = delete;
+
+	// The primitive, class or array type (spelled "T[]") called name, or nullptr
+	Type* named(Symbol name) const {
+		auto it = namedTypes.find(name);
+		return it == namedTypes.end() ? nullptr : it->second;
+	}
+
+	// A new, empty class type, or nullptr if name already names a type. "Name[]" names its
+	// array type from then on; it is added here so that named() stays a pure lookup.
+	StructType* declareStruct(Symbol name) {
+		auto [it, inserted] = namedTypes.emplace(name, nullptr);
+		if (!inserted) return nullptr;
+		StructType* type = add<StructType>(name);
+		it->second = type;
+		Symbol arrayName = intern(std::string(globalInterner().text(name)) + "[]");
+		namedTypes.emplace(arrayName, array(type));
+		classNames.push_back(name);
+		classNames.push_back(arrayName);
+		return type;
+	}
+
+	// Unbinds every class name (and its "Name[]"); the types themselves stay valid
+	void forgetClasses() {
+		for (Symbol name : classNames) namedTypes.erase(name);
+		classNames.clear();
+	}
+
+	ArrayType* array(Type* element) {
+		auto [it, inserted] = arrays.emplace(element->id, nullptr);
+		if (inserted) it->second = add<ArrayType>(element);
+		return it->second;
+	}
+
+	FunctionType* function(Type* result, std::span<Type* const> params) {
+		uint64_t hash = 0xcbf29ce484222325ull;	// FNV-1a over the part ids
+		auto mix = [&](uint32_t id) { hash = (hash ^ id) * 0x100000001b3ull; };
+		mix(result->id);
+		for (Type* param : params) mix(param->id);
+
+		auto [first, last] = functions.equal_range(hash);
+		for (auto it = first; it != last; ++it) {
+			FunctionType* candidate = it->second;
+			if (candidate->result == result && std::equal(params.begin(), params.end(),
+														  candidate->params.begin(), candidate->params.end())) {
+				return candidate;
+			}
+		}
+		FunctionType* type = add<FunctionType>(result, std::vector<Type*>(params.begin(), params.end()));
+		functions.emplace(hash, type);
+		return type;
+	}
+
+	Type* byId(uint32_t id) const { return types[id]; }
+	size_t size() const { return types.size(); }
+};
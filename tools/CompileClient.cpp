@@ -0,0 +1,31 @@
+// Thin client for compile_server: sends one request and prints the reply. Exits with 1
+// when the server answers "error".
+//
+// usage: compile_client <socket path> check|compile <file>
+//        compile_client <socket path> stats|shutdown
+
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+#include "CompileServer.hpp"
+
+int main(int argc, char** argv) {
+	if (argc < 3) {
+		std::cerr << "usage: compile_client <socket path> <command> [file]\n";
+		return 2;
+	}
+	std::string request = argv[2];
+	if (argc > 3) request += " " + std::filesystem::absolute(argv[3]).string();	// the server has its own working directory
+
+	try {
+		std::string reply = sendCompileRequest(argv[1], request);
+		size_t newline = reply.find('\n');
+		std::string status = reply.substr(0, newline);
+		std::cout << (newline == std::string::npos ? "" : reply.substr(newline + 1));
+		return status == "ok" ? 0 : 1;
+	} catch (const std::exception& e) {
+		std::cerr << e.what() << "\n";
+		return 2;
+	}
+}
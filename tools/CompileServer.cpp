@@ -0,0 +1,25 @@
+// Runs a CompileServer until a client sends "shutdown".
+//
+// usage: compile_server <socket path> [-j N]
+
+#include <iostream>
+
+#include "CompileServer.hpp"
+#include "Driver.hpp"
+
+int main(int argc, char** argv) {
+	try {
+		DriverOptions options = parseDriverArgs(argc, argv);
+		if (options.inputs.size() != 1) {
+			std::cerr << "usage: compile_server <socket path> [-j N]\n";
+			return 2;
+		}
+		CompileServer server(options.inputs[0], options.jobs);
+		std::cerr << "listening on " << server.path() << "\n";
+		server.serve();
+	} catch (const std::exception& e) {
+		std::cerr << e.what() << "\n";
+		return 1;
+	}
+	return 0;
+}